@@ -0,0 +1,316 @@
+// SPDX-License-Identifier: LGPL-3.0-only
+
+/*
+* Author: Hao-Xin Wang<wanghaoxin1996@gmail.com>
+* Creation Date: 2024-10-16
+*
+* Description: QuantumLiquids/PEPS project. PEPS optimization by exact summation over the configurations.
+*/
+
+#ifndef QLPEPS_ALGORITHM_VMC_UPDATE_EXACT_SUMMATION_VMC_H
+#define QLPEPS_ALGORITHM_VMC_UPDATE_EXACT_SUMMATION_VMC_H
+
+#include <thread>                                           // thread
+#include <algorithm>                                        // next_permutation
+#include "qlpeps/algorithm/vmc_update/vmc_peps.h"           // VMCOptimizePara, CalGTenForFermionicTensors
+
+namespace qlpeps {
+using namespace qlten;
+
+/**
+ * Finite-size PEPS optimization with the energy and gradient summed exactly over all the configurations
+ * of a quantum-number sector, instead of sampled. For small lattices, as noise-free benchmarks and
+ * regression tests of the Monte-Carlo executor.
+ *
+ * The sector is given by the occupation numbers of optimize_para.init_config. The configurations, flattened
+ * from the last site to the first one, are enumerated in lexicographic order and split into contiguous blocks
+ * over the processes and over optimize_para.mc_chains threads in each process. The upper rows thus vary fastest,
+ * and the boundary MPS grown from the bottom over the unchanged lower rows are kept between consecutive
+ * configurations, so that the row pass of the solver only regrows the changed rows. The column pass is
+ * recomputed in full for every configuration.
+ * The energy and holes are evaluated by EnergySolver as in VMCPEPSExecutor, which also leaves the amplitude
+ * of the configuration in the component, so that no separate trace is needed for the weight.
+ * Configurations with a vanishing amplitude do not contribute and are skipped.
+ *
+ * The TPS is updated by the gradient with optimize_para.step_lens (update_scheme StochasticGradient).
+ */
+template<typename TenElemT, typename QNT, typename WaveFunctionComponentType, typename EnergySolver>
+class ExactSumVMCExecutor : public Executor {
+ public:
+  using Tensor = QLTensor<TenElemT, QNT>;
+  using SITPST = SplitIndexTPS<TenElemT, QNT>;
+
+  ExactSumVMCExecutor(const VMCOptimizePara &optimize_para,
+                      const SITPST &sitpst_init,
+                      const MPI_Comm &comm,
+                      const EnergySolver &solver = EnergySolver());
+
+  void Execute(void) override;
+
+  ///< The exact energy and gradient of the current TPS, in all the processes
+  std::pair<TenElemT, SITPST> EvaluateEnergyAndGradient(void);
+
+  const SITPST &GetState(void) const { return split_index_tps_; }
+  const std::vector<TenElemT> &GetEnergyTrajectory(void) const { return energy_trajectory_; }
+  size_t ConfigurationNum(void) const { return config_num_; }
+
+  void DumpData(const std::string &tps_path);
+
+  VMCOptimizePara optimize_para;
+
+ private:
+  struct PartialSums {
+    double weight = 0;     // sum |psi|^2
+    TenElemT energy = 0;   // sum |psi|^2 E_loc
+    SITPST gten;           // sum |psi|^2 O^*
+    SITPST g_times_energy; // sum |psi|^2 E_loc^* O^*
+  };
+
+  void SumBlock_(const size_t begin, const size_t end, EnergySolver &solver, PartialSums &sums) const;
+  Configuration VecToConfig_(const std::vector<size_t> &config_vec) const;
+  SiteIdx SiteOf_(const size_t k) const;
+  void PrintExecutorInfo_(void) const;
+
+  const MPI_Comm comm_;
+  int rank_;
+  int mpi_size_;
+  size_t lx_;
+  size_t ly_;
+
+  EnergySolver energy_solver_;
+  SITPST split_index_tps_;
+  std::vector<size_t> sorted_config_; // the lexicographically first configuration of the sector
+  size_t config_num_;
+
+  std::vector<TenElemT> energy_trajectory_;
+  std::vector<double> grad_norm_;
+};
+
+template<typename TenElemT, typename QNT, typename WaveFunctionComponentType, typename EnergySolver>
+ExactSumVMCExecutor<TenElemT, QNT, WaveFunctionComponentType, EnergySolver>::ExactSumVMCExecutor(
+    const VMCOptimizePara &optimize_para,
+    const SITPST &sitpst_init,
+    const MPI_Comm &comm,
+    const EnergySolver &solver):
+    optimize_para(optimize_para), comm_(comm),
+    lx_(sitpst_init.cols()), ly_(sitpst_init.rows()),
+    energy_solver_(solver), split_index_tps_(sitpst_init) {
+  MPI_Comm_rank(comm_, &rank_);
+  MPI_Comm_size(comm_, &mpi_size_);
+  if (optimize_para.update_scheme != StochasticGradient) {
+    std::cout << "ExactSumVMCExecutor only supports the StochasticGradient update scheme." << std::endl;
+    exit(1);
+  }
+  WaveFunctionComponentType::trun_para = BMPSTruncatePara(optimize_para);
+  WaveFunctionComponentType::sweep_trun_para = std::nullopt;
+  WaveFunctionComponentType::reuse_sweep_bmps = false;
+  split_index_tps_.ScaleMaxAbsForAllSite(1.0);
+
+  const Configuration &init_config = optimize_para.init_config;
+  for (size_t row = 0; row < ly_; row++) {
+    for (size_t col = 0; col < lx_; col++) {
+      sorted_config_.push_back(init_config({row, col}));
+    }
+  }
+  std::sort(sorted_config_.begin(), sorted_config_.end());
+  // the multinomial coefficient, accumulated as binomials so that the intermediate values are exact
+  config_num_ = 1;
+  size_t placed = 0;
+  for (size_t i = 0; i < sorted_config_.size();) {
+    size_t j = i;
+    while (j < sorted_config_.size() && sorted_config_[j] == sorted_config_[i]) { j++; }
+    for (size_t k = 1; k <= j - i; k++) {
+      config_num_ = config_num_ * (placed + k) / k;
+    }
+    placed += j - i;
+    i = j;
+  }
+  PrintExecutorInfo_();
+  this->SetStatus(ExecutorStatus::INITED);
+}
+
+template<typename TenElemT, typename QNT, typename WaveFunctionComponentType, typename EnergySolver>
+void ExactSumVMCExecutor<TenElemT, QNT, WaveFunctionComponentType, EnergySolver>::Execute(void) {
+  SetStatus(ExecutorStatus::EXEING);
+  for (size_t iter = 0; iter < optimize_para.step_lens.size(); iter++) {
+    Timer iter_timer("exact_summation_iter");
+    const double step_len = optimize_para.step_lens[iter];
+    auto [energy, grad] = EvaluateEnergyAndGradient();
+    split_index_tps_ += (-step_len) * grad;
+    split_index_tps_.ScaleMaxAbsForAllSite(1.0);
+    if (rank_ == kMPIMasterRank) {
+      std::cout << "Iter " << std::setw(4) << iter
+                << "Alpha = " << std::setw(9) << std::scientific << std::setprecision(1) << step_len
+                << "E0 = " << std::setw(14) << std::fixed << std::setprecision(kEnergyOutputPrecision) << energy
+                << "Grad norm = " << std::setw(9) << std::scientific << std::setprecision(1) << grad_norm_.back()
+                << " TotT = " << std::setw(8) << std::fixed << std::setprecision(2) << iter_timer.Elapsed() << "s"
+                << "\n";
+    }
+  }
+  DumpData(optimize_para.wavefunction_path);
+  SetStatus(ExecutorStatus::FINISH);
+}
+
+/**
+ * E = sum_c |psi_c|^2 E_c / W and the gradient sum_c |psi_c|^2 (E_c^* - E^*) O_c^* / W with W = sum_c |psi_c|^2,
+ * i.e. the expectations of the Monte-Carlo executor with the exact weights.
+ */
+template<typename TenElemT, typename QNT, typename WaveFunctionComponentType, typename EnergySolver>
+std::pair<TenElemT, SplitIndexTPS<TenElemT, QNT>>
+ExactSumVMCExecutor<TenElemT, QNT, WaveFunctionComponentType, EnergySolver>::EvaluateEnergyAndGradient(void) {
+  const size_t thread_num = std::max<size_t>(optimize_para.mc_chains, 1);
+  const size_t worker_num = mpi_size_ * thread_num;
+  std::vector<PartialSums> sums(thread_num);
+  std::vector<EnergySolver> solvers(thread_num, energy_solver_);
+  for (PartialSums &partial : sums) {
+    partial.gten = ZeroSplitIndexTPSWithAllBlocks(split_index_tps_);
+    partial.g_times_energy = ZeroSplitIndexTPSWithAllBlocks(split_index_tps_);
+  }
+  auto sum_block = [&](const size_t thread) {
+    const size_t worker = rank_ * thread_num + thread;
+    SumBlock_(config_num_ * worker / worker_num, config_num_ * (worker + 1) / worker_num,
+              solvers[thread], sums[thread]);
+  };
+  std::vector<std::thread> workers;
+  for (size_t thread = 1; thread < thread_num; thread++) {
+    workers.emplace_back(sum_block, thread);
+  }
+  sum_block(0);
+  for (auto &worker : workers) {
+    worker.join();
+  }
+  for (size_t thread = 1; thread < thread_num; thread++) {
+    sums[0].weight += sums[thread].weight;
+    sums[0].energy += sums[thread].energy;
+    sums[0].gten += sums[thread].gten;
+    sums[0].g_times_energy += sums[thread].g_times_energy;
+  }
+
+  // the means over the processes, in which the common factor 1 / mpi_size_ cancels
+  PartialSums &total = sums[0];
+  MPIMeanSplitIndexTPS<TenElemT, QNT>({&total.gten, &total.g_times_energy}, comm_, true);
+  TenElemT scalars[2] = {TenElemT(total.weight), total.energy};
+  HANDLE_MPI_ERROR(::MPI_Allreduce(MPI_IN_PLACE, scalars, 2, hp_numeric::GetMPIDataType<TenElemT>(),
+                                   MPI_SUM, comm_));
+  const double weight = std::real(scalars[0]) / double(mpi_size_);
+  const TenElemT energy = scalars[1] / double(mpi_size_) / weight;
+  SITPST grad = (total.g_times_energy + ComplexConjugate(-energy) * total.gten) * (1.0 / weight);
+  grad.ActFermionPOps();
+  energy_trajectory_.push_back(energy);
+  grad_norm_.push_back(grad.NormSquare());
+  return std::make_pair(energy, grad);
+}
+
+/**
+ * Sum over the configurations [begin, end) of the lexicographic order. The solver consumes the boundary MPS
+ * from below during its row pass, so they are kept in a separate network, down_env, in which only the changed
+ * sites are replaced and only the boundary MPS above the last changed row are regrown. The component starts
+ * every evaluation from a copy of it, and the solver's GenerateBMPSApproach(UP) finds them complete.
+ */
+template<typename TenElemT, typename QNT, typename WaveFunctionComponentType, typename EnergySolver>
+void ExactSumVMCExecutor<TenElemT, QNT, WaveFunctionComponentType, EnergySolver>::SumBlock_(
+    const size_t begin, const size_t end, EnergySolver &solver, PartialSums &sums) const {
+  if (begin >= end) {
+    return;
+  }
+  std::vector<size_t> config_vec = sorted_config_;
+  for (size_t i = 0; i < begin; i++) {
+    std::next_permutation(config_vec.begin(), config_vec.end());
+  }
+  const BMPSTruncatePara &trunc_para = WaveFunctionComponentType::trun_para.value();
+  WaveFunctionComponentType component(split_index_tps_, VecToConfig_(config_vec));
+  TensorNetwork2D<TenElemT, QNT> down_env = component.tn;
+  TensorNetwork2D<TenElemT, QNT> holes(ly_, lx_);
+  for (size_t i = begin; i < end; i++) {
+    if (i > begin) {
+      const std::vector<size_t> prev_config_vec = config_vec;
+      std::next_permutation(config_vec.begin(), config_vec.end());
+      for (size_t k = 0; k < config_vec.size(); k++) {
+        if (config_vec[k] != prev_config_vec[k]) {
+          const SiteIdx site_idx = SiteOf_(k);
+          component.config(site_idx) = config_vec[k];
+          down_env.UpdateSiteConfig(site_idx, config_vec[k], split_index_tps_);
+        }
+      }
+    }
+    down_env.GrowFullBMPS(DOWN, trunc_para);
+    component.tn = down_env;
+    // the solver retraces the amplitude of the new configuration, which the weight below reuses
+    const TenElemT energy_loc = solver.template CalEnergyAndHoles<WaveFunctionComponentType, true>(
+        &split_index_tps_, &component, holes);
+    const double weight = std::norm(component.amplitude);
+    if (weight == 0) {
+      continue; // no contribution, while the local energy and 1 / psi are not finite
+    }
+    const TenElemT inv_psi = ComplexConjugate(1.0 / component.amplitude);
+    const TenElemT weighted_energy_conj = weight * ComplexConjugate(energy_loc);
+    sums.weight += weight;
+    sums.energy += weight * energy_loc;
+    for (size_t row = 0; row < ly_; row++) {
+      for (size_t col = 0; col < lx_; col++) {
+        const size_t basis = component.config({row, col});
+        Tensor gten;
+        if constexpr (Tensor::IsFermionic()) {
+          gten = CalGTenForFermionicTensors(holes({row, col}), component.tn({row, col}));
+        } else {
+          gten = inv_psi * holes({row, col});
+        }
+        sums.gten({row, col})[basis] += weight * gten;
+        sums.g_times_energy({row, col})[basis] += weighted_energy_conj * gten;
+      }
+    }
+  }
+}
+
+///< The k-th entry of the enumerated vectors is the site (ly_ * lx_ - 1 - k) in the row-major order
+template<typename TenElemT, typename QNT, typename WaveFunctionComponentType, typename EnergySolver>
+SiteIdx ExactSumVMCExecutor<TenElemT, QNT, WaveFunctionComponentType, EnergySolver>::SiteOf_(const size_t k) const {
+  const size_t site = ly_ * lx_ - 1 - k;
+  return {site / lx_, site % lx_};
+}
+
+template<typename TenElemT, typename QNT, typename WaveFunctionComponentType, typename EnergySolver>
+Configuration ExactSumVMCExecutor<TenElemT, QNT, WaveFunctionComponentType, EnergySolver>::VecToConfig_(
+    const std::vector<size_t> &config_vec) const {
+  Configuration config(ly_, lx_);
+  for (size_t i = 0; i < config_vec.size(); i++) {
+    config(SiteOf_(i)) = config_vec[i];
+  }
+  return config;
+}
+
+template<typename TenElemT, typename QNT, typename WaveFunctionComponentType, typename EnergySolver>
+void ExactSumVMCExecutor<TenElemT, QNT, WaveFunctionComponentType, EnergySolver>::DumpData(
+    const std::string &tps_path) {
+  if (rank_ == kMPIMasterRank) {
+    split_index_tps_.Dump(tps_path);
+    std::string energy_data_path = "./energy";
+    if (!qlmps::IsPathExist(energy_data_path)) {
+      qlmps::CreatPath(energy_data_path);
+    }
+    DumpVecData(energy_data_path + "/energy_trajectory", energy_trajectory_);
+  }
+}
+
+template<typename TenElemT, typename QNT, typename WaveFunctionComponentType, typename EnergySolver>
+void ExactSumVMCExecutor<TenElemT, QNT, WaveFunctionComponentType, EnergySolver>::PrintExecutorInfo_(void) const {
+  if (rank_ == kMPIMasterRank) {
+    const size_t indent = 40;
+    std::cout << std::left;
+    std::cout << "\n";
+    std::cout << "=====> EXACT SUMMATION PEPS OPTIMIZATION <=====" << "\n";
+    std::cout << std::setw(indent) << "System size (lx, ly):" << "(" << lx_ << ", " << ly_ << ")\n";
+    std::cout << std::setw(indent) << "PEPS bond dimension:" << split_index_tps_.GetMaxBondDimension() << "\n";
+    std::cout << std::setw(indent) << "BMPS bond dimension:" << optimize_para.bmps_trunc_para.D_min << "/"
+              << optimize_para.bmps_trunc_para.D_max << "\n";
+    std::cout << std::setw(indent) << "Configurations in the sector:" << config_num_ << "\n";
+    std::cout << std::setw(indent) << "The number of processors:" << mpi_size_ << "\n";
+    std::cout << std::setw(indent) << "Threads per processor:" << std::max<size_t>(optimize_para.mc_chains, 1)
+              << "\n";
+    std::cout << std::setw(indent) << "Optimization steps:" << optimize_para.step_lens.size() << "\n";
+  }
+}
+
+}//qlpeps
+
+#endif //QLPEPS_ALGORITHM_VMC_UPDATE_EXACT_SUMMATION_VMC_H
@@ -0,0 +1,290 @@
+// SPDX-License-Identifier: LGPL-3.0-only
+
+/*
+* Author: Hao-Xin Wang<wanghaoxin1996@gmail.com>
+* Creation Date: 2024-10-16
+*
+* Description: QuantumLiquids/PEPS project. Minimum-step stochastic reconfiguration (MinSR),
+* which solves the natural gradient in the sample space.
+*/
+
+#ifndef QLPEPS_ALGORITHM_VMC_UPDATE_MIN_SR_SOLVER_H
+#define QLPEPS_ALGORITHM_VMC_UPDATE_MIN_SR_SOLVER_H
+
+#if defined(USE_OPENBLAS)
+#include <lapacke.h>
+#else
+#include "mkl_lapacke.h"                        // Use MKL header
+#endif
+
+#include <cmath>
+#include <climits>                                                          //INT_MAX
+#include "qlpeps/algorithm/vmc_update/stochastic_reconfiguration_dense_smatrix.h" //SRDenseSMatrix
+#include "qlpeps/utility/helpers.h"                                                //ComplexConjugate
+
+namespace qlpeps {
+using namespace qlten;
+
+template<typename ElemT>
+lapack_int HermitianCholeskySolve(std::vector<ElemT> &a, std::vector<ElemT> &b, const size_t n) {
+  lapack_int info;
+  if constexpr (std::is_same_v<ElemT, QLTEN_Double>) {
+    info = LAPACKE_dpotrf(LAPACK_ROW_MAJOR, 'U', lapack_int(n), a.data(), lapack_int(n));
+    if (info == 0) {
+      info = LAPACKE_dpotrs(LAPACK_ROW_MAJOR, 'U', lapack_int(n), 1, a.data(), lapack_int(n), b.data(), 1);
+    }
+  } else {
+    auto *pa = reinterpret_cast<lapack_complex_double *>(a.data());
+    auto *pb = reinterpret_cast<lapack_complex_double *>(b.data());
+    info = LAPACKE_zpotrf(LAPACK_ROW_MAJOR, 'U', lapack_int(n), pa, lapack_int(n));
+    if (info == 0) {
+      info = LAPACKE_zpotrs(LAPACK_ROW_MAJOR, 'U', lapack_int(n), 1, pa, lapack_int(n), pb, 1);
+    }
+  }
+  return info;
+}
+
+///< b = a^{-1} b by the eigen-decomposition of a, where the eigenvalues below rcond * max eigenvalue are dropped.
+template<typename ElemT>
+lapack_int HermitianEigenSolve(std::vector<ElemT> &a, std::vector<ElemT> &b, const size_t n, const double rcond) {
+  std::vector<double> eigvals(n);
+  lapack_int info;
+  if constexpr (std::is_same_v<ElemT, QLTEN_Double>) {
+    info = LAPACKE_dsyevd(LAPACK_ROW_MAJOR, 'V', 'U', lapack_int(n), a.data(), lapack_int(n), eigvals.data());
+  } else {
+    info = LAPACKE_zheevd(LAPACK_ROW_MAJOR, 'V', 'U', lapack_int(n),
+                          reinterpret_cast<lapack_complex_double *>(a.data()), lapack_int(n), eigvals.data());
+  }
+  if (info != 0) {
+    return info;
+  }
+  // the k-th column of a is the k-th eigenvector
+  const double cutoff = rcond * eigvals.back();
+  std::vector<ElemT> coefs(n, ElemT(0.0));
+  for (size_t k = 0; k < n; k++) {
+    if (eigvals[k] <= cutoff) {
+      continue;
+    }
+    ElemT proj(0.0);
+    for (size_t i = 0; i < n; i++) {
+      if constexpr (std::is_same_v<ElemT, QLTEN_Double>) {
+        proj += a[i * n + k] * b[i];
+      } else {
+        proj += std::conj(a[i * n + k]) * b[i];
+      }
+    }
+    coefs[k] = proj / eigvals[k];
+  }
+  for (size_t i = 0; i < n; i++) {
+    b[i] = ElemT(0.0);
+    for (size_t k = 0; k < n; k++) {
+      b[i] += a[i * n + k] * coefs[k];
+    }
+  }
+  return 0;
+}
+
+///< Send packed samples to dest and receive the packed samples from source, used by the ring exchange.
+template<typename TenElemT, typename PackedSamples>
+PackedSamples SendRecvPackedSamples(const PackedSamples &send, const int dest, const int source, const MPI_Comm &comm) {
+  PackedSamples recv;
+  size_t send_sizes[4] = {send.sample_num, send.block_rows.size(), send.sample_idx.size(), send.data.size()};
+  size_t recv_sizes[4];
+  HANDLE_MPI_ERROR(::MPI_Sendrecv(send_sizes, 4, MPI_UNSIGNED_LONG_LONG, dest, 0,
+                                  recv_sizes, 4, MPI_UNSIGNED_LONG_LONG, source, 0, comm, MPI_STATUS_IGNORE));
+  recv.sample_num = recv_sizes[0];
+  recv.block_rows.resize(recv_sizes[1]);
+  recv.sample_idx.resize(recv_sizes[2]);
+  recv.data.resize(recv_sizes[3]);
+  HANDLE_MPI_ERROR(::MPI_Sendrecv(send.block_rows.data(), send_sizes[1], MPI_UNSIGNED_LONG_LONG, dest, 1,
+                                  recv.block_rows.data(), recv_sizes[1], MPI_UNSIGNED_LONG_LONG, source, 1,
+                                  comm, MPI_STATUS_IGNORE));
+  HANDLE_MPI_ERROR(::MPI_Sendrecv(send.sample_idx.data(), send_sizes[2], MPI_UNSIGNED_LONG_LONG, dest, 2,
+                                  recv.sample_idx.data(), recv_sizes[2], MPI_UNSIGNED_LONG_LONG, source, 2,
+                                  comm, MPI_STATUS_IGNORE));
+  HANDLE_MPI_ERROR(::MPI_Sendrecv(send.data.data(), send_sizes[3], hp_numeric::GetMPIDataType<TenElemT>(), dest, 3,
+                                  recv.data.data(), recv_sizes[3], hp_numeric::GetMPIDataType<TenElemT>(), source, 3,
+                                  comm, MPI_STATUS_IGNORE));
+  return recv;
+}
+
+/**
+ * Gather the rows [offsets[r], offsets[r + 1]) of a matrix with row_len columns, held by the process r, into rows of
+ * master. The rows are sent point-to-point in messages of at most INT_MAX elements, so that the MPI counts stay in
+ * int for any matrix size; the displacements are pointer offsets and never pass through int.
+ */
+template<typename ElemT>
+void GatherRowBlocks(const std::vector<ElemT> &local_rows, std::vector<ElemT> &rows,
+                     const std::vector<size_t> &offsets, const size_t row_len, const MPI_Comm &comm) {
+  int rank, mpi_size;
+  MPI_Comm_rank(comm, &rank);
+  MPI_Comm_size(comm, &mpi_size);
+  const MPI_Datatype mpi_data_type = hp_numeric::GetMPIDataType<ElemT>();
+  const size_t rows_per_msg = std::max<size_t>(1, size_t(INT_MAX) / std::max<size_t>(row_len, 1));
+  if (rank == kMPIMasterRank) {
+    std::copy(local_rows.begin(), local_rows.end(), rows.begin() + offsets[rank] * row_len);
+    for (int r = 0; r < mpi_size; r++) {
+      if (r == kMPIMasterRank) {
+        continue;
+      }
+      for (size_t row = offsets[r]; row < offsets[r + 1]; row += rows_per_msg) {
+        const size_t msg_rows = std::min(rows_per_msg, offsets[r + 1] - row);
+        HANDLE_MPI_ERROR(::MPI_Recv(rows.data() + row * row_len, int(msg_rows * row_len), mpi_data_type,
+                                    r, 0, comm, MPI_STATUS_IGNORE));
+      }
+    }
+  } else {
+    const size_t local_row_num = offsets[rank + 1] - offsets[rank];
+    for (size_t row = 0; row < local_row_num; row += rows_per_msg) {
+      const size_t msg_rows = std::min(rows_per_msg, local_row_num - row);
+      HANDLE_MPI_ERROR(::MPI_Send(local_rows.data() + row * row_len, int(msg_rows * row_len), mpi_data_type,
+                                  kMPIMasterRank, 0, comm));
+    }
+  }
+}
+
+/**
+ * Natural gradient by minimum-step stochastic reconfiguration (MinSR),
+ * A. Chen and M. Heyl, Nat. Phys. 20, 1476 (2024).
+ *
+ * With the centered and normalized samples as columns, C = (g_1 - g_ave, ..., g_N - g_ave) / sqrt(N),
+ * the S matrix is S = C C^dagger and the gradient is C eps with eps_i = (E_i - E)^* / sqrt(N).
+ * The natural gradient (S + diag_shift) x = C eps is then obtained in the sample space,
+ *        x = C (T + diag_shift)^{-1} eps,    T = C^dagger C,
+ * which is much cheaper than the CG iteration of S when the parameters outnumber the samples.
+ *
+ * The N x N matrix T is built from the local samples of all the processes by a ring exchange,
+ * each step of which costs one GEMM per (site, basis) block. T is gathered and solved in master
+ * by Cholesky decomposition, or by eigen-decomposition if T + diag_shift is numerically not positive definite.
+ * Master therefore holds the dense N x N matrix T (and a copy for the fallback), i.e. 2 N^2 elements:
+ * about 160 GB for N = 10^5 real samples, which limits the total sample number rather than the parameter number.
+ * 2 N itself must fit in int.
+ *
+ * @param samples         local samples
+ * @param gten_ave        average of the samples over all the processes, should be valid in all processes
+ * @param energy_samples  local energy samples, corresponding to samples
+ * @param energy          average energy over all the processes
+ * @return the natural gradient, valid in all processes
+ */
+template<typename TenElemT, typename QNT>
+SplitIndexTPS<TenElemT, QNT> MinSRNaturalGradient(
+    const SRDenseSMatrix<TenElemT, QNT> &samples,
+    const SplitIndexTPS<TenElemT, QNT> &gten_ave,
+    const std::vector<TenElemT> &energy_samples,
+    const TenElemT energy,
+    const double diag_shift,
+    const MPI_Comm &comm
+) {
+  using SITPS = SplitIndexTPS<TenElemT, QNT>;
+  int rank, mpi_size;
+  MPI_Comm_rank(comm, &rank);
+  MPI_Comm_size(comm, &mpi_size);
+  const MPI_Datatype mpi_data_type = hp_numeric::GetMPIDataType<TenElemT>();
+
+  const size_t local_num = samples.SampleNum();
+  std::vector<size_t> sample_nums(mpi_size);
+  HANDLE_MPI_ERROR(::MPI_Allgather(&local_num, 1, MPI_UNSIGNED_LONG_LONG,
+                                   sample_nums.data(), 1, MPI_UNSIGNED_LONG_LONG, comm));
+  std::vector<size_t> offsets(mpi_size + 1, 0);
+  for (int r = 0; r < mpi_size; r++) {
+    offsets[r + 1] = offsets[r] + sample_nums[r];
+  }
+  const size_t total_num = offsets.back();
+  if (2 * total_num > size_t(INT_MAX)) {
+    if (rank == kMPIMasterRank) {
+      std::cout << "MinSR: the total sample number " << total_num
+                << " exceeds the int range of the MPI counts and of lapack_int." << std::endl;
+    }
+    exit(1);
+  }
+
+  // local rows of the Gram matrix g_i * g_j, by the ring exchange of the samples
+  std::vector<TenElemT> gram_rows(local_num * total_num, TenElemT(0.0));
+  auto packed = samples.PackSamples();
+  for (int step = 0; step < mpi_size; step++) {
+    const int owner = (rank - step + mpi_size) % mpi_size;
+    samples.AccumulateGram(packed, gram_rows.data(), total_num, offsets[owner]);
+    if (step + 1 < mpi_size) {
+      packed = SendRecvPackedSamples<TenElemT>(packed, (rank + 1) % mpi_size, (rank - 1 + mpi_size) % mpi_size, comm);
+    }
+  }
+
+  // g_i * g_ave and the local eps
+  std::vector<TenElemT> local_vecs = samples.SampleInnerProducts(gten_ave);
+  const double inv_sqrt_n = 1.0 / std::sqrt(double(total_num));
+  local_vecs.reserve(2 * local_num);
+  for (size_t i = 0; i < local_num; i++) {
+    local_vecs.push_back(ComplexConjugate(energy_samples[i] - energy) * inv_sqrt_n);
+  }
+
+  std::vector<int> vec_counts(mpi_size), vec_displs(mpi_size);
+  for (int r = 0; r < mpi_size; r++) {
+    vec_counts[r] = int(2 * sample_nums[r]);
+    vec_displs[r] = int(2 * offsets[r]);
+  }
+  std::vector<TenElemT> gram, vecs, y(total_num);
+  if (rank == kMPIMasterRank) {
+    gram.resize(total_num * total_num);
+    vecs.resize(2 * total_num);
+  }
+  // gram has N^2 elements and overflows the int counts of MPI_Gatherv beyond N = 46340
+  GatherRowBlocks(gram_rows, gram, offsets, total_num, comm);
+  HANDLE_MPI_ERROR(::MPI_Gatherv(local_vecs.data(), vec_counts[rank], mpi_data_type,
+                                 vecs.data(), vec_counts.data(), vec_displs.data(), mpi_data_type,
+                                 kMPIMasterRank, comm));
+  gram_rows = std::vector<TenElemT>();
+
+  if (rank == kMPIMasterRank) {
+    // T_ij = (g_i - g_ave) * (g_j - g_ave) / N
+    std::vector<TenElemT> g_dot_ave(total_num);
+    for (int r = 0; r < mpi_size; r++) {
+      for (size_t i = 0; i < sample_nums[r]; i++) {
+        g_dot_ave[offsets[r] + i] = vecs[2 * offsets[r] + i];
+        y[offsets[r] + i] = vecs[2 * offsets[r] + sample_nums[r] + i];
+      }
+    }
+    const double ave_norm_square = gten_ave.NormSquare();
+    for (size_t i = 0; i < total_num; i++) {
+      for (size_t j = 0; j < total_num; j++) {
+        TenElemT &t_ij = gram[i * total_num + j];
+        t_ij = (t_ij - g_dot_ave[i] - ComplexConjugate(g_dot_ave[j]) + ave_norm_square) / double(total_num);
+      }
+      gram[i * total_num + i] += diag_shift;
+    }
+    std::vector<TenElemT> gram_copy = gram, y_copy = y;
+    lapack_int info = HermitianCholeskySolve(gram, y, total_num);
+    if (info != 0) {
+      std::cout << "MinSR: Cholesky decomposition fails (info = " << info
+                << "), solve by eigen-decomposition instead." << std::endl;
+      y = y_copy;
+      info = HermitianEigenSolve(gram_copy, y, total_num, 1e-12);
+      if (info != 0) {
+        std::cout << "MinSR: eigen-decomposition fails, info = " << info << std::endl;
+        exit(1);
+      }
+    }
+  }
+  std::vector<int> y_counts(mpi_size), y_displs(mpi_size);
+  for (int r = 0; r < mpi_size; r++) {
+    y_counts[r] = int(sample_nums[r]);
+    y_displs[r] = int(offsets[r]);
+  }
+  std::vector<TenElemT> local_y(local_num);
+  HANDLE_MPI_ERROR(::MPI_Scatterv(y.data(), y_counts.data(), y_displs.data(), mpi_data_type,
+                                  local_y.data(), int(local_num), mpi_data_type, kMPIMasterRank, comm));
+
+  // x = C y = (sum_i g_i y_i - g_ave sum_i y_i) / sqrt(N)
+  TenElemT y_sum(0.0);
+  for (auto &y_i : local_y) {
+    y_sum += y_i;
+    y_i *= inv_sqrt_n;
+  }
+  SITPS natural_grad = samples.LinearCombineSamples(local_y);
+  natural_grad += (-y_sum * inv_sqrt_n) * gten_ave;
+  CGSolverAllReduceSumVector(natural_grad, comm);
+  return natural_grad;
+}
+
+}//qlpeps
+
+#endif //QLPEPS_ALGORITHM_VMC_UPDATE_MIN_SR_SOLVER_H
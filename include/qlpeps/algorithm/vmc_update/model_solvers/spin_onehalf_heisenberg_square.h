@@ -117,8 +117,9 @@ TenElemT SpinOneHalfHeisenbergSquare<TenElemT, QNT>::CalEnergyAndHoles(const SIT
   }
 
   //Calculate vertical bond energy contribution
-  tn.GenerateBMPSApproach(LEFT, trunc_para);
-  for (size_t col = 0; col < tn.cols(); col++) {
+  const BMPSPOSITION col_move = tn.GenerateBMPSForColPass(trunc_para, WaveFunctionComponentType::ReuseSweepBMPS());
+  for (size_t i = 0; i < tn.cols(); i++) {
+    const size_t col = tn.ColPassCol(col_move, i);
     tn.InitBTen(UP, col);
     tn.GrowFullBTen(DOWN, col, 2, true);
     tps_sample->amplitude = tn.Trace({0, col}, VERTICAL);
@@ -141,8 +142,8 @@ TenElemT SpinOneHalfHeisenbergSquare<TenElemT, QNT>::CalEnergyAndHoles(const SIT
         tn.BTenMoveStep(DOWN);
       }
     }
-    if (col < tn.cols() - 1) {
-      tn.BMPSMoveStep(RIGHT, trunc_para);
+    if (i < tn.cols() - 1) {
+      tn.BMPSMoveStep(col_move, trunc_para);
     }
   }
   WaveFunctionAmplitudeConsistencyCheck(psi_gather, 0.01);
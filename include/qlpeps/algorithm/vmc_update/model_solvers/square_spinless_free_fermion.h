@@ -80,6 +80,8 @@ TenElemT SquareSpinlessFreeFermion<TenElemT, QNT>::CalEnergyAndHoles(const SITPS
   for (size_t row = 0; row < tn.rows(); row++) {
     tn.InitBTen(LEFT, row);
     tn.GrowFullBTen(RIGHT, row, 1, true);
+    // recompute the amplitude dividing the holes, the sweep may have contracted it with sweep_trun_para
+    tps_sample->amplitude = tn.Trace({row, 0}, HORIZONTAL);
     for (size_t col = 0; col < tn.cols(); col++) {
       const SiteIdx site1 = {row, col};
       //Calculate the holes
@@ -102,8 +104,9 @@ TenElemT SquareSpinlessFreeFermion<TenElemT, QNT>::CalEnergyAndHoles(const SITPS
     }
   }
 
-  tn.GenerateBMPSApproach(LEFT, trunc_para);
-  for (size_t col = 0; col < tn.cols(); col++) {
+  const BMPSPOSITION col_move = tn.GenerateBMPSForColPass(trunc_para, WaveFunctionComponentType::ReuseSweepBMPS());
+  for (size_t i = 0; i < tn.cols(); i++) {
+    const size_t col = tn.ColPassCol(col_move, i);
     tn.InitBTen(UP, col);
     tn.GrowFullBTen(DOWN, col, 2, true);
     for (size_t row = 0; row < tn.rows() - 1; row++) {
@@ -118,8 +121,8 @@ TenElemT SquareSpinlessFreeFermion<TenElemT, QNT>::CalEnergyAndHoles(const SITPS
         tn.BTenMoveStep(DOWN);
       }
     }
-    if (col < tn.cols() - 1) {
-      tn.BMPSMoveStep(RIGHT, trunc_para);
+    if (i < tn.cols() - 1) {
+      tn.BMPSMoveStep(col_move, trunc_para);
     }
   }
   return energy;
@@ -89,8 +89,7 @@ TenElemT TransverseIsingSquare<TenElemT, QNT>::CalEnergyAndHoles(const SITPS *sp
     }
   }
 
-  //vertical bond energy contribution
-  tn.GenerateBMPSApproach(LEFT, trunc_para);
+  //vertical bond energy contribution, diagonal in the configuration
   for (size_t col = 0; col < tn.cols(); col++) {
     for (size_t row = 0; row < tn.rows() - 1; row++) {
       const SiteIdx site1 = {row, col};
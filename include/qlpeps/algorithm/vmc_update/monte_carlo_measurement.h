@@ -279,7 +279,9 @@ MonteCarloMeasurementExecutor<TenElemT,
   MPI_Comm_rank(comm, &rank_);
   MPI_Comm_size(comm, &mpi_size_);
   WaveFunctionComponentType::trun_para = BMPSTruncatePara(measurement_para);
-  random_engine.seed(std::random_device{}() + rank_ * 10086);
+  WaveFunctionComponentType::sweep_trun_para = std::nullopt;
+  WaveFunctionComponentType::reuse_sweep_bmps = false;
+  random_engine = PhiloxEngine(SynchronizedRandomSeed(measurement_para.random_seed, comm_), rank_, 0);
   LoadTenData(mc_measure_para.wavefunction_path);
   InitConfigs_(mc_measure_para.wavefunction_path);
   ReserveSamplesDataSpace_();
@@ -303,8 +305,12 @@ MonteCarloMeasurementExecutor<TenElemT,
     tps_sample_(ly_, lx_),
     u_double_(0, 1), warm_up_(false),
     measurement_solver_(solver) {
+  MPI_Comm_rank(comm, &rank_);
+  MPI_Comm_size(comm, &mpi_size_);
   WaveFunctionComponentType::trun_para = BMPSTruncatePara(measurement_para);
-  random_engine.seed(std::random_device{}() + rank_ * 10086);
+  WaveFunctionComponentType::sweep_trun_para = std::nullopt;
+  WaveFunctionComponentType::reuse_sweep_bmps = false;
+  random_engine = PhiloxEngine(SynchronizedRandomSeed(measurement_para.random_seed, comm_), rank_, 0);
   InitConfigs_(mc_measure_para.wavefunction_path);
   ReserveSamplesDataSpace_();
   PrintExecutorInfo_();
@@ -529,7 +535,11 @@ void MonteCarloMeasurementExecutor<TenElemT,
     std::cout << "Loading configuration in rank " << rank_
               << " fails. Random generate it and warm up."
               << std::endl;
-    tps_sample_ = WaveFunctionComponentType(split_index_tps_, mc_measure_para.init_config);
+    Configuration init_config = mc_measure_para.init_config;
+    if (mc_measure_para.init_occupancy.has_value()) {
+      init_config.Random(mc_measure_para.init_occupancy.value()); // from the seeded stream of the process
+    }
+    tps_sample_ = WaveFunctionComponentType(split_index_tps_, init_config);
     warm_up_ = false;
   }
 }
@@ -0,0 +1,402 @@
+// SPDX-License-Identifier: LGPL-3.0-only
+
+/*
+* Author: Hao-Xin Wang<wanghaoxin1996@gmail.com>
+* Creation Date: 2024-10-16
+*
+* Description: QuantumLiquids/PEPS project. SMatrix in Stochastic Reconfiguration,
+* with the O_k samples stored in contiguous dense matrices.
+*/
+
+
+#ifndef QLPEPS_VMC_PEPS_STOCHASTIC_RECONFIGURATION_DENSE_SMATRIX_H
+#define QLPEPS_VMC_PEPS_STOCHASTIC_RECONFIGURATION_DENSE_SMATRIX_H
+
+#if defined(USE_OPENBLAS)
+#include <cblas.h>                              // Use CBLAS header
+#else
+#include "mkl_cblas.h"                          // Use MKL header
+#endif
+
+#include <complex>
+#include <type_traits>
+#include "qlpeps/two_dim_tn/tps/split_index_tps.h"
+
+namespace qlpeps {
+using namespace qlten;
+
+/**
+ * S matrix of stochastic reconfiguration, whose samples are stored in dense matrices.
+ *
+ * A sample O_k only has non-zero components on the configured physical basis of each site.
+ * So the samples are grouped by (site, basis): the samples with the same basis on the site
+ * form the rows of a contiguous row-major matrix, in which each row is the (complex conjugated)
+ * flattened data of the tensor. The tensors are aligned to the layout with all the blocks allowed
+ * by the divergence of the split index TPS, the same layout of the gradient.
+ *
+ * The multiplication on a vector costs two GEMV calls per (site, basis) block,
+ * w = conj(O) v and res = O^T w, without any temporary SplitIndexTPS for the samples.
+ * The samples can be stored in single precision to halve the memory, while the reduction
+ * and the vectors used by the conjugate gradient solver are kept in double precision.
+ *
+ * Only bosonic tensors are supported, as the inner product of fermionic SplitIndexTPS
+ * carries the parity signs which are not simple elementwise products.
+ *
+ * The interface of multiplication is the same as SRSMatrix, so it works with ConjugateGradientSolver.
+ */
+template<typename TenElemT, typename QNT>
+class SRDenseSMatrix {
+  using Tensor = QLTensor<TenElemT, QNT>;
+  using SITPS = SplitIndexTPS<TenElemT, QNT>;
+  using FloatElemT = std::conditional_t<std::is_same_v<TenElemT, QLTEN_Complex>, std::complex<float>, float>;
+ public:
+  SRDenseSMatrix(void) = default;
+
+  /**
+   * @param sitps             gives the tensor layout of the samples
+   * @param single_precision  store the samples in single precision
+   */
+  SRDenseSMatrix(const SITPS &sitps, const bool single_precision) : single_precision_(single_precision) {
+    Reset(sitps);
+  }
+
+  ///< Clear the samples and align the storage to the layout of sitps.
+  void Reset(const SITPS &sitps) {
+    rows_ = sitps.rows();
+    cols_ = sitps.cols();
+    zero_layout_ = SITPS(rows_, cols_);
+    block_offset_.assign(rows_ * cols_ + 1, 0);
+    for (size_t row = 0; row < rows_; row++) {
+      for (size_t col = 0; col < cols_; col++) {
+        const size_t phy_dim = sitps({row, col}).size();
+        zero_layout_({row, col}) = std::vector<Tensor>(phy_dim);
+        for (size_t compt = 0; compt < phy_dim; compt++) {
+          zero_layout_({row, col})[compt] = ZeroTensorWithAllBlocks(sitps({row, col})[compt]);
+        }
+        block_offset_[row * cols_ + col + 1] = block_offset_[row * cols_ + col] + phy_dim;
+      }
+    }
+    blocks_ = std::vector<Block_>(block_offset_.back());
+    for (size_t row = 0; row < rows_; row++) {
+      for (size_t col = 0; col < cols_; col++) {
+        for (size_t compt = 0; compt < zero_layout_({row, col}).size(); compt++) {
+          const Tensor &ten = zero_layout_({row, col})[compt];
+          blocks_[BlockIdx_({row, col}, compt)].data_size = ten.IsDefault() ? 0 : ten.GetActualDataSize();
+        }
+      }
+    }
+    num_samples_ = 0;
+  }
+
+  ///< Add the tensor of the current sample on the site with physical basis compt.
+  void AddSampleTensor(const SiteIdx &site, const size_t compt, const Tensor &gten) {
+    Block_ &block = blocks_[BlockIdx_(site, compt)];
+    if (block.data_size == 0) {
+      return;
+    }
+    std::vector<TenElemT> aligned_buffer;
+    const TenElemT *pdata = AlignedData_(site, compt, gten, aligned_buffer);
+    const size_t n = block.data_size;
+    if (single_precision_) {
+      const size_t offset = block.data_f.size();
+      block.data_f.resize(offset + n);
+      for (size_t i = 0; i < n; i++) {
+        block.data_f[offset + i] = static_cast<FloatElemT>(Conj_(pdata[i]));
+      }
+    } else {
+      const size_t offset = block.data.size();
+      block.data.resize(offset + n);
+      for (size_t i = 0; i < n; i++) {
+        block.data[offset + i] = Conj_(pdata[i]);
+      }
+    }
+    block.sample_idx.push_back(num_samples_);
+  }
+
+  ///< Finish adding the tensors of the current sample.
+  void FinishSample(void) {
+    num_samples_++;
+  }
+
+  size_t SampleNum(void) const { return num_samples_; }
+
+  ///< Remove the samples, but keep the layout and the allocated storage.
+  void ClearSamples(void) {
+    for (Block_ &block : blocks_) {
+      block.sample_idx.clear();
+      block.data.clear();
+      block.data_f.clear();
+    }
+    num_samples_ = 0;
+  }
+
+  ///< Append the samples of other, which has the same layout and precision, after the samples of this matrix.
+  void AppendSamples(const SRDenseSMatrix &other) {
+    for (size_t i = 0; i < blocks_.size(); i++) {
+      Block_ &block = blocks_[i];
+      const Block_ &other_block = other.blocks_[i];
+      for (const size_t idx : other_block.sample_idx) {
+        block.sample_idx.push_back(num_samples_ + idx);
+      }
+      block.data.insert(block.data.end(), other_block.data.cbegin(), other_block.data.cend());
+      block.data_f.insert(block.data_f.end(), other_block.data_f.cbegin(), other_block.data_f.cend());
+    }
+    num_samples_ += other.num_samples_;
+  }
+
+  ///< Memory occupied by the samples, in byte.
+  size_t SampleMemory(void) const {
+    size_t bytes = 0;
+    for (const Block_ &block : blocks_) {
+      bytes += block.data.size() * sizeof(TenElemT) + block.data_f.size() * sizeof(FloatElemT);
+    }
+    return bytes;
+  }
+
+  ///< gten_ave should only be set in master; world_size is used to average the samples over processes.
+  void SetAverageAndWorldSize(SITPS *gten_ave, const size_t world_size) {
+    gten_ave_ = gten_ave;
+    world_size_ = world_size;
+  }
+
+  SITPS operator*(const SITPS &v0) const {
+    SITPS res = LinearCombineSamples(SampleInnerProducts(v0));
+    res *= 1.0 / double(num_samples_ * world_size_);
+    if (gten_ave_ != nullptr) { //kMPIMasterRank
+      res += (-((*gten_ave_) * v0)) * (*gten_ave_);
+      if (diag_shift != 0.0) {
+        res += (diag_shift * v0);
+      }
+    }
+    return res;
+  }
+
+  ///< The inner products g_i * v for all the samples g_i, by GEMV conj(O) v.
+  std::vector<TenElemT> SampleInnerProducts(const SITPS &v) const {
+    std::vector<TenElemT> w(num_samples_, TenElemT(0.0));
+    std::vector<TenElemT> aligned_buffer, y;
+    std::vector<FloatElemT> v_f, y_f;
+    for (size_t row = 0; row < rows_; row++) {
+      for (size_t col = 0; col < cols_; col++) {
+        for (size_t compt = 0; compt < zero_layout_({row, col}).size(); compt++) {
+          const Block_ &block = blocks_[BlockIdx_({row, col}, compt)];
+          const size_t m = block.sample_idx.size(), n = block.data_size;
+          if (m == 0 || v({row, col})[compt].IsDefault()) {
+            continue;
+          }
+          const TenElemT *pv = AlignedData_({row, col}, compt, v({row, col})[compt], aligned_buffer);
+          if (single_precision_) {
+            v_f.assign(pv, pv + n);
+            y_f.resize(m);
+            Gemv_(false, m, n, block.data_f.data(), v_f.data(), y_f.data());
+            for (size_t i = 0; i < m; i++) {
+              w[block.sample_idx[i]] += static_cast<TenElemT>(y_f[i]);
+            }
+          } else {
+            y.resize(m);
+            Gemv_(false, m, n, block.data.data(), pv, y.data());
+            for (size_t i = 0; i < m; i++) {
+              w[block.sample_idx[i]] += y[i];
+            }
+          }
+        }
+      }
+    }
+    return w;
+  }
+
+  ///< The linear combination sum_i g_i * coefs[i] of the samples, by GEMV O^T coefs.
+  SITPS LinearCombineSamples(const std::vector<TenElemT> &coefs) const {
+    SITPS res(zero_layout_);
+    std::vector<TenElemT> w_sub;
+    std::vector<FloatElemT> w_sub_f, res_f;
+    for (size_t row = 0; row < rows_; row++) {
+      for (size_t col = 0; col < cols_; col++) {
+        for (size_t compt = 0; compt < zero_layout_({row, col}).size(); compt++) {
+          const Block_ &block = blocks_[BlockIdx_({row, col}, compt)];
+          const size_t m = block.sample_idx.size(), n = block.data_size;
+          if (m == 0) {
+            continue;
+          }
+          TenElemT *pres = res({row, col})[compt].GetRawDataPtr();
+          if (single_precision_) {
+            w_sub_f.resize(m);
+            for (size_t i = 0; i < m; i++) {
+              w_sub_f[i] = static_cast<FloatElemT>(coefs[block.sample_idx[i]]);
+            }
+            res_f.resize(n);
+            Gemv_(true, m, n, block.data_f.data(), w_sub_f.data(), res_f.data());
+            for (size_t j = 0; j < n; j++) {
+              pres[j] = static_cast<TenElemT>(res_f[j]);
+            }
+          } else {
+            w_sub.resize(m);
+            for (size_t i = 0; i < m; i++) {
+              w_sub[i] = coefs[block.sample_idx[i]];
+            }
+            Gemv_(true, m, n, block.data.data(), w_sub.data(), pres);
+          }
+        }
+      }
+    }
+    return res;
+  }
+
+  /**
+   * The rows conj(g_i) stored in the block of (site, compt), in double precision.
+   * buffer is used only if the samples are stored in single precision.
+   */
+  const TenElemT *BlockRows(const SiteIdx &site, const size_t compt,
+                            size_t &row_num, std::vector<TenElemT> &buffer) const {
+    const Block_ &block = blocks_[BlockIdx_(site, compt)];
+    row_num = block.sample_idx.size();
+    if (single_precision_) {
+      buffer.assign(block.data_f.cbegin(), block.data_f.cend());
+      return buffer.data();
+    }
+    return block.data.data();
+  }
+
+  ///< Samples packed in contiguous buffers, used to exchange the samples between processes
+  struct PackedSamples {
+    size_t sample_num = 0;
+    std::vector<size_t> block_rows;   // number of rows in each block
+    std::vector<size_t> sample_idx;   // sample indices of the rows, concatenated over the blocks
+    std::vector<TenElemT> data;       // data of the rows in double precision, concatenated over the blocks
+  };
+
+  PackedSamples PackSamples(void) const {
+    PackedSamples packed;
+    packed.sample_num = num_samples_;
+    packed.block_rows.reserve(blocks_.size());
+    for (const Block_ &block : blocks_) {
+      packed.block_rows.push_back(block.sample_idx.size());
+      packed.sample_idx.insert(packed.sample_idx.end(), block.sample_idx.cbegin(), block.sample_idx.cend());
+      if (single_precision_) {
+        packed.data.insert(packed.data.end(), block.data_f.cbegin(), block.data_f.cend());
+      } else {
+        packed.data.insert(packed.data.end(), block.data.cbegin(), block.data.cend());
+      }
+    }
+    return packed;
+  }
+
+  /**
+   * Add the inner products g_i * g'_j between the samples g_i here and the samples g'_j in other,
+   * which have the same block layout, by one GEMM per block:
+   *        gram[i * ld + col_offset + j] += g_i * g'_j
+   */
+  void AccumulateGram(const PackedSamples &other, TenElemT *gram, const size_t ld, const size_t col_offset) const {
+    std::vector<TenElemT> block_gram, rows_buffer;
+    size_t idx_offset = 0, data_offset = 0;
+    for (size_t b = 0; b < blocks_.size(); b++) {
+      const Block_ &block = blocks_[b];
+      const size_t m = block.sample_idx.size(), m_other = other.block_rows[b], n = block.data_size;
+      if (m > 0 && m_other > 0) {
+        const TenElemT *prows = block.data.data();
+        if (single_precision_) {
+          rows_buffer.assign(block.data_f.cbegin(), block.data_f.cend());
+          prows = rows_buffer.data();
+        }
+        block_gram.resize(m * m_other);
+        // the rows are conj(g), so g_i * g'_j = (rows * rows'^dagger)_ij
+        Gemm_(m, m_other, n, prows, other.data.data() + data_offset, block_gram.data());
+        for (size_t i = 0; i < m; i++) {
+          TenElemT *pgram_row = gram + block.sample_idx[i] * ld + col_offset;
+          for (size_t j = 0; j < m_other; j++) {
+            pgram_row[other.sample_idx[idx_offset + j]] += block_gram[i * m_other + j];
+          }
+        }
+      }
+      idx_offset += m_other;
+      data_offset += m_other * n;
+    }
+  }
+
+  TenElemT diag_shift = 0.0;
+ private:
+  struct Block_ {
+    size_t data_size = 0;              // number of elements in a row
+    std::vector<size_t> sample_idx;    // sample index of each row
+    std::vector<TenElemT> data;        // row-major, complex conjugated samples
+    std::vector<FloatElemT> data_f;    // the same in single precision
+  };
+
+  size_t BlockIdx_(const SiteIdx &site, const size_t compt) const {
+    return block_offset_[site.row() * cols_ + site.col()] + compt;
+  }
+
+  /**
+   * Raw data of ten in the aligned layout. If the block structure of ten is different from
+   * the aligned one, ten is added to a zero tensor with all blocks and copied into buffer.
+   */
+  const TenElemT *AlignedData_(const SiteIdx &site, const size_t compt,
+                               const Tensor &ten, std::vector<TenElemT> &buffer) const {
+    const Tensor &zero_ten = zero_layout_(site)[compt];
+    if (ten.GetActualDataSize() == zero_ten.GetActualDataSize()) {
+      return ten.GetRawDataPtr();
+    }
+    Tensor aligned_ten = zero_ten;
+    aligned_ten += ten;
+    buffer.assign(aligned_ten.GetRawDataPtr(), aligned_ten.GetRawDataPtr() + aligned_ten.GetActualDataSize());
+    return buffer.data();
+  }
+
+  template<typename T>
+  static T Conj_(const T &x) {
+    if constexpr (std::is_same_v<T, QLTEN_Complex>) {
+      return std::conj(x);
+    } else {
+      return x;
+    }
+  }
+
+  ///< c = a * b^dagger, a is m * k and b is n * k, both row-major.
+  static void Gemm_(const size_t m, const size_t n, const size_t k,
+                    const double *a, const double *b, double *c) {
+    cblas_dgemm(CblasRowMajor, CblasNoTrans, CblasTrans, m, n, k, 1.0, a, k, b, k, 0.0, c, n);
+  }
+
+  static void Gemm_(const size_t m, const size_t n, const size_t k,
+                    const std::complex<double> *a, const std::complex<double> *b, std::complex<double> *c) {
+    const std::complex<double> alpha(1.0), beta(0.0);
+    cblas_zgemm(CblasRowMajor, CblasNoTrans, CblasConjTrans, m, n, k, &alpha, a, k, b, k, &beta, c, n);
+  }
+
+  ///< y = A x (trans = false) or y = A^dagger x (trans = true), A is m * n row-major.
+  static void Gemv_(const bool trans, const size_t m, const size_t n,
+                    const double *a, const double *x, double *y) {
+    cblas_dgemv(CblasRowMajor, trans ? CblasTrans : CblasNoTrans, m, n, 1.0, a, n, x, 1, 0.0, y, 1);
+  }
+
+  static void Gemv_(const bool trans, const size_t m, const size_t n,
+                    const float *a, const float *x, float *y) {
+    cblas_sgemv(CblasRowMajor, trans ? CblasTrans : CblasNoTrans, m, n, 1.0f, a, n, x, 1, 0.0f, y, 1);
+  }
+
+  static void Gemv_(const bool trans, const size_t m, const size_t n,
+                    const std::complex<double> *a, const std::complex<double> *x, std::complex<double> *y) {
+    const std::complex<double> alpha(1.0), beta(0.0);
+    cblas_zgemv(CblasRowMajor, trans ? CblasConjTrans : CblasNoTrans, m, n, &alpha, a, n, x, 1, &beta, y, 1);
+  }
+
+  static void Gemv_(const bool trans, const size_t m, const size_t n,
+                    const std::complex<float> *a, const std::complex<float> *x, std::complex<float> *y) {
+    const std::complex<float> alpha(1.0f), beta(0.0f);
+    cblas_cgemv(CblasRowMajor, trans ? CblasConjTrans : CblasNoTrans, m, n, &alpha, a, n, x, 1, &beta, y, 1);
+  }
+
+  bool single_precision_ = false;
+  size_t rows_ = 0;
+  size_t cols_ = 0;
+  SITPS zero_layout_;
+  std::vector<size_t> block_offset_;
+  std::vector<Block_> blocks_;
+  size_t num_samples_ = 0;
+  SITPS *gten_ave_ = nullptr;
+  size_t world_size_ = 1;
+};
+
+}//qlpeps
+
+#endif //QLPEPS_VMC_PEPS_STOCHASTIC_RECONFIGURATION_DENSE_SMATRIX_H
@@ -0,0 +1,343 @@
+// SPDX-License-Identifier: LGPL-3.0-only
+
+/*
+* Author: Hao-Xin Wang<wanghaoxin1996@gmail.com>
+* Creation Date: 2024-10-16
+*
+* Description: QuantumLiquids/PEPS project. Preconditioners of the S matrix in Stochastic Reconfiguration,
+* built from the O_k samples.
+*/
+
+#ifndef QLPEPS_VMC_PEPS_STOCHASTIC_RECONFIGURATION_PRECONDITIONER_H
+#define QLPEPS_VMC_PEPS_STOCHASTIC_RECONFIGURATION_PRECONDITIONER_H
+
+#if defined(USE_OPENBLAS)
+#include <lapacke.h>
+#else
+#include "mkl_lapacke.h"                        // Use MKL header
+#endif
+
+#include <complex>
+#include <type_traits>
+#include "qlten/framework/hp_numeric/mpi_fun.h"                    //GetMPIDataType
+#include "qlpeps/two_dim_tn/tps/split_index_tps.h"
+#include "qlpeps/algorithm/vmc_update/vmc_optimize_para.h"         //SRPreconditionerType
+
+namespace qlpeps {
+using namespace qlten;
+
+/**
+ * Preconditioner M of the S matrix
+ *        S = <g g^dag> - <g><g>^dag + diag_shift,
+ * where g are the samples of O_k. The tensors of the samples are aligned to the layout with all the blocks,
+ * as SRDenseSMatrix does, and each (site, physical component) is a block of S.
+ *
+ * JacobiSRPreconditioner keeps the diagonal of S; SiteBlockSRPreconditioner keeps the diagonal blocks
+ * of S for each (site, component), which are Cholesky factorized once when built. The memory of the
+ * latter is the square of the block sizes, so it is meant for the small bond dimensions.
+ *
+ * Usage: Reset, then add the samples in all the processes, then Build. The call operator returns M^{-1} r,
+ * in master only, or in all the processes if built with all_processes = true.
+ * Only bosonic tensors are supported, as the S matrix of fermionic tensors is not elementwise.
+ */
+template<typename TenElemT, typename QNT>
+class SRPreconditioner {
+  using Tensor = QLTensor<TenElemT, QNT>;
+  using SITPS = SplitIndexTPS<TenElemT, QNT>;
+ public:
+  SRPreconditioner(void) = default;
+
+  explicit SRPreconditioner(const SRPreconditionerType type) : type_(type) {}
+
+  SRPreconditionerType Type(void) const { return type_; }
+
+  ///< Clear the samples and align the storage to the layout of sitps.
+  void Reset(const SITPS &sitps) {
+    rows_ = sitps.rows();
+    cols_ = sitps.cols();
+    zero_layout_ = SITPS(rows_, cols_);
+    block_offset_.assign(rows_ * cols_ + 1, 0);
+    for (size_t row = 0; row < rows_; row++) {
+      for (size_t col = 0; col < cols_; col++) {
+        const size_t phy_dim = sitps({row, col}).size();
+        zero_layout_({row, col}) = std::vector<Tensor>(phy_dim);
+        for (size_t compt = 0; compt < phy_dim; compt++) {
+          zero_layout_({row, col})[compt] = ZeroTensorWithAllBlocks(sitps({row, col})[compt]);
+        }
+        block_offset_[row * cols_ + col + 1] = block_offset_[row * cols_ + col] + phy_dim;
+      }
+    }
+    blocks_ = std::vector<Block_>(block_offset_.back());
+    for (size_t row = 0; row < rows_; row++) {
+      for (size_t col = 0; col < cols_; col++) {
+        for (size_t compt = 0; compt < zero_layout_({row, col}).size(); compt++) {
+          const Tensor &ten = zero_layout_({row, col})[compt];
+          Block_ &block = blocks_[BlockIdx_({row, col}, compt)];
+          block.data_size = ten.IsDefault() ? 0 : ten.GetActualDataSize();
+          block.data.assign(type_ == SiteBlockSRPreconditioner ? block.data_size * block.data_size : block.data_size,
+                            TenElemT(0.0));
+        }
+      }
+    }
+    sample_num_ = 0;
+  }
+
+  ///< Add a sample g stored as a SplitIndexTPS.
+  void AddSample(const SITPS &gten_sample) {
+    std::vector<TenElemT> aligned_buffer;
+    for (size_t row = 0; row < rows_; row++) {
+      for (size_t col = 0; col < cols_; col++) {
+        for (size_t compt = 0; compt < zero_layout_({row, col}).size(); compt++) {
+          const Tensor &ten = gten_sample({row, col})[compt];
+          Block_ &block = blocks_[BlockIdx_({row, col}, compt)];
+          if (block.data_size == 0 || ten.IsDefault()) {
+            continue;
+          }
+          AccumulateRow_(block, AlignedData_({row, col}, compt, ten, aligned_buffer), false);
+        }
+      }
+    }
+    sample_num_++;
+  }
+
+  /**
+   * Add the rows conj(g_i) on the (site, compt) block, as stored by SRDenseSMatrix.
+   * The number of the samples is added separately by AddSampleNum.
+   */
+  void AddConjugateRows(const SiteIdx &site, const size_t compt, const TenElemT *rows, const size_t row_num) {
+    Block_ &block = blocks_[BlockIdx_(site, compt)];
+    for (size_t i = 0; i < row_num; i++) {
+      AccumulateRow_(block, rows + i * block.data_size, true);
+    }
+  }
+
+  void AddSampleNum(const size_t sample_num) { sample_num_ += sample_num; }
+
+  /**
+   * Sum the samples over the processes and build the preconditioner in master.
+   *
+   * @param gten_ave        <g>, only needed in master
+   * @param all_processes   broadcast the preconditioner so that it works in all the processes
+   */
+  void Build(const SITPS *gten_ave, const TenElemT diag_shift, const MPI_Comm &comm, const bool all_processes) {
+    int rank;
+    MPI_Comm_rank(comm, &rank);
+    std::vector<TenElemT> buffer = Pack_();
+    buffer.push_back(TenElemT(double(sample_num_)));
+    HANDLE_MPI_ERROR(::MPI_Reduce(rank == kMPIMasterRank ? MPI_IN_PLACE : buffer.data(), buffer.data(),
+                                  buffer.size(), hp_numeric::GetMPIDataType<TenElemT>(), MPI_SUM,
+                                  kMPIMasterRank, comm));
+    if (rank == kMPIMasterRank) {
+      sample_num_ = size_t(std::real(buffer.back()) + 0.5);
+      Unpack_(buffer);
+      Build(*gten_ave, diag_shift);
+    }
+    if (all_processes) {
+      buffer = Pack_();
+      HANDLE_MPI_ERROR(::MPI_Bcast(buffer.data(), buffer.size(), hp_numeric::GetMPIDataType<TenElemT>(),
+                                   kMPIMasterRank, comm));
+      if (rank != kMPIMasterRank) {
+        Unpack_(buffer);
+      }
+    }
+  }
+
+  ///< Build the preconditioner from the samples added in this process only.
+  void Build(const SITPS &gten_ave, const TenElemT diag_shift) {
+    std::vector<TenElemT> aligned_buffer;
+    size_t failed_blocks = 0;
+    for (size_t row = 0; row < rows_; row++) {
+      for (size_t col = 0; col < cols_; col++) {
+        for (size_t compt = 0; compt < zero_layout_({row, col}).size(); compt++) {
+          Block_ &block = blocks_[BlockIdx_({row, col}, compt)];
+          if (block.data_size == 0) {
+            continue;
+          }
+          const Tensor &ave_ten = gten_ave({row, col})[compt];
+          const TenElemT *pave = ave_ten.IsDefault() ? nullptr :
+                                 AlignedData_({row, col}, compt, ave_ten, aligned_buffer);
+          if (!FinalizeBlock_(block, pave, double(sample_num_), diag_shift)) {
+            failed_blocks++;
+          }
+        }
+      }
+    }
+    if (failed_blocks > 0) {
+      std::cout << "warning: " << failed_blocks
+                << " blocks of the SR preconditioner are not positive definite, replaced by identity."
+                << std::endl;
+    }
+  }
+
+  ///< M^{-1} r
+  SITPS operator()(const SITPS &r) const {
+    SITPS z(zero_layout_);
+    std::vector<TenElemT> aligned_buffer;
+    for (size_t row = 0; row < rows_; row++) {
+      for (size_t col = 0; col < cols_; col++) {
+        for (size_t compt = 0; compt < zero_layout_({row, col}).size(); compt++) {
+          const Block_ &block = blocks_[BlockIdx_({row, col}, compt)];
+          const Tensor &r_ten = r({row, col})[compt];
+          if (block.data_size == 0 || r_ten.IsDefault()) {
+            continue;
+          }
+          const size_t n = block.data_size;
+          const TenElemT *pr = AlignedData_({row, col}, compt, r_ten, aligned_buffer);
+          TenElemT *pz = z({row, col})[compt].GetRawDataPtr();
+          if (type_ == SiteBlockSRPreconditioner) {
+            std::copy(pr, pr + n, pz);
+            CholeskySolve_(n, block.data.data(), pz);
+          } else {
+            for (size_t j = 0; j < n; j++) {
+              pz[j] = block.data[j] * pr[j];
+            }
+          }
+        }
+      }
+    }
+    return z;
+  }
+
+ private:
+  struct Block_ {
+    size_t data_size = 0;          // number of elements of the aligned tensor
+    std::vector<TenElemT> data;    // second moments when adding samples; inverse diagonal or Cholesky factor after built
+  };
+
+  size_t BlockIdx_(const SiteIdx &site, const size_t compt) const {
+    return block_offset_[site.row() * cols_ + site.col()] + compt;
+  }
+
+  ///< Add g g^dag (only the diagonal for Jacobi) of one sample, where g = conj(row) if conj_row.
+  void AccumulateRow_(Block_ &block, const TenElemT *row, const bool conj_row) {
+    const size_t n = block.data_size;
+    if (type_ == SiteBlockSRPreconditioner) {
+      for (size_t j = 0; j < n; j++) {
+        const TenElemT gj = conj_row ? Conj_(row[j]) : row[j];
+        TenElemT *pdata = block.data.data() + j * n;
+        for (size_t k = 0; k < n; k++) {
+          pdata[k] += gj * (conj_row ? row[k] : Conj_(row[k]));
+        }
+      }
+    } else {
+      for (size_t j = 0; j < n; j++) {
+        block.data[j] += std::norm(row[j]);
+      }
+    }
+  }
+
+  /**
+   * Turn the summed second moments into the inverse diagonal (Jacobi) or the Cholesky factor (block) of
+   * S = moments / sample_num - <g><g>^dag + diag_shift. Non positive definite parts are replaced by identity.
+   * @return whether the block is positive definite
+   */
+  bool FinalizeBlock_(Block_ &block, const TenElemT *pave, const double sample_num, const TenElemT diag_shift) {
+    const size_t n = block.data_size;
+    const double inv_num = 1.0 / sample_num;
+    if (type_ == SiteBlockSRPreconditioner) {
+      for (size_t j = 0; j < n; j++) {
+        for (size_t k = 0; k < n; k++) {
+          TenElemT &s = block.data[j * n + k];
+          s *= inv_num;
+          if (pave != nullptr) {
+            s -= pave[j] * Conj_(pave[k]);
+          }
+        }
+        block.data[j * n + j] += diag_shift;
+      }
+      if (CholeskyFactorize_(n, block.data.data()) != 0) {
+        std::fill(block.data.begin(), block.data.end(), TenElemT(0.0));
+        for (size_t j = 0; j < n; j++) {
+          block.data[j * n + j] = TenElemT(1.0);
+        }
+        return false;
+      }
+      return true;
+    }
+    bool positive = true;
+    for (size_t j = 0; j < n; j++) {
+      double s = std::real(block.data[j]) * inv_num + std::real(diag_shift);
+      if (pave != nullptr) {
+        s -= std::norm(pave[j]);
+      }
+      if (s > 0) {
+        block.data[j] = TenElemT(1.0 / s);
+      } else {
+        block.data[j] = TenElemT(1.0);
+        positive = false;
+      }
+    }
+    return positive;
+  }
+
+  std::vector<TenElemT> Pack_(void) const {
+    std::vector<TenElemT> buffer;
+    for (const Block_ &block : blocks_) {
+      buffer.insert(buffer.end(), block.data.cbegin(), block.data.cend());
+    }
+    return buffer;
+  }
+
+  void Unpack_(const std::vector<TenElemT> &buffer) {
+    const TenElemT *pdata = buffer.data();
+    for (Block_ &block : blocks_) {
+      std::copy(pdata, pdata + block.data.size(), block.data.begin());
+      pdata += block.data.size();
+    }
+  }
+
+  ///< Raw data of ten in the aligned layout, the same as SRDenseSMatrix.
+  const TenElemT *AlignedData_(const SiteIdx &site, const size_t compt,
+                               const Tensor &ten, std::vector<TenElemT> &buffer) const {
+    const Tensor &zero_ten = zero_layout_(site)[compt];
+    if (ten.GetActualDataSize() == zero_ten.GetActualDataSize()) {
+      return ten.GetRawDataPtr();
+    }
+    Tensor aligned_ten = zero_ten;
+    aligned_ten += ten;
+    buffer.assign(aligned_ten.GetRawDataPtr(), aligned_ten.GetRawDataPtr() + aligned_ten.GetActualDataSize());
+    return buffer.data();
+  }
+
+  template<typename T>
+  static T Conj_(const T &x) {
+    if constexpr (std::is_same_v<T, QLTEN_Complex>) {
+      return std::conj(x);
+    } else {
+      return x;
+    }
+  }
+
+  ///< In-place Cholesky factorization of the n x n row-major Hermitian matrix a.
+  static lapack_int CholeskyFactorize_(const size_t n, TenElemT *a) {
+    if constexpr (std::is_same_v<TenElemT, QLTEN_Double>) {
+      return LAPACKE_dpotrf(LAPACK_ROW_MAJOR, 'U', lapack_int(n), a, lapack_int(n));
+    } else {
+      return LAPACKE_zpotrf(LAPACK_ROW_MAJOR, 'U', lapack_int(n),
+                            reinterpret_cast<lapack_complex_double *>(a), lapack_int(n));
+    }
+  }
+
+  ///< b = a^{-1} b, a factorized by CholeskyFactorize_.
+  static void CholeskySolve_(const size_t n, const TenElemT *a, TenElemT *b) {
+    if constexpr (std::is_same_v<TenElemT, QLTEN_Double>) {
+      LAPACKE_dpotrs(LAPACK_ROW_MAJOR, 'U', lapack_int(n), 1, a, lapack_int(n), b, 1);
+    } else {
+      LAPACKE_zpotrs(LAPACK_ROW_MAJOR, 'U', lapack_int(n), 1,
+                     reinterpret_cast<const lapack_complex_double *>(a), lapack_int(n),
+                     reinterpret_cast<lapack_complex_double *>(b), 1);
+    }
+  }
+
+  SRPreconditionerType type_ = NoSRPreconditioner;
+  size_t rows_ = 0;
+  size_t cols_ = 0;
+  SITPS zero_layout_;
+  std::vector<size_t> block_offset_;
+  std::vector<Block_> blocks_;
+  size_t sample_num_ = 0;
+};
+
+}//qlpeps
+
+#endif //QLPEPS_VMC_PEPS_STOCHASTIC_RECONFIGURATION_PRECONDITIONER_H
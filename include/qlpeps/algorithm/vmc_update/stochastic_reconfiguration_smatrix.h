@@ -31,8 +31,9 @@ class SRSMatrix {
       world_size_(world_size) {}
 
   SITPS operator*(const SITPS &v0) const {
-    SITPS res = (*gten_samples_)[0] * ((*gten_samples_)[0] * v0);
-    for (size_t i = 1; i < gten_samples_->size(); i++) {
+    // start from zeros with all blocks, so that the results in all processes share the data layout
+    SITPS res = ZeroSplitIndexTPSWithAllBlocks(v0);
+    for (size_t i = 0; i < gten_samples_->size(); i++) {
       res += (*gten_samples_)[i] * ((*gten_samples_)[i] * v0);
     }
     res *= 1.0 / double(gten_samples_->size() * world_size_);
@@ -12,9 +12,13 @@
 #define QLPEPS_ALGORITHM_VMC_UPDATE_VMC_OPTIMIZE_PARA_H
 
 #include <vector>
+#include <optional>
+#include <cstdint>                                   //uint64_t
 #include "qlpeps/consts.h"                        //kTpsPath
 #include "qlpeps/two_dim_tn/tps/configuration.h"  //Configuration
 #include "qlpeps/ond_dim_tn/boundary_mps/bmps.h"  //BMPSTruncatePara
+#include "qlpeps/utility/fused_accumulation.h"        //SumAccumulationScheme
+#include "qlpeps/utility/conjugate_gradient_solver.h" //ConjugateGradientParallelScheme
 
 namespace qlpeps {
 
@@ -27,7 +31,12 @@ enum WAVEFUNCTION_UPDATE_SCHEME {
   RandomGradientElement,                  //5
   BoundGradientElement,                   //6
   GradientLineSearch,                     //7
-  NaturalGradientLineSearch               //8
+  NaturalGradientLineSearch,              //8
+  MinimumStochasticReconfiguration,       //9, MinSR, solve the natural gradient in the sample space
+  Momentum,                               //10, heavy-ball momentum on the gradient
+  Adam,                                   //11
+  AMSGrad,                                //12, Adam with the non-decreasing second moment
+  StochasticReconfigurationMomentum       //13, SPRING-like SR, regularized towards the previous update
 };
 
 // Function to convert enum to string
@@ -42,27 +51,144 @@ std::string WavefunctionUpdateSchemeString(WAVEFUNCTION_UPDATE_SCHEME scheme) {
     case BoundGradientElement:return "BoundGradientElement";
     case GradientLineSearch:return "GradientLineSearch";
     case NaturalGradientLineSearch:return "NaturalGradientLineSearch";
+    case MinimumStochasticReconfiguration:return "MinimumStochasticReconfiguration";
+    case Momentum:return "Momentum";
+    case Adam:return "Adam";
+    case AMSGrad:return "AMSGrad";
+    case StochasticReconfigurationMomentum:return "StochasticReconfigurationMomentum";
     default:return "Unknown scheme";
   }
 }
 
+///< Preconditioners of the S matrix in the conjugate gradient solver, built from the O_k samples
+enum SRPreconditionerType {
+  NoSRPreconditioner,         //0
+  JacobiSRPreconditioner,     //1, diagonal of S
+  SiteBlockSRPreconditioner   //2, diagonal blocks of S for each site and physical component, Cholesky factorized
+};
+
 ///< Conjugate gradient parameters used in Stochastic Reconfiguration update PEPS
 struct ConjugateGradientParams {
   size_t max_iter;
   double tolerance;
   int residue_restart_step;
   double diag_shift;
+  ConjugateGradientParallelScheme parallel_scheme = MasterSlaveCG;
+  size_t recycle_dim = 0;          // number of previous SR solutions recycled into the initial guess, 0 for off
+  bool recycle_benchmark = false;  // also run the plain CG to report the S * v products saved by the recycling
+  SRPreconditionerType preconditioner = NoSRPreconditioner; // rebuilt in each iteration, bosonic tensors only
 
   ConjugateGradientParams(void) = default;
 
-  ConjugateGradientParams(size_t max_iter, double tolerance, int residue_restart_step, double diag_shift)
-      : max_iter(max_iter), tolerance(tolerance), residue_restart_step(residue_restart_step), diag_shift(diag_shift) {}
+  ConjugateGradientParams(size_t max_iter, double tolerance, int residue_restart_step, double diag_shift,
+                          ConjugateGradientParallelScheme parallel_scheme = MasterSlaveCG)
+      : max_iter(max_iter), tolerance(tolerance), residue_restart_step(residue_restart_step), diag_shift(diag_shift),
+        parallel_scheme(parallel_scheme) {}
+};
+
+/**
+ * Adaptive number of Monte-Carlo samples in each optimization step (or line search point).
+ * Every check_interval samples per process, the energy error over all the processes is estimated
+ * by one small MPI_Allreduce; the sampling stops once the relative error reaches target_relative_error,
+ * with the samples per process bounded in [min_samples, max_samples].
+ * VMCPEPSExecutor rejects check_interval == 0 and min_samples > max_samples.
+ */
+struct AdaptiveSamplingPara {
+  size_t min_samples;
+  size_t max_samples;
+  size_t check_interval;
+  double target_relative_error;
+  /**
+   * In line search, a point is aborted once its energy is above the lowest energy found
+   * by more than line_search_abort_sigma error bars. Zero disables the abort.
+   */
+  double line_search_abort_sigma;
+
+  AdaptiveSamplingPara(void) = default;
+
+  AdaptiveSamplingPara(size_t min_samples, size_t max_samples, size_t check_interval,
+                       double target_relative_error, double line_search_abort_sigma = 0.0)
+      : min_samples(min_samples), max_samples(max_samples), check_interval(check_interval),
+        target_relative_error(target_relative_error), line_search_abort_sigma(line_search_abort_sigma) {}
+};
+
+/**
+ * Periodic checkpoints of the whole optimizer state, from which VMCPEPSExecutor can resume.
+ * A checkpoint is written into path + ".tmp" and renamed to path once all the processes finished writing;
+ * the asynchronous writing is committed at the next checkpoint or at the end of the optimization.
+ */
+struct CheckpointPara {
+  size_t every_iter;
+  std::string path;
+  bool async; // write on a helper thread, so that the optimization only stalls for copying the state
+
+  CheckpointPara(void) = default;
+
+  CheckpointPara(size_t every_iter, const std::string &path, bool async = true)
+      : every_iter(every_iter), path(path), async(async) {}
+};
+
+/**
+ * Cheaper boundary-MPS truncation (e.g. smaller D_max) of the Monte-Carlo sweeps, whose acceptance ratios
+ * tolerate less accurate amplitudes than the energies and gradients, which keep bmps_trunc_para.
+ * The energy solver recomputes the amplitude of each sample with bmps_trunc_para; once the two deviate
+ * relatively by more than amplitude_tolerance, the sweeps of the process fall back to bmps_trunc_para.
+ */
+struct SweepTruncatePara {
+  BMPSTruncatePara trunc_para;
+  double amplitude_tolerance;
+
+  SweepTruncatePara(void) = default;
+
+  SweepTruncatePara(const BMPSTruncatePara &trunc_para, double amplitude_tolerance = 0.01)
+      : trunc_para(trunc_para), amplitude_tolerance(amplitude_tolerance) {}
 };
 
 const std::vector<WAVEFUNCTION_UPDATE_SCHEME> stochastic_reconfiguration_method({StochasticReconfiguration,
                                                                                  RandomStepStochasticReconfiguration,
                                                                                  NormalizedStochasticReconfiguration,
-                                                                                 NaturalGradientLineSearch});
+                                                                                 NaturalGradientLineSearch,
+                                                                                 MinimumStochasticReconfiguration,
+                                                                                 StochasticReconfigurationMomentum});
+
+///< update schemes which keep the moments of the gradients (or natural gradients) between iterations
+const std::vector<WAVEFUNCTION_UPDATE_SCHEME> moment_update_method({Momentum,
+                                                                    Adam,
+                                                                    AMSGrad,
+                                                                    StochasticReconfigurationMomentum});
+
+/**
+ * Hyper-parameters of the update schemes with moments.
+ * Momentum: v = beta1 * v + g, and the TPS is updated by -step_len * v.
+ * Adam/AMSGrad: the standard ones, with the element-wise moments of the gradient.
+ * StochasticReconfigurationMomentum: the natural gradient x solves (S + diag_shift) x = g + diag_shift * beta1 * x_prev,
+ *      i.e. the SR solution regularized towards beta1 times the previous update (SPRING).
+ */
+struct MomentOptimizerPara {
+  double beta1 = 0.9;
+  double beta2 = 0.999;
+  double epsilon = 1e-8;
+
+  MomentOptimizerPara(void) = default;
+
+  MomentOptimizerPara(double beta1, double beta2, double epsilon) : beta1(beta1), beta2(beta2), epsilon(epsilon) {}
+};
+
+///< How the O_k samples used by the S matrix of stochastic reconfiguration are stored
+enum SRSampleStorage {
+  SplitIndexTPSSamples,   //0, one SplitIndexTPS per sample, SRSMatrix
+  DenseSamples,           //1, contiguous dense matrices, SRDenseSMatrix
+  DenseFloatSamples       //2, contiguous dense matrices in single precision, SRDenseSMatrix
+};
+
+///< How the updated TPS is broadcast from master
+enum TPSBroadcastScheme {
+  PerTensorTPSBroadcast,    //0, one MPI_Bcast per tensor
+  PackedTPSBroadcast,       //1, the updated TPS packed into one buffer, one MPI_Bcast
+  DeltaTPSBroadcast,        //2, only the update -step_len * direction, applied by all the processes
+  DeltaFloatTPSBroadcast,   //3, the delta in float32, half of the bytes
+  DeltaBF16TPSBroadcast     //4, the delta in bfloat16, a quarter of the bytes
+};
 
 struct VMCOptimizePara {
   VMCOptimizePara(void) = default;
@@ -78,11 +204,11 @@ struct VMCOptimizePara {
       bmps_trunc_para(trunc_para), mc_samples(samples),
       mc_warm_up_sweeps(warm_up_sweeps),
       mc_sweeps_between_sample(mc_sweeps_between_sample),
-      init_config(rows, cols),
+      init_config(rows, cols), init_occupancy(occupancy),
       step_lens(step_lens),
       update_scheme(update_scheme),
       wavefunction_path(wavefunction_path), cg_params(cg_params) {
-    init_config.Random(occupancy);
+    init_config.Ordered(occupancy);
   }
 
   VMCOptimizePara(BMPSTruncatePara trunc_para, size_t samples, size_t warm_up_sweeps,
@@ -112,11 +238,75 @@ struct VMCOptimizePara {
   size_t mc_sweeps_between_sample;
 
   Configuration init_config;
+  /**
+   * Set by the constructor from the occupation numbers. The executors then start each process and chain
+   * from its own random configuration with these occupation numbers, drawn from its seeded random stream
+   * (see random_seed), instead of init_config, which only holds the occupation numbers in order.
+   */
+  std::optional<std::vector<size_t>> init_occupancy;
 
   std::vector<double> step_lens;
   WAVEFUNCTION_UPDATE_SCHEME update_scheme;
   std::string wavefunction_path;
   std::optional<ConjugateGradientParams> cg_params;
+  SRSampleStorage sr_sample_storage = SplitIndexTPSSamples;
+  /**
+   * If nonzero, the updated TPS is broadcast by a non-blocking MPI_Ibcast, meanwhile all the processes
+   * run exactly pipeline_stale_sweeps Monte-Carlo sweeps on the previous TPS.
+   * The fixed number of stale sweeps bounds the staleness and keeps the Markov chains reproducible.
+   * The broadcast is progressed by an MPI_Test after each sweep, i.e. only between the sweeps
+   * unless the MPI library progresses it asynchronously; the overlap is not guaranteed otherwise.
+   */
+  size_t pipeline_stale_sweeps = 0;
+  /**
+   * The number of Markov chains in each process. The chains run in separate threads sharing one TPS,
+   * each with its own random stream and tensor network, and mc_samples are distributed over the chains.
+   * Set the tensor manipulation threads so that mc_chains * threads does not exceed the cores.
+   */
+  size_t mc_chains = 1;
+  ///< Summation scheme of the running sums of the gradient samples, Kahan summation for large sample numbers
+  SumAccumulationScheme accumulation_scheme = NaiveSummation;
+  ///< If set, mc_samples is replaced by the adaptive sample number
+  std::optional<AdaptiveSamplingPara> adaptive_sampling;
+  /**
+   * If true, the line search points are evaluated concurrently by groups of processes, one group per point
+   * (in rounds if there are more points than processes). Point i is the initial TPS moved by the cumulative
+   * stride step_lens[0] + ... + step_lens[i]. Each point is sampled only by its group, i.e. by fewer processes.
+   */
+  bool parallel_line_search = false;
+  ///< Hyper-parameters of Momentum, Adam, AMSGrad and StochasticReconfigurationMomentum
+  MomentOptimizerPara moment_para;
+  /**
+   * If true, the TPS update is sharded over the processes by sites instead of done in master:
+   * the gradient is reduce-scattered, each process updates its own sites, and the updated sites are all-gathered.
+   * The SR equation is solved by the CG with the vectors sharded in the same way.
+   * Only StochasticGradient, BoundGradientElement and (Normalized)StochasticReconfiguration without
+   * the CG preconditioner and recycling are sharded; otherwise, and with pipeline_stale_sweeps, master updates.
+   */
+  bool shard_tps_update = false;
+  /**
+   * The delta schemes send the update instead of the TPS. Master applies the same (rounded) delta as the others,
+   * so the TPS stays identical in all the processes; the rounding of the lossy encodings only perturbs the step.
+   * Used by the update schemes which move the TPS by a direction, when the update is neither sharded nor pipelined.
+   */
+  TPSBroadcastScheme tps_broadcast_scheme = PerTensorTPSBroadcast;
+  ///< If set, only for the iterative update schemes (not the line searches)
+  std::optional<CheckpointPara> checkpoint;
+  std::optional<SweepTruncatePara> sweep_truncation;
+  ///< Let the energy solvers reuse the boundary MPS of the last Monte-Carlo sweep (see WaveFunctionComponent)
+  bool reuse_sweep_bmps = false;
+  /**
+   * Threads per Markov chain over which the NN bond traces of the sweeps are split (see TensorNetwork2D).
+   * Values above 1 have not been benchmarked. For the NN exchange samplers they are likely unprofitable:
+   * each proposal splits into at most two tasks and pays a condition-variable round-trip to the workers.
+   * Prefer mc_chains or the tensor manipulation threads unless a measurement shows otherwise.
+   */
+  size_t bond_trace_threads = 1;
+  /**
+   * Seed of the random streams, keyed by (random_seed, rank, chain). If set, the sampling is reproducible
+   * for fixed numbers of processes and chains; otherwise master draws the seed from std::random_device.
+   */
+  std::optional<uint64_t> random_seed;
 };
 
 struct MCMeasurementPara {
@@ -131,8 +321,8 @@ struct MCMeasurementPara {
       mc_warm_up_sweeps(warm_up_sweeps),
       mc_sweeps_between_sample(mc_sweeps_between_sample),
       init_config(rows, cols),
-      wavefunction_path(wavefunction_path) {
-    init_config.Random(occupancy);
+      wavefunction_path(wavefunction_path), init_occupancy(occupancy) {
+    init_config.Ordered(occupancy);
   }
 
   MCMeasurementPara(BMPSTruncatePara trunc_para, size_t samples, size_t warm_up_sweeps,
@@ -156,7 +346,25 @@ struct MCMeasurementPara {
 
   Configuration init_config;
   std::string wavefunction_path;
+  ///< See VMCOptimizePara::init_occupancy
+  std::optional<std::vector<size_t>> init_occupancy;
+  ///< See VMCOptimizePara::random_seed
+  std::optional<uint64_t> random_seed;
 };
+
+/**
+ * The seed of the random streams, random_seed if set, otherwise drawn from std::random_device by master.
+ * All the processes get the same seed, and tell their streams apart by the rank.
+ */
+inline uint64_t SynchronizedRandomSeed(const std::optional<uint64_t> &random_seed, const MPI_Comm &comm) {
+  if (random_seed.has_value()) {
+    return random_seed.value();
+  }
+  std::random_device rd;
+  uint64_t seed = (uint64_t(rd()) << 32) | rd();
+  HANDLE_MPI_ERROR(::MPI_Bcast(&seed, 1, MPI_UINT64_T, kMPIMasterRank, comm));
+  return seed;
+}
 }//qlpeps
 
 #endif //QLPEPS_ALGORITHM_VMC_UPDATE_VMC_OPTIMIZE_PARA_H
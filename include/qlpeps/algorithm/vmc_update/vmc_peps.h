@@ -10,10 +10,15 @@
 #ifndef QLPEPS_ALGORITHM_VMC_UPDATE_VMC_UPDATE_H
 #define QLPEPS_ALGORITHM_VMC_UPDATE_VMC_UPDATE_H
 
+#include <thread>                                   // thread
+#include <atomic>                                   // atomic
 #include "qlpeps/two_dim_tn/tps/tps.h"              // TPS
 #include "qlpeps/two_dim_tn/tps/split_index_tps.h"  //SplitIndexTPS
 
 #include "qlpeps/algorithm/vmc_update/vmc_optimize_para.h"  //VMCOptimizePara
+#include "qlpeps/algorithm/vmc_update/model_energy_solver.h" //WaveFunctionAmplitudeConsistencyCheck
+#include "qlpeps/algorithm/vmc_update/stochastic_reconfiguration_dense_smatrix.h" //SRDenseSMatrix
+#include "qlpeps/algorithm/vmc_update/stochastic_reconfiguration_preconditioner.h" //SRPreconditioner
 
 namespace qlpeps {
 using namespace qlten;
@@ -50,9 +55,20 @@ class VMCPEPSExecutor : public Executor {
                   const MPI_Comm &comm,
                   const EnergySolver &solver = EnergySolver());
 
+  //Resume from the checkpoint written with optimize_para.checkpoint
+  VMCPEPSExecutor(const VMCOptimizePara &optimize_para,
+                  const size_t ly, const size_t lx,
+                  const std::string &checkpoint_path,
+                  const MPI_Comm &comm,
+                  const EnergySolver &solver = EnergySolver());
+
+  ~VMCPEPSExecutor();
+
   void Execute(void) override;
 
   const SITPST &GetState(void) const { return split_index_tps_; }
+  ///< Energies of the iterations up to now, only in the master process
+  const std::vector<TenElemT> &GetEnergyTrajectory(void) const { return energy_trajectory_; }
   void LoadTenData(void);
 
   void LoadTenData(const std::string &tps_path);
@@ -78,20 +94,52 @@ class VMCPEPSExecutor : public Executor {
   void IterativeOptimizeTPSStep_(const size_t iter);
   void LineSearch_(const SITPST &search_dir,
                    const std::vector<double> &strides);
+  void ParallelLineSearch_(const SITPST &search_dir,
+                           const std::vector<double> &strides);
 
   // Level 3 Member Functions
   void UpdateTPSByVecAndSynchronize_(const VMCPEPSExecutor::SITPST &grad, double step_len);
+  void BroadCastTPSOverlapSweeps_(SITPST &new_tps);
+  void BroadCastTPSUpdate_(const SITPST &direction, double step_len);
   void BoundGradElementUpdateTPS_(VMCPEPSExecutor::SITPST &grad, double step_len);
+  void ShardedUpdateTPS_(const SITPST &grad, double step_len, const bool bound_grad_element);
+  bool ShardedTPSUpdateSupported_(void) const;
   std::pair<size_t, double> StochReconfigUpdateTPS_(const VMCPEPSExecutor::SITPST &grad,
                                                     double step_len,
                                                     const SITPST &init_guess,
                                                     const bool normalize_natural_grad);
+  double MinSRUpdateTPS_(double step_len, const TenElemT energy);
+  void MomentUpdateTPS_(double step_len);
+  void DumpMoments_(const std::string &tps_path);
+  bool LoadMoments_(const std::string &tps_path);
   void NormalizeTPS_(void);
 
+  ///< Copy of the dynamic state written by the checkpoint writer
+  struct CheckpointSnapshot {
+    std::vector<std::pair<std::string, SITPST>> tps_list; // (directory name, data), only in master
+    std::vector<Configuration> configs;                   // of all the chains
+    std::string rng_state;
+    bool sweep_truncation_on;                             // false after the fallback of CheckSweepAmplitude_
+    std::string optimizer_state;                          // scalars and trajectories, only in master
+  };
+  void LaunchCheckpoint_(const size_t next_iter);
+  void WriteCheckpoint_(CheckpointSnapshot &snapshot, const std::string &path) const;
+  void CommitCheckpoint_(void);
+  void LoadCheckpoint_(const std::string &path);
+
   // Lowest Level Member functions who could directly change data
   ///< functions who cloud directly act on sample data
   TenElemT SampleEnergy_(void);
   void SampleEnergyAndHols_(void);
+  struct SampleWorkspace;
+  TenElemT SampleEnergy_(WaveFunctionComponentType &chain, EnergySolver &solver, SampleWorkspace &workspace);
+  void SampleEnergyAndHols_(WaveFunctionComponentType &chain, EnergySolver &solver,
+                            SITPST &gten_sum, SITPST &g_times_energy_sum,
+                            SampleWorkspace &workspace);
+  void AccumulateGradSample_(const Tensor &gten, const TenElemT energy_conj, const SiteIdx &site, const size_t basis,
+                             SITPST &gten_sum, SITPST &g_times_energy_sum, SampleWorkspace &workspace);
+  void KahanFinalize_(SITPST &sum, SITPST &comp);
+  void FlushChainSamples_(void);
   void ClearEnergyAndHoleSamples_(void);
 
   ///< statistic and gradient operation functions
@@ -99,8 +147,23 @@ class VMCPEPSExecutor : public Executor {
   std::pair<TenElemT, SITPST> GatherStatisticEnergyAndGrad_(void);
   void GradientRandElementSign_();
   size_t CalcNaturalGradient_(const VMCPEPSExecutor::SITPST &grad, const SITPST &init_guess);
+  void BuildSRPreconditioner_(void);
 
   std::vector<double> MCSweep_(void);
+  std::vector<double> MCSweep_(WaveFunctionComponentType &chain);
+  std::vector<double> MCSampling_(const bool calc_holes,
+                                  const double abort_energy = std::numeric_limits<double>::max());
+  bool AdaptiveSamplingStop_(const size_t sampled_num, const double abort_energy);
+  void CheckSweepAmplitude_(const TenElemT psi_sweep, const TenElemT psi);
+
+  ///< Markov chains in this process, chain 0 is tps_sample_
+  size_t ChainNum_(void) const { return tps_sample_chains_.size() + 1; }
+  WaveFunctionComponentType &Chain_(const size_t chain) {
+    return chain == 0 ? tps_sample_ : tps_sample_chains_[chain - 1];
+  }
+  template<typename ChainTask>
+  void ForEachChain_(ChainTask &&task);
+  void RefreshChainTensors_(void);
 
   bool AcceptanceRateCheck(const std::vector<double> &) const;
   // Input Data Region
@@ -118,6 +181,26 @@ class VMCPEPSExecutor : public Executor {
   bool warm_up_;
   bool stochastic_reconfiguration_update_class_;
   WaveFunctionComponentType tps_sample_;
+  double tps_sample_build_time_ = 0.0;   // time of constructing tps_sample_ from scratch
+  double tps_sample_refresh_time_ = 0.0; // time of the last in-place tensor refresh of tps_sample_
+  std::vector<WaveFunctionComponentType> tps_sample_chains_; // chains 1, 2, ..., mc_chains - 1
+  uint64_t random_seed_;                                     // the same in all the processes
+  std::vector<PhiloxEngine> chain_random_engines_;          // random streams of the chains if mc_chains > 1
+
+  ///< Buffers reused by all the samples of a chain, so that the sampling does not reallocate them per sample
+  struct SampleWorkspace {
+    SampleWorkspace(const size_t ly, const size_t lx) : holes(ly, lx) {}
+    TensorNetwork2D<TenElemT, QNT> holes; // also the gradient tensors of the sample after the scaling in place
+    SITPST gten_sum_comp, g_times_energy_sum_comp; // Kahan compensations of the chain's running sums
+    ///< Samples of the chains other than chain 0, appended to the executor's in chain order by FlushChainSamples_
+    std::vector<TenElemT> energy_samples;
+    std::vector<SITPST> gten_samples;
+    SRDenseSMatrix<TenElemT, QNT> dense_samples;
+  };
+  std::vector<SampleWorkspace> sample_workspaces_; // one for each chain
+  MPI_Comm sampling_comm_; // processes sampling the same TPS, comm_ except in the parallel line search
+  bool sampling_aborted_ = false; // whether the last MCSampling_ was aborted as a clearly worse line search point
+  std::atomic<bool> sweep_amplitude_drift_ = false; // set by the chains if the sweep truncation is too inaccurate
 
   std::vector<TenElemT> energy_samples_;
   ///<outside vector indices corresponding to the local hilbert space basis
@@ -126,6 +209,7 @@ class VMCPEPSExecutor : public Executor {
 
   ///< vector index corresponding to the samples.
   std::vector<SITPST> gten_samples_; //useful for stochastic reconfiguration
+  SRDenseSMatrix<TenElemT, QNT> dense_s_matrix_; //replace gten_samples_ if the samples are stored densely
 
   SITPST gten_sum_; // the holes * psi^(-1)
   SITPST gten_ave_; // average of gten_sum_;
@@ -133,6 +217,22 @@ class VMCPEPSExecutor : public Executor {
 
   SITPST grad_;
   SITPST natural_grad_;
+  CGRecycleSpace<SITPST> sr_recycle_space_;   // previous SR solutions, kept between the iterations
+  SRPreconditioner<TenElemT, QNT> sr_preconditioner_; // rebuilt from the samples before each SR solve
+  long sr_saved_iter_ = 0;   // S * v products saved by the recycling in the last SR solve, projection included
+  size_t start_iter_ = 0;            // first iteration of IterativeOptimizeTPS_, nonzero if resumed
+  std::thread checkpoint_writer_;    // writes the last checkpoint in the background
+  bool checkpoint_pending_ = false;  // the last checkpoint is written (or being written) but not renamed yet
+  size_t tps_broadcast_bytes_ = 0;  // bytes of the last TPS broadcast per receiving process
+  bool tps_update_sharded_ = false; // whether the update is sharded, see VMCOptimizePara::shard_tps_update
+  SplitIndexTPSShard tps_shard_;    // sites updated by this process if tps_update_sharded_;
+                                    // grad_ is only valid on these sites then
+
+  ///< states of the update schemes with moments, only in master
+  SITPST first_moment_;       // momentum, Adam first moment, or the previous update of SR with momentum
+  SITPST second_moment_;      // Adam and AMSGrad
+  SITPST second_moment_max_;  // AMSGrad
+  size_t moment_step_ = 0;    // number of the moment updates, used in the bias correction of Adam
   std::vector<double> grad_norm_;
 
   double en_min_;
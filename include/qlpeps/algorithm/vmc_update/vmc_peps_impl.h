@@ -10,10 +10,17 @@
 #ifndef QLPEPS_ALGORITHM_VMC_UPDATE_VMC_PEPS_IMPL_H
 #define QLPEPS_ALGORITHM_VMC_UPDATE_VMC_PEPS_IMPL_H
 
+#include <cassert>
 #include <iomanip>
+#include <numeric>    // partial_sum
+#include <sstream>    // ostringstream
+#include <filesystem> // rename, remove_all
 #include "qlpeps/algorithm/vmc_update/stochastic_reconfiguration_smatrix.h" //SRSMatrix
+#include "qlpeps/algorithm/vmc_update/min_sr_solver.h"                     //MinSRNaturalGradient
 #include "qlpeps/utility/conjugate_gradient_solver.h"
 #include "qlpeps/utility/helpers.h"                                         //ComplexConjugate
+#include "qlpeps/utility/moment_optimizer.h"                                //AdamMomentUpdate
+#include "qlpeps/utility/reduced_precision.h"                               //EncodeBF16
 #include "qlpeps/algorithm/vmc_update/axis_update.h"
 #include "qlpeps/monte_carlo_tools/statistics.h"
 
@@ -96,13 +103,23 @@ VMCPEPSExecutor<TenElemT,
     tps_lowest_(split_index_tps_) {
   MPI_Comm_rank(comm_, &rank_);
   MPI_Comm_size(comm_, &mpi_size_);
-  random_engine.seed(std::random_device{}() + 10086 * rank_);
+  sampling_comm_ = comm_;
+  random_seed_ = SynchronizedRandomSeed(optimize_para.random_seed, comm_);
+  random_engine = PhiloxEngine(random_seed_, rank_, 0);
   WaveFunctionComponentType::trun_para = BMPSTruncatePara(optimize_para);
+  WaveFunctionComponentType::sweep_trun_para = optimize_para.sweep_truncation.has_value() ?
+                                               std::make_optional(optimize_para.sweep_truncation->trunc_para)
+                                                                                         : std::nullopt;
+  WaveFunctionComponentType::reuse_sweep_bmps = optimize_para.reuse_sweep_bmps;
+  WaveFunctionComponentType::bond_trace_threads = optimize_para.bond_trace_threads;
   tps_sample_ = WaveFunctionComponentType(sitpst_init, optimize_para.init_config);
   if (std::find(stochastic_reconfiguration_method.cbegin(),
                 stochastic_reconfiguration_method.cend(),
                 optimize_para.update_scheme) != stochastic_reconfiguration_method.cend()) {
     stochastic_reconfiguration_update_class_ = true;
+    if (optimize_para.cg_params.has_value()) {
+      sr_recycle_space_ = CGRecycleSpace<SITPST>(optimize_para.cg_params.value().recycle_dim);
+    }
   } else {
     stochastic_reconfiguration_update_class_ = false;
   }
@@ -135,16 +152,30 @@ VMCPEPSExecutor<TenElemT,
     tps_lowest_(split_index_tps_) {
   MPI_Comm_rank(comm_, &rank_);
   MPI_Comm_size(comm_, &mpi_size_);
+  sampling_comm_ = comm_;
   WaveFunctionComponentType::trun_para = BMPSTruncatePara(optimize_para);
-  random_engine.seed(std::random_device{}() + 10086 * rank_);
+  WaveFunctionComponentType::sweep_trun_para = optimize_para.sweep_truncation.has_value() ?
+                                               std::make_optional(optimize_para.sweep_truncation->trunc_para)
+                                                                                         : std::nullopt;
+  WaveFunctionComponentType::reuse_sweep_bmps = optimize_para.reuse_sweep_bmps;
+  WaveFunctionComponentType::bond_trace_threads = optimize_para.bond_trace_threads;
+  random_seed_ = SynchronizedRandomSeed(optimize_para.random_seed, comm_);
+  random_engine = PhiloxEngine(random_seed_, rank_, 0);
   if (std::find(stochastic_reconfiguration_method.cbegin(),
                 stochastic_reconfiguration_method.cend(),
                 optimize_para.update_scheme) != stochastic_reconfiguration_method.cend()) {
     stochastic_reconfiguration_update_class_ = true;
+    if (optimize_para.cg_params.has_value()) {
+      sr_recycle_space_ = CGRecycleSpace<SITPST>(optimize_para.cg_params.value().recycle_dim);
+    }
   } else {
     stochastic_reconfiguration_update_class_ = false;
   }
   LoadTenData();
+  if (rank_ == kMPIMasterRank && std::find(moment_update_method.cbegin(), moment_update_method.cend(),
+                                           optimize_para.update_scheme) != moment_update_method.cend()) {
+    LoadMoments_(optimize_para.wavefunction_path);
+  }
   InitConfigs_(optimize_para.wavefunction_path);
   NormalizeTPS_();
   ReserveSamplesDataSpace_();
@@ -152,6 +183,61 @@ VMCPEPSExecutor<TenElemT,
   this->SetStatus(ExecutorStatus::INITED);
 }
 
+template<typename TenElemT, typename QNT, typename WaveFunctionComponentType, typename EnergySolver>
+VMCPEPSExecutor<TenElemT,
+                QNT,
+                WaveFunctionComponentType,
+                EnergySolver>::VMCPEPSExecutor(const VMCOptimizePara &optimize_para,
+                                               const size_t ly, const size_t lx,
+                                               const std::string &checkpoint_path,
+                                               const MPI_Comm &comm,
+                                               const EnergySolver &solver):
+    optimize_para(optimize_para),
+    comm_(comm), lx_(lx), ly_(ly),
+    energy_solver_(solver),
+    split_index_tps_(ly, lx),
+    warm_up_(false),
+    tps_sample_(ly, lx),
+    gten_sum_(ly_, lx_), g_times_energy_sum_(ly_, lx_),
+    grad_(ly_, lx_), natural_grad_(ly_, lx_),
+    en_min_(std::numeric_limits<double>::max()),
+    tps_lowest_(split_index_tps_) {
+  MPI_Comm_rank(comm_, &rank_);
+  MPI_Comm_size(comm_, &mpi_size_);
+  sampling_comm_ = comm_;
+  WaveFunctionComponentType::trun_para = BMPSTruncatePara(optimize_para);
+  WaveFunctionComponentType::sweep_trun_para = optimize_para.sweep_truncation.has_value() ?
+                                               std::make_optional(optimize_para.sweep_truncation->trunc_para)
+                                                                                         : std::nullopt;
+  WaveFunctionComponentType::reuse_sweep_bmps = optimize_para.reuse_sweep_bmps;
+  WaveFunctionComponentType::bond_trace_threads = optimize_para.bond_trace_threads;
+  stochastic_reconfiguration_update_class_ = (std::find(stochastic_reconfiguration_method.cbegin(),
+                                                        stochastic_reconfiguration_method.cend(),
+                                                        optimize_para.update_scheme)
+      != stochastic_reconfiguration_method.cend());
+  if (stochastic_reconfiguration_update_class_ && optimize_para.cg_params.has_value()) {
+    sr_recycle_space_ = CGRecycleSpace<SITPST>(optimize_para.cg_params.value().recycle_dim);
+  }
+  std::string path = checkpoint_path;
+  if (!qlmps::IsPathExist(path) && qlmps::IsPathExist(path + ".old")) {
+    path += ".old"; // interrupted between the two renames of CommitCheckpoint_
+  }
+  random_seed_ = SynchronizedRandomSeed(optimize_para.random_seed, comm_); // the engine states are loaded below
+  LoadTenData(path + "/tps");
+  InitConfigs_(path);
+  ReserveSamplesDataSpace_();
+  LoadCheckpoint_(path);
+  PrintExecutorInfo_();
+  this->SetStatus(ExecutorStatus::INITED);
+}
+
+template<typename TenElemT, typename QNT, typename WaveFunctionComponentType, typename EnergySolver>
+VMCPEPSExecutor<TenElemT, QNT, WaveFunctionComponentType, EnergySolver>::~VMCPEPSExecutor() {
+  if (checkpoint_writer_.joinable()) {
+    checkpoint_writer_.join();
+  }
+}
+
 template<typename TenElemT, typename QNT, typename WaveFunctionComponentType, typename EnergySolver>
 void VMCPEPSExecutor<TenElemT, QNT, WaveFunctionComponentType, EnergySolver>::Execute(void) {
   SetStatus(ExecutorStatus::EXEING);
@@ -167,7 +253,44 @@ void VMCPEPSExecutor<TenElemT, QNT, WaveFunctionComponentType, EnergySolver>::Ex
 
 template<typename TenElemT, typename QNT, typename WaveFunctionComponentType, typename EnergySolver>
 void VMCPEPSExecutor<TenElemT, QNT, WaveFunctionComponentType, EnergySolver>::ReserveSamplesDataSpace_(void) {
-  energy_samples_.reserve(optimize_para.mc_samples);
+  if (optimize_para.adaptive_sampling.has_value()) {
+    const AdaptiveSamplingPara &para = optimize_para.adaptive_sampling.value();
+    if (para.check_interval == 0 || para.min_samples > para.max_samples) {
+      std::cout << "Adaptive sampling requires check_interval >= 1 and min_samples <= max_samples, "
+                << "but got check_interval = " << para.check_interval
+                << ", min_samples = " << para.min_samples
+                << ", max_samples = " << para.max_samples << "." << std::endl;
+      exit(1);
+    }
+  }
+  const size_t max_samples = optimize_para.adaptive_sampling.has_value() ?
+                             optimize_para.adaptive_sampling.value().max_samples : optimize_para.mc_samples;
+  energy_samples_.reserve(max_samples);
+  if (optimize_para.update_scheme == MinimumStochasticReconfiguration) {
+    if constexpr (Tensor::IsFermionic()) {
+      std::cout << "MinimumStochasticReconfiguration does not support fermionic tensors." << std::endl;
+      exit(1);
+    }
+    if (optimize_para.sr_sample_storage == SplitIndexTPSSamples) {
+      optimize_para.sr_sample_storage = DenseSamples; // MinSR works on the dense samples
+    }
+  }
+  if constexpr (Tensor::IsFermionic()) {
+    if (optimize_para.cg_params.has_value()
+        && optimize_para.cg_params.value().preconditioner != NoSRPreconditioner) {
+      if (rank_ == kMPIMasterRank) {
+        std::cout << "SR preconditioners do not support fermionic tensors, turned off." << std::endl;
+      }
+      optimize_para.cg_params.value().preconditioner = NoSRPreconditioner;
+    }
+    if (optimize_para.sr_sample_storage != SplitIndexTPSSamples) {
+      if (rank_ == kMPIMasterRank) {
+        std::cout << "Dense SR samples do not support fermionic tensors, "
+                     "use SplitIndexTPS samples instead." << std::endl;
+      }
+      optimize_para.sr_sample_storage = SplitIndexTPSSamples;
+    }
+  }
   for (size_t row = 0; row < ly_; row++) {
     for (size_t col = 0; col < lx_; col++) {
       size_t dim = split_index_tps_({row, col}).size();
@@ -180,7 +303,7 @@ void VMCPEPSExecutor<TenElemT, QNT, WaveFunctionComponentType, EnergySolver>::Re
 //      }
       gten_sum_({row, col}) = std::vector<Tensor>(dim);
       for (size_t compt = 0; compt < dim; compt++) {
-        gten_sum_({row, col})[compt] = Tensor(split_index_tps_({row, col})[compt].GetIndexes());
+        gten_sum_({row, col})[compt] = ZeroTensorWithAllBlocks(split_index_tps_({row, col})[compt]);
       }
 
       g_times_energy_sum_({row, col}) = gten_sum_({row, col});
@@ -191,6 +314,24 @@ void VMCPEPSExecutor<TenElemT, QNT, WaveFunctionComponentType, EnergySolver>::Re
       size_t dim = split_index_tps_({row, col}).size();
       grad_({row, col}) = std::vector<Tensor>(dim);
     }
+  sample_workspaces_.clear();
+  sample_workspaces_.reserve(ChainNum_());
+  for (size_t chain = 0; chain < ChainNum_(); chain++) {
+    sample_workspaces_.emplace_back(ly_, lx_);
+    if (optimize_para.accumulation_scheme == KahanSummation) {
+      sample_workspaces_.back().gten_sum_comp = gten_sum_;  // zeros with all the blocks
+      sample_workspaces_.back().g_times_energy_sum_comp = gten_sum_;
+    }
+  }
+  if (optimize_para.shard_tps_update) {
+    tps_update_sharded_ = ShardedTPSUpdateSupported_();
+    if (tps_update_sharded_) {
+      tps_shard_ = BalancedSplitIndexTPSShard(gten_sum_, comm_); // all the blocks, the same layout in all processes
+    } else if (rank_ == kMPIMasterRank) {
+      std::cout << "Sharded TPS update does not support the update scheme or settings, update in master."
+                << std::endl;
+    }
+  }
   if (rank_ == 0) {
     energy_trajectory_.reserve(optimize_para.step_lens.size());
     energy_error_traj_.reserve(optimize_para.step_lens.size());
@@ -200,7 +341,15 @@ void VMCPEPSExecutor<TenElemT, QNT, WaveFunctionComponentType, EnergySolver>::Re
     grad_norm_.reserve(optimize_para.step_lens.size());
 
   if (stochastic_reconfiguration_update_class_) {
-    gten_samples_.reserve(optimize_para.mc_samples);
+    if (optimize_para.sr_sample_storage == SplitIndexTPSSamples) {
+      gten_samples_.reserve(max_samples);
+    } else {
+      dense_s_matrix_ = SRDenseSMatrix<TenElemT, QNT>(split_index_tps_,
+                                                      optimize_para.sr_sample_storage == DenseFloatSamples);
+      for (size_t chain = 1; chain < sample_workspaces_.size(); chain++) {
+        sample_workspaces_[chain].dense_samples = dense_s_matrix_;
+      }
+    }
     for (size_t row = 0; row < ly_; row++)
       for (size_t col = 0; col < lx_; col++) {
         size_t dim = split_index_tps_({row, col}).size();
@@ -223,12 +372,24 @@ void VMCPEPSExecutor<TenElemT, QNT, WaveFunctionComponentType, EnergySolver>::Pr
               << optimize_para.bmps_trunc_para.D_max << "\n";
     std::cout << std::setw(indent) << "BMPS Truncate Scheme:"
               << CompressMPSSchemeString(optimize_para.bmps_trunc_para.compress_scheme) << "\n";
-    std::cout << std::setw(indent) << "Sampling numbers:" << optimize_para.mc_samples << "\n";
+    if (optimize_para.adaptive_sampling.has_value()) {
+      const AdaptiveSamplingPara &para = optimize_para.adaptive_sampling.value();
+      std::cout << std::setw(indent) << "Sampling numbers (adaptive):" << para.min_samples << "~" << para.max_samples
+                << ", target relative error " << para.target_relative_error << "\n";
+    } else {
+      std::cout << std::setw(indent) << "Sampling numbers:" << optimize_para.mc_samples << "\n";
+    }
     std::cout << std::setw(indent) << "Monte Carlo sweep repeat times:" << optimize_para.mc_sweeps_between_sample
               << "\n";
     std::cout << std::setw(indent) << "PEPS update times:" << optimize_para.step_lens.size() << "\n";
     std::cout << std::setw(indent) << "PEPS update strategy:"
               << WavefunctionUpdateSchemeString(optimize_para.update_scheme) << "\n";
+    if (std::find(moment_update_method.cbegin(), moment_update_method.cend(), optimize_para.update_scheme)
+        != moment_update_method.cend()) {
+      std::cout << std::setw(indent) << "Moment beta1/beta2/epsilon:" << optimize_para.moment_para.beta1 << "/"
+                << optimize_para.moment_para.beta2 << "/" << optimize_para.moment_para.epsilon
+                << (moment_step_ > 0 ? " (moments loaded)" : "") << "\n";
+    }
     if (stochastic_reconfiguration_update_class_) {
       if (!optimize_para.cg_params.has_value()) {
         std::cout << "Conjugate gradient parameters have not been set!" << std::endl;
@@ -237,6 +398,49 @@ void VMCPEPSExecutor<TenElemT, QNT, WaveFunctionComponentType, EnergySolver>::Pr
       std::cout << std::setw(indent) << "Conjugate gradient diagonal shift:"
                 << optimize_para.cg_params.value().diag_shift
                 << "\n";
+      if (optimize_para.cg_params.value().recycle_dim > 0) {
+        std::cout << std::setw(indent) << "Conjugate gradient recycled solutions:"
+                  << optimize_para.cg_params.value().recycle_dim << "\n";
+      }
+      if (optimize_para.cg_params.value().preconditioner != NoSRPreconditioner) {
+        std::cout << std::setw(indent) << "Conjugate gradient preconditioner:"
+                  << (optimize_para.cg_params.value().preconditioner == JacobiSRPreconditioner ?
+                      "Jacobi" : "Site block") << "\n";
+      }
+      std::cout << std::setw(indent) << "SR sample storage:"
+                << (optimize_para.sr_sample_storage == SplitIndexTPSSamples ? "SplitIndexTPS" :
+                    optimize_para.sr_sample_storage == DenseSamples ? "Dense" : "Dense (float)")
+                << "\n";
+    }
+    if (optimize_para.accumulation_scheme == KahanSummation) {
+      std::cout << std::setw(indent) << "Gradient sample summation:" << "Kahan" << "\n";
+    }
+    if (optimize_para.mc_chains > 1) {
+      std::cout << std::setw(indent) << "Markov chains per processor:" << optimize_para.mc_chains << "\n";
+    }
+    if (optimize_para.pipeline_stale_sweeps > 0) {
+      std::cout << std::setw(indent) << "Stale sweeps during TPS broadcast:" << optimize_para.pipeline_stale_sweeps
+                << "\n";
+    }
+    if (tps_update_sharded_) {
+      std::cout << std::setw(indent) << "TPS update:" << "sharded by sites over the processes" << "\n";
+    }
+    if (optimize_para.sweep_truncation.has_value()) {
+      const BMPSTruncatePara &sweep_trunc_para = optimize_para.sweep_truncation.value().trunc_para;
+      std::cout << std::setw(indent) << "Sweep BMPS bond dimension:" << sweep_trunc_para.D_min << "/"
+                << sweep_trunc_para.D_max << "\n";
+      std::cout << std::setw(indent) << "Sweep BMPS Truncate Error:" << sweep_trunc_para.trunc_err << "\n";
+    }
+    if (optimize_para.reuse_sweep_bmps) {
+      std::cout << std::setw(indent) << "Energy solver BMPS:" << "reusing the last sweep" << "\n";
+    }
+    if (optimize_para.bond_trace_threads > 1) {
+      std::cout << std::setw(indent) << "Bond trace threads per chain:" << optimize_para.bond_trace_threads << "\n";
+    }
+    if (optimize_para.tps_broadcast_scheme != PerTensorTPSBroadcast) {
+      const char *scheme_names[] = {"per tensor", "packed", "delta", "delta (float32)", "delta (bfloat16)"};
+      std::cout << std::setw(indent) << "TPS broadcast:" << scheme_names[optimize_para.tps_broadcast_scheme]
+                << "\n";
     }
     std::cout << "=====> TECHNICAL PARAMETERS <=====" << "\n";
     std::cout << std::setw(indent) << "The number of processors (including master):" << mpi_size_ << "\n";
@@ -250,9 +454,11 @@ template<typename TenElemT, typename QNT, typename WaveFunctionComponentType, ty
 void VMCPEPSExecutor<TenElemT, QNT, WaveFunctionComponentType, EnergySolver>::WarmUp_(void) {
   if (!warm_up_) {
     Timer warm_up_timer("warm_up");
-    for (size_t sweep = 0; sweep < optimize_para.mc_warm_up_sweeps; sweep++) {
-      MCSweep_();
-    }
+    ForEachChain_([this](const size_t chain) {
+      for (size_t sweep = 0; sweep < optimize_para.mc_warm_up_sweeps; sweep++) {
+        MCSweep_(Chain_(chain));
+      }
+    });
     double elasp_time = warm_up_timer.Elapsed();
     std::cout << "Proc " << std::setw(4) << rank_ << " warm up completes T = " << elasp_time << "s."
               << std::endl;
@@ -260,27 +466,23 @@ void VMCPEPSExecutor<TenElemT, QNT, WaveFunctionComponentType, EnergySolver>::Wa
   }
 }
 
+///< Let the chains take the tensors of split_index_tps_, rebuilding those which cannot refresh them in place
+template<typename TenElemT, typename QNT, typename WaveFunctionComponentType, typename EnergySolver>
+void VMCPEPSExecutor<TenElemT, QNT, WaveFunctionComponentType, EnergySolver>::RefreshChainTensors_(void) {
+  for (size_t chain = 0; chain < ChainNum_(); chain++) {
+    if (!Chain_(chain).RefreshTensors(split_index_tps_)) {
+      const Configuration config = Chain_(chain).config;
+      Chain_(chain) = WaveFunctionComponentType(split_index_tps_, config);
+    }
+  }
+}
+
 template<typename TenElemT, typename QNT, typename WaveFunctionComponentType, typename EnergySolver>
 void VMCPEPSExecutor<TenElemT, QNT, WaveFunctionComponentType, EnergySolver>::LineSearchOptimizeTPS_(void) {
-  std::vector<double> accept_rates_accum;
   ClearEnergyAndHoleSamples_();
 
   Timer grad_calculation_timer("gradient_calculation");
-  for (size_t sweep = 0; sweep < optimize_para.mc_samples; sweep++) {
-    std::vector<double> accept_rates = MCSweep_();
-    if (sweep == 0) {
-      accept_rates_accum = accept_rates;
-    } else {
-      for (size_t i = 0; i < accept_rates_accum.size(); i++) {
-        accept_rates_accum[i] += accept_rates[i];
-      }
-    }
-    SampleEnergyAndHols_();
-  }
-  auto accept_rates_avg = accept_rates_accum;
-  for (double &rates : accept_rates_avg) {
-    rates /= double(optimize_para.mc_samples);
-  }
+  std::vector<double> accept_rates_avg = MCSampling_(true);
   GatherStatisticEnergyAndGrad_();
 
   size_t cgsolver_iter(0);
@@ -293,7 +495,7 @@ void VMCPEPSExecutor<TenElemT, QNT, WaveFunctionComponentType, EnergySolver>::Li
       break;
     }
     case NaturalGradientLineSearch: {
-      auto init_guess = SITPST(ly_, lx_, split_index_tps_.PhysicalDim());
+      auto init_guess = ZeroSplitIndexTPSWithAllBlocks(split_index_tps_);
       cgsolver_iter = CalcNaturalGradient_(grad_, init_guess);
       if (rank_ == kMPIMasterRank) {
         search_dir = &natural_grad_;
@@ -323,13 +525,22 @@ void VMCPEPSExecutor<TenElemT, QNT, WaveFunctionComponentType, EnergySolver>::Li
     std::cout << "]";
     if (stochastic_reconfiguration_update_class_) {
       std::cout << "SRSolver Iter = " << std::setw(4) << cgsolver_iter;
+      if (optimize_para.cg_params.value().recycle_benchmark) {
+        std::cout << "(saved " << std::setw(4) << sr_saved_iter_ << ")";
+      }
       std::cout << "NGrad norm = " << std::setw(9) << std::scientific << std::setprecision(1) << sr_natural_grad_norm;
     }
     std::cout << " TotT = " << std::setw(8) << std::fixed << std::setprecision(2) << gradient_calculation_time << "s"
               << "\n";
   }
   AcceptanceRateCheck(accept_rates_avg);
-  LineSearch_(*search_dir, optimize_para.step_lens);
+  if (optimize_para.parallel_line_search) {
+    SITPST search_dir_all = (rank_ == kMPIMasterRank) ? *search_dir : SITPST(ly_, lx_);
+    BroadCast(search_dir_all, comm_);
+    ParallelLineSearch_(search_dir_all, optimize_para.step_lens);
+  } else {
+    LineSearch_(*search_dir, optimize_para.step_lens);
+  }
 }
 
 template<typename TenElemT, typename QNT, typename WaveFunctionComponentType, typename EnergySolver>
@@ -346,18 +557,9 @@ void VMCPEPSExecutor<TenElemT, QNT, WaveFunctionComponentType, EnergySolver>::Li
     Timer energy_measure_timer("energy_measure");
     UpdateTPSByVecAndSynchronize_(search_dir, strides[point]);
     ClearEnergyAndHoleSamples_();
-    std::vector<double> accept_rates_accum;
-    for (size_t sweep = 0; sweep < optimize_para.mc_samples; sweep++) {
-      std::vector<double> accept_rates = MCSweep_();
-      if (sweep == 0) {
-        accept_rates_accum = accept_rates;
-      } else {
-        for (size_t i = 0; i < accept_rates_accum.size(); i++) {
-          accept_rates_accum[i] += accept_rates[i];
-        }
-      }
-      SampleEnergy_();
-    }
+    double abort_energy = en_min_; // lowest energy up to now, as the reference to abort clearly worse points
+    HANDLE_MPI_ERROR(::MPI_Bcast(&abort_energy, 1, MPI_DOUBLE, kMPIMasterRank, comm_));
+    std::vector<double> accept_rates_avg = MCSampling_(false, abort_energy);
     TenElemT en_self = Mean(energy_samples_); //energy value in each processor
     auto [energy, en_err] = GatherStatisticSingleData(en_self, MPI_Comm(comm_));
     qlten::hp_numeric::MPI_Bcast(&energy, 1, kMPIMasterRank, MPI_Comm(comm_));
@@ -365,10 +567,6 @@ void VMCPEPSExecutor<TenElemT, QNT, WaveFunctionComponentType, EnergySolver>::Li
       energy_trajectory_.push_back(energy);
       energy_error_traj_.push_back(en_err);
 
-      auto accept_rates_avg = accept_rates_accum;
-      for (double &rates : accept_rates_avg) {
-        rates /= double(optimize_para.mc_samples);
-      }
       if (Real(energy) < en_min_) {
         en_min_ = Real(energy);
         tps_lowest_ = split_index_tps_;
@@ -387,6 +585,9 @@ void VMCPEPSExecutor<TenElemT, QNT, WaveFunctionComponentType, EnergySolver>::Li
         std::cout << std::setw(5) << std::fixed << std::setprecision(2) << rate;
       }
       std::cout << "]";
+      if (optimize_para.adaptive_sampling.has_value()) {
+        std::cout << " Samples = " << energy_samples_.size() << (sampling_aborted_ ? " (aborted)" : "");
+      }
 
       std::cout << " TotT = " << std::setw(8) << std::fixed << std::setprecision(2) << energy_measure_time << "s"
                 << std::endl;
@@ -397,10 +598,320 @@ void VMCPEPSExecutor<TenElemT, QNT, WaveFunctionComponentType, EnergySolver>::Li
   }
 }
 
+/**
+ * Line search with the points evaluated concurrently. comm_ is split into min(points, processes) groups
+ * by rank % groups; group g evaluates the points g, g + groups, ....
+ * Every process builds its candidate TPS locally from the initial TPS and the (broadcast) search direction,
+ * so no TPS is communicated. The energies are collected in master by one reduction, and the lowest point
+ * (or the initial TPS if no point is lower) is chosen by master and broadcast as an index.
+ *
+ * @param search_dir the search direction, which should be the same in all the processes
+ */
+template<typename TenElemT, typename QNT, typename WaveFunctionComponentType, typename EnergySolver>
+void VMCPEPSExecutor<TenElemT, QNT, WaveFunctionComponentType, EnergySolver>::ParallelLineSearch_(
+    const SITPST &search_dir,
+    const std::vector<double> &strides) {
+  const size_t point_num = strides.size();
+  const size_t group_num = std::min(point_num, size_t(mpi_size_));
+  const size_t group = rank_ % group_num;
+  MPI_Comm group_comm;
+  HANDLE_MPI_ERROR(::MPI_Comm_split(comm_, group, rank_, &group_comm));
+  int group_rank;
+  MPI_Comm_rank(group_comm, &group_rank);
+
+  const SITPST tps_init = split_index_tps_;
+  std::vector<double> cumulative_strides(point_num);
+  std::partial_sum(strides.cbegin(), strides.cend(), cumulative_strides.begin());
+  auto candidate_tps = [&](const size_t point) {
+    SITPST tps = tps_init;
+    tps += (-cumulative_strides[point]) * search_dir;
+    tps.ScaleMaxAbsForAllSite(1.0);
+    return tps;
+  };
+  auto refresh_chains = [this]() { RefreshChainTensors_(); };
+
+  // results of the points, only set by the group masters before the reduction
+  std::vector<TenElemT> energies(point_num, TenElemT(0));
+  std::vector<double> errs_and_times(2 * point_num, 0.0);
+  sampling_comm_ = group_comm;
+  for (size_t point = group; point < point_num; point += group_num) {
+    Timer energy_measure_timer("energy_measure");
+    split_index_tps_ = candidate_tps(point);
+    refresh_chains();
+    ClearEnergyAndHoleSamples_();
+    MCSampling_(false);
+    TenElemT en_self = Mean(energy_samples_); //energy value in each processor
+    auto [energy, en_err] = GatherStatisticSingleData(en_self, group_comm);
+    if (group_rank == kMPIMasterRank) {
+      energies[point] = energy;
+      errs_and_times[2 * point] = en_err;
+      errs_and_times[2 * point + 1] = energy_measure_timer.Elapsed();
+    }
+  }
+  sampling_comm_ = comm_;
+  HANDLE_MPI_ERROR(::MPI_Comm_free(&group_comm));
+
+  const bool is_master = (rank_ == kMPIMasterRank);
+  HANDLE_MPI_ERROR(::MPI_Reduce(is_master ? MPI_IN_PLACE : energies.data(), energies.data(), point_num,
+                                hp_numeric::GetMPIDataType<TenElemT>(), MPI_SUM, kMPIMasterRank, comm_));
+  HANDLE_MPI_ERROR(::MPI_Reduce(is_master ? MPI_IN_PLACE : errs_and_times.data(), errs_and_times.data(),
+                                2 * point_num, MPI_DOUBLE, MPI_SUM, kMPIMasterRank, comm_));
+  int best_point = -1; // -1 for the initial TPS
+  if (is_master) {
+    en_min_ = Real(energy_trajectory_[0]);
+    for (size_t point = 0; point < point_num; point++) {
+      energy_trajectory_.push_back(energies[point]);
+      energy_error_traj_.push_back(errs_and_times[2 * point]);
+      if (Real(energies[point]) < en_min_) {
+        en_min_ = Real(energies[point]);
+        best_point = point;
+      }
+      std::cout << "Stride :" << std::setw(9) << cumulative_strides[point]
+                << "E0 = " << std::setw(14) << std::fixed << std::setprecision(kEnergyOutputPrecision)
+                << energies[point]
+                << pm_sign << " " << std::setw(10) << std::scientific << std::setprecision(2)
+                << errs_and_times[2 * point]
+                << " Group = " << std::setw(4) << point % group_num
+                << " TotT = " << std::setw(8) << std::fixed << std::setprecision(2)
+                << errs_and_times[2 * point + 1] << "s"
+                << std::endl;
+    }
+  }
+  HANDLE_MPI_ERROR(::MPI_Bcast(&best_point, 1, MPI_INT, kMPIMasterRank, comm_));
+  split_index_tps_ = (best_point < 0) ? tps_init : candidate_tps(best_point);
+  refresh_chains();
+  if (is_master) {
+    tps_lowest_ = split_index_tps_;
+  }
+}
+
 template<typename TenElemT, typename QNT, typename WaveFunctionComponentType, typename EnergySolver>
 void VMCPEPSExecutor<TenElemT, QNT, WaveFunctionComponentType, EnergySolver>::IterativeOptimizeTPS_(void) {
-  for (size_t iter = 0; iter < optimize_para.step_lens.size(); iter++) {
+  const size_t iter_num = optimize_para.step_lens.size();
+  for (size_t iter = start_iter_; iter < iter_num; iter++) {
     IterativeOptimizeTPSStep_(iter);
+    if (optimize_para.checkpoint.has_value() && iter + 1 < iter_num
+        && (iter + 1) % optimize_para.checkpoint.value().every_iter == 0) {
+      LaunchCheckpoint_(iter + 1);
+    }
+  }
+  CommitCheckpoint_();
+}
+
+/**
+ * Copy the dynamic state of the optimization before the iteration next_iter, and write it into
+ * checkpoint.path + ".tmp", on a helper thread if checkpoint.async. The previous checkpoint is committed first.
+ *
+ * Master writes the TPS, the lowest-energy TPS, the SR initial guess and recycled solutions, the moments,
+ * the trajectories and the scalars; each process writes the configurations, the random engine states
+ * and whether the sweep truncation is still on.
+ */
+template<typename TenElemT, typename QNT, typename WaveFunctionComponentType, typename EnergySolver>
+void VMCPEPSExecutor<TenElemT, QNT, WaveFunctionComponentType, EnergySolver>::LaunchCheckpoint_(
+    const size_t next_iter) {
+  CommitCheckpoint_();
+  const CheckpointPara &para = optimize_para.checkpoint.value();
+  const std::string tmp_path = para.path + ".tmp";
+  if (rank_ == kMPIMasterRank) {
+    std::filesystem::remove_all(tmp_path);
+    qlmps::CreatPath(tmp_path);
+  }
+  MPI_Barrier(comm_);
+
+  CheckpointSnapshot snapshot;
+  for (size_t chain = 0; chain < ChainNum_(); chain++) {
+    snapshot.configs.push_back(Chain_(chain).config);
+  }
+  std::ostringstream rng_state;
+  rng_state << random_engine;
+  for (const PhiloxEngine &engine : chain_random_engines_) {
+    rng_state << "\n" << engine;
+  }
+  snapshot.rng_state = rng_state.str();
+  snapshot.sweep_truncation_on = WaveFunctionComponentType::sweep_trun_para.has_value();
+  if (rank_ == kMPIMasterRank) {
+    snapshot.tps_list.emplace_back("tps", split_index_tps_);
+    snapshot.tps_list.emplace_back("tps_lowest", tps_lowest_);
+    if (stochastic_reconfiguration_update_class_) {
+      snapshot.tps_list.emplace_back("natural_grad", natural_grad_);
+    }
+    if (moment_step_ > 0) {
+      snapshot.tps_list.emplace_back("moment1", first_moment_);
+      if (optimize_para.update_scheme == Adam || optimize_para.update_scheme == AMSGrad) {
+        snapshot.tps_list.emplace_back("moment2", second_moment_);
+      }
+      if (optimize_para.update_scheme == AMSGrad) {
+        snapshot.tps_list.emplace_back("moment2max", second_moment_max_);
+      }
+    }
+    const auto &recycled_solutions = sr_recycle_space_.Vectors();
+    for (size_t i = 0; i < recycled_solutions.size(); i++) {
+      snapshot.tps_list.emplace_back("recycle" + std::to_string(i), recycled_solutions[i]);
+    }
+
+    std::ostringstream state;
+    state << std::setprecision(std::numeric_limits<double>::max_digits10);
+    state << next_iter << " " << en_min_ << " " << moment_step_ << " " << recycled_solutions.size() << "\n";
+    state << energy_trajectory_.size();
+    for (const TenElemT &energy : energy_trajectory_) { state << " " << energy; }
+    state << "\n" << energy_error_traj_.size();
+    for (const double err : energy_error_traj_) { state << " " << err; }
+    state << "\n" << grad_norm_.size();
+    for (const double norm : grad_norm_) { state << " " << norm; }
+    state << "\n";
+    snapshot.optimizer_state = state.str();
+  }
+
+  checkpoint_pending_ = true;
+  if (para.async) {
+    checkpoint_writer_ = std::thread([this, tmp_path, snapshot = std::move(snapshot)]() mutable {
+      WriteCheckpoint_(snapshot, tmp_path);
+    });
+  } else {
+    WriteCheckpoint_(snapshot, tmp_path);
+  }
+}
+
+///< Only touches the files, so that it is safe to run on the helper thread
+template<typename TenElemT, typename QNT, typename WaveFunctionComponentType, typename EnergySolver>
+void VMCPEPSExecutor<TenElemT, QNT, WaveFunctionComponentType, EnergySolver>::WriteCheckpoint_(
+    CheckpointSnapshot &snapshot, const std::string &path) const {
+  for (auto &[name, tps] : snapshot.tps_list) {
+    tps.Dump(path + "/" + name, true);
+  }
+  for (size_t chain = 0; chain < snapshot.configs.size(); chain++) {
+    snapshot.configs[chain].Dump(path, chain * mpi_size_ + rank_);
+  }
+  std::ofstream rng_ofs(path + "/random_engine" + std::to_string(rank_));
+  rng_ofs << snapshot.rng_state;
+  rng_ofs.close();
+  std::ofstream sweep_ofs(path + "/sweep_truncation" + std::to_string(rank_));
+  sweep_ofs << snapshot.sweep_truncation_on;
+  sweep_ofs.close();
+  if (rank_ == kMPIMasterRank) {
+    std::ofstream state_ofs(path + "/optimizer_state");
+    state_ofs << snapshot.optimizer_state;
+    state_ofs.close();
+  }
+}
+
+/**
+ * Wait for the writer of the last checkpoint in all the processes, then master atomically replaces
+ * the previous checkpoint by renaming, so that the checkpoint on disk is always complete.
+ */
+template<typename TenElemT, typename QNT, typename WaveFunctionComponentType, typename EnergySolver>
+void VMCPEPSExecutor<TenElemT, QNT, WaveFunctionComponentType, EnergySolver>::CommitCheckpoint_(void) {
+  if (!checkpoint_pending_) {
+    return;
+  }
+  if (checkpoint_writer_.joinable()) {
+    checkpoint_writer_.join();
+  }
+  MPI_Barrier(comm_);
+  if (rank_ == kMPIMasterRank) {
+    const std::string &path = optimize_para.checkpoint.value().path;
+    const std::string old_path = path + ".old";
+    std::filesystem::remove_all(old_path);
+    if (qlmps::IsPathExist(path)) {
+      std::filesystem::rename(path, old_path);
+    }
+    std::filesystem::rename(path + ".tmp", path);
+    std::filesystem::remove_all(old_path);
+  }
+  checkpoint_pending_ = false;
+}
+
+/**
+ * Load the state written by LaunchCheckpoint_ except the TPS and the configurations,
+ * which are loaded by LoadTenData and InitConfigs_.
+ */
+template<typename TenElemT, typename QNT, typename WaveFunctionComponentType, typename EnergySolver>
+void VMCPEPSExecutor<TenElemT, QNT, WaveFunctionComponentType, EnergySolver>::LoadCheckpoint_(
+    const std::string &path) {
+  std::ifstream rng_ifs(path + "/random_engine" + std::to_string(rank_));
+  rng_ifs >> random_engine;
+  for (PhiloxEngine &engine : chain_random_engines_) {
+    rng_ifs >> engine;
+  }
+  if (!rng_ifs) {
+    std::cout << "Loading the random engine states in rank " << rank_ << " fails." << std::endl;
+    exit(-1);
+  }
+  warm_up_ = true; // the configurations are those of the interrupted optimization
+  if (optimize_para.sweep_truncation.has_value()) {
+    std::ifstream sweep_ifs(path + "/sweep_truncation" + std::to_string(rank_));
+    bool sweep_truncation_on(true);
+    sweep_ifs >> sweep_truncation_on;
+    if (!sweep_ifs) {
+      std::cout << "Loading the sweep truncation state in rank " << rank_ << " fails." << std::endl;
+      exit(-1);
+    }
+    if (!sweep_truncation_on) { // the interrupted run has fallen back, see MCSampling_
+      WaveFunctionComponentType::sweep_trun_para = std::nullopt;
+    }
+  }
+
+  size_t recycle_num(0);
+  if (rank_ == kMPIMasterRank) {
+    std::ifstream state_ifs(path + "/optimizer_state");
+    size_t traj_size;
+    state_ifs >> start_iter_ >> en_min_ >> moment_step_ >> recycle_num;
+    state_ifs >> traj_size;
+    energy_trajectory_.resize(traj_size);
+    for (TenElemT &energy : energy_trajectory_) { state_ifs >> energy; }
+    state_ifs >> traj_size;
+    energy_error_traj_.resize(traj_size);
+    for (double &err : energy_error_traj_) { state_ifs >> err; }
+    state_ifs >> traj_size;
+    grad_norm_.resize(traj_size);
+    for (double &norm : grad_norm_) { state_ifs >> norm; }
+    if (!state_ifs) {
+      std::cout << "Loading the optimizer state fails." << std::endl;
+      exit(-1);
+    }
+
+    bool load_success = tps_lowest_.Load(path + "/tps_lowest");
+    if (stochastic_reconfiguration_update_class_) {
+      load_success = load_success && natural_grad_.Load(path + "/natural_grad");
+    }
+    if (moment_step_ > 0) {
+      first_moment_ = SITPST(ly_, lx_);
+      second_moment_ = SITPST(ly_, lx_);
+      second_moment_max_ = SITPST(ly_, lx_);
+      load_success = load_success && first_moment_.Load(path + "/moment1");
+      if (optimize_para.update_scheme == Adam || optimize_para.update_scheme == AMSGrad) {
+        load_success = load_success && second_moment_.Load(path + "/moment2");
+      }
+      if (optimize_para.update_scheme == AMSGrad) {
+        load_success = load_success && second_moment_max_.Load(path + "/moment2max");
+      }
+    }
+    if (!load_success) {
+      std::cout << "Loading the checkpoint tensors fails." << std::endl;
+      exit(-1);
+    }
+  }
+  HANDLE_MPI_ERROR(::MPI_Bcast(&start_iter_, 1, MPI_UNSIGNED_LONG_LONG, kMPIMasterRank, comm_));
+  HANDLE_MPI_ERROR(::MPI_Bcast(&recycle_num, 1, MPI_UNSIGNED_LONG_LONG, kMPIMasterRank, comm_));
+  if (stochastic_reconfiguration_update_class_) {
+    BroadCast(natural_grad_, comm_);
+  }
+  // the recycled solutions are kept in all the processes except for the master-slave CG
+  const bool recycle_in_all = optimize_para.cg_params.has_value()
+      && optimize_para.cg_params.value().parallel_scheme != MasterSlaveCG;
+  sr_recycle_space_.Clear();
+  for (size_t i = 0; i < recycle_num; i++) {
+    SITPST recycled_solution(ly_, lx_);
+    if (rank_ == kMPIMasterRank && !recycled_solution.Load(path + "/recycle" + std::to_string(i))) {
+      std::cout << "Loading the recycled SR solutions fails." << std::endl;
+      exit(-1);
+    }
+    if (recycle_in_all) {
+      BroadCast(recycled_solution, comm_);
+    }
+    if (recycle_in_all || rank_ == kMPIMasterRank) {
+      sr_recycle_space_.Add(recycled_solution);
+    }
   }
 }
 
@@ -408,25 +919,10 @@ template<typename TenElemT, typename QNT, typename WaveFunctionComponentType, ty
 void VMCPEPSExecutor<TenElemT, QNT,
                      WaveFunctionComponentType,
                      EnergySolver>::IterativeOptimizeTPSStep_(const size_t iter) {
-  std::vector<double> accept_rates_accum;
   ClearEnergyAndHoleSamples_();
 
   Timer grad_update_timer("gradient_update");
-  for (size_t sweep = 0; sweep < optimize_para.mc_samples; sweep++) {
-    std::vector<double> accept_rates = MCSweep_();
-    if (sweep == 0) {
-      accept_rates_accum = accept_rates;
-    } else {
-      for (size_t i = 0; i < accept_rates_accum.size(); i++) {
-        accept_rates_accum[i] += accept_rates[i];
-      }
-    }
-    SampleEnergyAndHols_();
-  }
-  std::vector<double> accept_rates_avg = accept_rates_accum;
-  for (double &rates : accept_rates_avg) {
-    rates /= double(optimize_para.mc_samples);
-  }
+  std::vector<double> accept_rates_avg = MCSampling_(true);
   TenElemT en_step;
   std::tie(en_step, std::ignore) = GatherStatisticEnergyAndGrad_();
 
@@ -440,7 +936,7 @@ void VMCPEPSExecutor<TenElemT, QNT,
   double sr_natural_grad_norm;
   SITPST sr_init_guess;
   if (iter == 0) {
-    sr_init_guess = SITPST(ly_, lx_, split_index_tps_.PhysicalDim()); //set 0 as initial guess
+    sr_init_guess = ZeroSplitIndexTPSWithAllBlocks(split_index_tps_); //set 0 as initial guess
   } else {
     sr_init_guess = natural_grad_;
   }
@@ -478,6 +974,31 @@ void VMCPEPSExecutor<TenElemT, QNT,
     }
     case BoundGradientElement:BoundGradElementUpdateTPS_(grad_, step_len);
       break;
+    case MinimumStochasticReconfiguration: {
+      sr_iter = 0; // direct solver
+      sr_natural_grad_norm = MinSRUpdateTPS_(step_len, en_step);
+      break;
+    }
+    case Momentum:
+    case Adam:
+    case AMSGrad: {
+      MomentUpdateTPS_(step_len);
+      break;
+    }
+    case StochasticReconfigurationMomentum: {
+      SITPST sr_b = grad_;
+      if (rank_ == kMPIMasterRank && moment_step_ > 0) {
+        sr_b += (optimize_para.cg_params.value().diag_shift * optimize_para.moment_para.beta1) * first_moment_;
+      }
+      auto iter_natural_grad_norm = StochReconfigUpdateTPS_(sr_b, step_len, sr_init_guess, false);
+      sr_iter = iter_natural_grad_norm.first;
+      sr_natural_grad_norm = iter_natural_grad_norm.second;
+      if (rank_ == kMPIMasterRank) {
+        first_moment_ = natural_grad_;
+        moment_step_++;
+      }
+      break;
+    }
     default:std::cout << "update method does not support!" << std::endl;
       exit(2);
   }
@@ -501,9 +1022,22 @@ void VMCPEPSExecutor<TenElemT, QNT,
 
     if (stochastic_reconfiguration_update_class_) {
       std::cout << "SRSolver Iter = " << std::setw(4) << sr_iter;
+      if (optimize_para.cg_params.value().recycle_benchmark) {
+        std::cout << "(saved " << std::setw(4) << sr_saved_iter_ << ")";
+      }
       std::cout << "NGrad norm = " << std::setw(9) << std::scientific << std::setprecision(1) << sr_natural_grad_norm;
     }
+    if (optimize_para.adaptive_sampling.has_value()) {
+      std::cout << "Samples = " << std::setw(7) << energy_samples_.size();
+    }
+    if (optimize_para.tps_broadcast_scheme != PerTensorTPSBroadcast) {
+      std::cout << "Bcast = " << std::setw(8) << std::scientific << std::setprecision(2)
+                << double(tps_broadcast_bytes_) << "B ";
+    }
     std::cout << "TPS UpdateT = " << std::setw(6) << std::fixed << std::setprecision(2) << tps_update_time << "s"
+              << " RefreshT = " << std::setw(8) << std::scientific << std::setprecision(1) << tps_sample_refresh_time_
+              << "s (saved " << std::setw(8) << std::scientific << std::setprecision(1)
+              << tps_sample_build_time_ - tps_sample_refresh_time_ << "s)"
               << " TotT = " << std::setw(8) << std::fixed << std::setprecision(2) << gradient_update_time << "s"
               << "\n";
   }
@@ -533,13 +1067,20 @@ void VMCPEPSExecutor<TenElemT, QNT, WaveFunctionComponentType, EnergySolver>::Cl
       size_t dim = split_index_tps_.PhysicalDim({row, col});
       gten_sum_({row, col}) = std::vector<Tensor>(dim);
       for (size_t compt = 0; compt < dim; compt++) {
-        gten_sum_({row, col})[compt] = Tensor(split_index_tps_({row, col})[compt].GetIndexes());
+        gten_sum_({row, col})[compt] = ZeroTensorWithAllBlocks(split_index_tps_({row, col})[compt]);
       }
       g_times_energy_sum_({row, col}) = gten_sum_({row, col});
     }
   }
   if (stochastic_reconfiguration_update_class_) {
-    gten_samples_.clear();
+    if (optimize_para.sr_sample_storage == SplitIndexTPSSamples) {
+      gten_samples_.clear();
+    } else {
+      dense_s_matrix_.Reset(split_index_tps_);
+      for (size_t chain = 1; chain < sample_workspaces_.size(); chain++) {
+        sample_workspaces_[chain].dense_samples.Reset(split_index_tps_);
+      }
+    }
   }
 }
 
@@ -563,49 +1104,172 @@ QLTensor<TenElemT, QNT> CalGTenForFermionicTensors(
 
 template<typename TenElemT, typename QNT, typename WaveFunctionComponentType, typename EnergySolver>
 void VMCPEPSExecutor<TenElemT, QNT, WaveFunctionComponentType, EnergySolver>::SampleEnergyAndHols_(void) {
-  TensorNetwork2D<TenElemT, QNT> holes(ly_, lx_);
-  TenElemT energy_loc = energy_solver_.template CalEnergyAndHoles<WaveFunctionComponentType, true>(&split_index_tps_,
-                                                                                                   &tps_sample_,
-                                                                                                   holes);
+  SampleEnergyAndHols_(tps_sample_, energy_solver_, gten_sum_, g_times_energy_sum_, sample_workspaces_[0]);
+}
+
+/**
+ * Sample the energy and holes of the chain, accumulate the gradient tensors into gten_sum and g_times_energy_sum.
+ * Chain 0 appends the energy and SR samples to the executor's containers; the other chains append them to
+ * the buffers of their workspaces, which FlushChainSamples_ appends in chain order once the chains have joined.
+ * The order of the samples is thus reproducible with several chains running concurrently.
+ */
+template<typename TenElemT, typename QNT, typename WaveFunctionComponentType, typename EnergySolver>
+void VMCPEPSExecutor<TenElemT, QNT, WaveFunctionComponentType, EnergySolver>::SampleEnergyAndHols_(
+    WaveFunctionComponentType &chain,
+    EnergySolver &solver,
+    SITPST &gten_sum,
+    SITPST &g_times_energy_sum,
+    SampleWorkspace &workspace) {
+  TensorNetwork2D<TenElemT, QNT> &holes = workspace.holes; // all the sites are overwritten by the solver
+  TenElemT energy_loc = solver.template CalEnergyAndHoles<WaveFunctionComponentType, true>(&split_index_tps_,
+                                                                                           &chain,
+                                                                                           holes);
   TenElemT energy_loc_conj = ComplexConjugate(energy_loc);
-  TenElemT inv_psi = ComplexConjugate(1.0 / tps_sample_.amplitude); //to divide the holes.
-  energy_samples_.push_back(energy_loc);
-  SITPST gten_sample(ly_, lx_, split_index_tps_.PhysicalDim());// only useful for Stochastic Reconfiguration
+  TenElemT inv_psi = ComplexConjugate(1.0 / chain.amplitude); //to divide the holes.
+  const bool store_sitps_sample = stochastic_reconfiguration_update_class_
+      && optimize_para.sr_sample_storage == SplitIndexTPSSamples;
+  const bool store_dense_sample = stochastic_reconfiguration_update_class_ && !store_sitps_sample;
+  const bool buffered = &workspace != &sample_workspaces_[0];
   for (size_t row = 0; row < ly_; row++) {
     for (size_t col = 0; col < lx_; col++) {
-      size_t basis = tps_sample_.config({row, col});
+      size_t basis = chain.config({row, col});
 //      Tensor *g_ten = new Tensor(), *gten_times_energy = new Tensor();
 //      *g_ten = inv_psi * holes({row, col});
 //      *gten_times_energy = energy_loc * (*g_ten);
 //      gten_samples_({row, col})[basis].push_back(g_ten);
 //      g_times_energy_samples_({row, col})[basis].push_back(gten_times_energy);
-      Tensor gten;
+      Tensor &gten = holes({row, col}); // reuse the hole buffer instead of a temporary
       if constexpr (Tensor::IsFermionic()) {
-        gten = CalGTenForFermionicTensors(holes({row, col}), tps_sample_.tn({row, col}));
-        // tps_sample_.tn({row, col})  is  split_index_tps_({row, col})[basis];
+        gten = CalGTenForFermionicTensors(holes({row, col}), chain.tn({row, col}));
+        // chain.tn({row, col})  is  split_index_tps_({row, col})[basis];
       } else {
-        gten = inv_psi * holes({row, col});  //holes should be dag in CalEnergyAndHoles function
+        gten *= inv_psi;  //holes should be dag in CalEnergyAndHoles function
       }
-      gten_sum_({row, col})[basis] += gten;
-      g_times_energy_sum_({row, col})[basis] += energy_loc_conj * gten;
-      //? when samples become large, does the summation reliable as the small number are added to large number.
-      if (stochastic_reconfiguration_update_class_) {
-        gten_sample({row, col})[basis] = gten;
+      AccumulateGradSample_(gten, energy_loc_conj, {row, col}, basis, gten_sum, g_times_energy_sum, workspace);
+    }
+  }
+  if (store_sitps_sample) {
+    // the stored sample gets copies, so that the hole buffers stay allocated in the workspace
+    SITPST gten_sample(ly_, lx_, split_index_tps_.PhysicalDim());
+    for (size_t row = 0; row < ly_; row++) {
+      for (size_t col = 0; col < lx_; col++) {
+        gten_sample({row, col})[chain.config({row, col})] = holes({row, col});
       }
     }
+    (buffered ? workspace.energy_samples : energy_samples_).push_back(energy_loc);
+    (buffered ? workspace.gten_samples : gten_samples_).emplace_back(std::move(gten_sample));
+    return;
   }
-  if (stochastic_reconfiguration_update_class_) {
-    gten_samples_.emplace_back(gten_sample);
+  (buffered ? workspace.energy_samples : energy_samples_).push_back(energy_loc);
+  if (store_dense_sample) {
+    SRDenseSMatrix<TenElemT, QNT> &dense_samples = buffered ? workspace.dense_samples : dense_s_matrix_;
+    for (size_t row = 0; row < ly_; row++) {
+      for (size_t col = 0; col < lx_; col++) {
+        size_t basis = chain.config({row, col});
+        dense_samples.AddSampleTensor({row, col}, basis, holes({row, col}));
+      }
+    }
+    dense_samples.FinishSample();
+  }
+}
+
+///< Append the samples buffered by the chains 1, 2, ... to the executor's containers, in chain order.
+template<typename TenElemT, typename QNT, typename WaveFunctionComponentType, typename EnergySolver>
+void VMCPEPSExecutor<TenElemT, QNT, WaveFunctionComponentType, EnergySolver>::FlushChainSamples_(void) {
+  for (size_t chain = 1; chain < sample_workspaces_.size(); chain++) {
+    SampleWorkspace &workspace = sample_workspaces_[chain];
+    energy_samples_.insert(energy_samples_.end(), workspace.energy_samples.cbegin(), workspace.energy_samples.cend());
+    workspace.energy_samples.clear();
+    for (SITPST &gten_sample : workspace.gten_samples) {
+      gten_samples_.emplace_back(std::move(gten_sample));
+    }
+    workspace.gten_samples.clear();
+    if (workspace.dense_samples.SampleNum() > 0) {
+      dense_s_matrix_.AppendSamples(workspace.dense_samples);
+      workspace.dense_samples.ClearSamples();
+    }
+  }
+}
+
+/**
+ * gten_sum += gten and g_times_energy_sum += energy_conj * gten on the site and component,
+ * by one fused pass over the raw data of the tensors, optionally with Kahan summation.
+ * The running sums have all the blocks; if gten lacks some of them, its blocks are accumulated one by one
+ * at their offsets in the sums, so that no aligned copy of gten is allocated.
+ */
+template<typename TenElemT, typename QNT, typename WaveFunctionComponentType, typename EnergySolver>
+void VMCPEPSExecutor<TenElemT, QNT, WaveFunctionComponentType, EnergySolver>::AccumulateGradSample_(
+    const Tensor &gten,
+    const TenElemT energy_conj,
+    const SiteIdx &site,
+    const size_t basis,
+    SITPST &gten_sum,
+    SITPST &g_times_energy_sum,
+    SampleWorkspace &workspace) {
+  Tensor &sum = gten_sum(site)[basis];
+  Tensor &e_sum = g_times_energy_sum(site)[basis];
+  if (gten.IsDefault() || sum.IsDefault()) {
+    return;
+  }
+  const bool kahan = optimize_para.accumulation_scheme == KahanSummation;
+  TenElemT *sum_data = sum.GetRawDataPtr(), *e_sum_data = e_sum.GetRawDataPtr();
+  TenElemT *sum_comp_data = kahan ? workspace.gten_sum_comp(site)[basis].GetRawDataPtr() : nullptr;
+  TenElemT *e_sum_comp_data = kahan ? workspace.g_times_energy_sum_comp(site)[basis].GetRawDataPtr() : nullptr;
+  // the same offset in the sum and in its Kahan compensations, which have the same layout
+  auto accumulate = [&](const size_t n, const TenElemT *x, const size_t offset) {
+    if (kahan) {
+      FusedAxpyAccumulateKahan(n, TenElemT(1.0), energy_conj, x,
+                               sum_data + offset, sum_comp_data + offset,
+                               e_sum_data + offset, e_sum_comp_data + offset);
+    } else {
+      FusedAxpyAccumulate(n, TenElemT(1.0), energy_conj, x, sum_data + offset, e_sum_data + offset);
+    }
+  };
+  if (gten.GetActualDataSize() == sum.GetActualDataSize()) {
+    accumulate(sum.GetActualDataSize(), gten.GetRawDataPtr(), 0);
+    return;
+  }
+  const auto &sum_blocks = sum.GetBlkSparDataTen().GetBlkIdxDataBlkMap();
+  const TenElemT *x = gten.GetRawDataPtr();
+  for (const auto &[blk_idx, blk] : gten.GetBlkSparDataTen().GetBlkIdxDataBlkMap()) {
+    const auto sum_blk = sum_blocks.find(blk_idx);
+    assert(sum_blk != sum_blocks.end() && sum_blk->second.size == blk.size);
+    accumulate(blk.size, x + blk.data_offset, sum_blk->second.data_offset);
+  }
+}
+
+///< Fold the Kahan compensations into the sums, and reset the compensations to zeros.
+template<typename TenElemT, typename QNT, typename WaveFunctionComponentType, typename EnergySolver>
+void VMCPEPSExecutor<TenElemT, QNT, WaveFunctionComponentType, EnergySolver>::KahanFinalize_(SITPST &sum,
+                                                                                             SITPST &comp) {
+  for (size_t row = 0; row < ly_; row++) {
+    for (size_t col = 0; col < lx_; col++) {
+      for (size_t compt = 0; compt < sum({row, col}).size(); compt++) {
+        Tensor &ten = sum({row, col})[compt];
+        if (!ten.IsDefault()) {
+          KahanFinalize(ten.GetActualDataSize(), ten.GetRawDataPtr(), comp({row, col})[compt].GetRawDataPtr());
+        }
+      }
+    }
   }
 }
 
 template<typename TenElemT, typename QNT, typename WaveFunctionComponentType, typename EnergySolver>
 TenElemT VMCPEPSExecutor<TenElemT, QNT, WaveFunctionComponentType, EnergySolver>::SampleEnergy_(void) {
+  return SampleEnergy_(tps_sample_, energy_solver_, sample_workspaces_[0]);
+}
+
+///< Sample the energy of the chain, appended to energy_samples_ or buffered as in SampleEnergyAndHols_.
+template<typename TenElemT, typename QNT, typename WaveFunctionComponentType, typename EnergySolver>
+TenElemT VMCPEPSExecutor<TenElemT, QNT, WaveFunctionComponentType, EnergySolver>::SampleEnergy_(
+    WaveFunctionComponentType &chain,
+    EnergySolver &solver,
+    SampleWorkspace &workspace) {
   TensorNetwork2D<TenElemT, QNT> holes(1, 1); //useless
-  TenElemT energy_loc = energy_solver_.template CalEnergyAndHoles<WaveFunctionComponentType, false>(&split_index_tps_,
-                                                                                                    &tps_sample_,
-                                                                                                    holes);
-  energy_samples_.push_back(energy_loc);
+  TenElemT energy_loc = solver.template CalEnergyAndHoles<WaveFunctionComponentType, false>(&split_index_tps_,
+                                                                                            &chain,
+                                                                                            holes);
+  (&workspace != &sample_workspaces_[0] ? workspace.energy_samples : energy_samples_).push_back(energy_loc);
   return energy_loc;
 }
 
@@ -621,25 +1285,35 @@ VMCPEPSExecutor<TenElemT, QNT, WaveFunctionComponentType, EnergySolver>::GatherS
   }
 
   //calculate grad in each processor
-  const size_t sample_num = optimize_para.mc_samples;
+  const size_t sample_num = energy_samples_.size(); // the same in all the processes
   gten_ave_ = gten_sum_ * (1.0 / sample_num);
   grad_ = g_times_energy_sum_ * (1.0 / sample_num) + ComplexConjugate(-energy) * gten_ave_;
 
-  for (size_t row = 0; row < ly_; row++) {
-    for (size_t col = 0; col < lx_; col++) {
-      const size_t phy_dim = grad_({row, col}).size();
-      for (size_t compt = 0; compt < phy_dim; compt++) {
-        // gather and estimate grad in master (and maybe the error bar of grad)
-        grad_({row, col})[compt] = MPIMeanTensor(grad_({row, col})[compt], comm_);
-        // note here the grad data except in master are clear
-        if (stochastic_reconfiguration_update_class_) {
-          gten_ave_({row, col})[compt] = MPIMeanTensor(gten_ave_({row, col})[compt], comm_);
-        }
-      }
+  // gather and estimate grad in master by one packed reduction.
+  // note here the grad data except in master are the local averages
+  if (tps_update_sharded_) {
+    // each process only gets the grad on its own sites, the S matrix needs gten_ave_ in master
+    MPIReduceScatterSplitIndexTPS(grad_, tps_shard_, comm_, 1.0 / double(mpi_size_));
+    if (stochastic_reconfiguration_update_class_) {
+      MPIMeanSplitIndexTPS<TenElemT, QNT>({&gten_ave_}, comm_);
     }
+  } else if (optimize_para.update_scheme == MinimumStochasticReconfiguration) {
+    // MinSR needs gten_ave_ in all the processes
+    MPIMeanSplitIndexTPS<TenElemT, QNT>({&grad_, &gten_ave_}, comm_, true);
+  } else if (stochastic_reconfiguration_update_class_) {
+    MPIMeanSplitIndexTPS<TenElemT, QNT>({&grad_, &gten_ave_}, comm_);
+  } else {
+    MPIMeanSplitIndexTPS<TenElemT, QNT>({&grad_}, comm_);
   }
   grad_.ActFermionPOps();
-  if (rank_ == kMPIMasterRank) {
+  if (tps_update_sharded_) {
+    double grad_norm = grad_.NormSquareOnSites(tps_shard_.SiteBegin(), tps_shard_.SiteEnd());
+    HANDLE_MPI_ERROR(::MPI_Reduce(rank_ == kMPIMasterRank ? MPI_IN_PLACE : &grad_norm, &grad_norm, 1,
+                                  MPI_DOUBLE, MPI_SUM, kMPIMasterRank, comm_));
+    if (rank_ == kMPIMasterRank) {
+      grad_norm_.push_back(grad_norm);
+    }
+  } else if (rank_ == kMPIMasterRank) {
     grad_norm_.push_back(grad_.NormSquare());
   }
   //do not broadcast because only broadcast the updated TPS
@@ -659,13 +1333,136 @@ void VMCPEPSExecutor<TenElemT,
                      WaveFunctionComponentType,
                      EnergySolver>::UpdateTPSByVecAndSynchronize_(const VMCPEPSExecutor::SITPST &grad,
                                                                   double step_len) {
+  if (tps_update_sharded_) {
+    ShardedUpdateTPS_(grad, step_len, false);
+  } else if (optimize_para.pipeline_stale_sweeps > 0) {
+    // the updated tensors have all the blocks, the same layout with the zeros in all processes.
+    SITPST new_tps = ZeroSplitIndexTPSWithAllBlocks(split_index_tps_);
+    if (rank_ == kMPIMasterRank) {
+      new_tps += split_index_tps_;
+      new_tps += (-step_len) * grad;
+      new_tps.ScaleMaxAbsForAllSite(1.0);
+    }
+    BroadCastTPSOverlapSweeps_(new_tps);
+    split_index_tps_ = std::move(new_tps);
+  } else if (optimize_para.tps_broadcast_scheme != PerTensorTPSBroadcast) {
+    BroadCastTPSUpdate_(grad, step_len);
+  } else {
+    if (rank_ == kMPIMasterRank) {
+      split_index_tps_ += (-step_len) * grad;
+      NormalizeTPS_();
+    }
+    BroadCast(split_index_tps_, comm_);
+    tps_broadcast_bytes_ = SplitIndexTPSDataSize(split_index_tps_) * sizeof(TenElemT);
+  }
+  // replace the tensors in place instead of rebuilding the component; environments are regrown in the next sweep.
+  Timer refresh_timer("tps_sample_refresh");
+  RefreshChainTensors_();
+  tps_sample_refresh_time_ = refresh_timer.Elapsed();
+}
+
+/**
+ * Broadcast new_tps from master by a non-blocking MPI_Ibcast of the packed data.
+ * During the broadcast, all the processes run optimize_para.pipeline_stale_sweeps Monte-Carlo sweeps
+ * on the current (previous) split_index_tps_, instead of idling while master updates and sends the TPS.
+ * Many MPI implementations only progress a non-blocking collective inside MPI calls, so the calling thread
+ * (chain 0) tests the request after each of its sweeps. The overlap is therefore at the granularity of a sweep,
+ * finer only with an asynchronous progress thread of the MPI library.
+ *
+ * new_tps should share the data layout in all the processes.
+ */
+template<typename TenElemT, typename QNT, typename WaveFunctionComponentType, typename EnergySolver>
+void VMCPEPSExecutor<TenElemT, QNT,
+                     WaveFunctionComponentType,
+                     EnergySolver>::BroadCastTPSOverlapSweeps_(SITPST &new_tps) {
+  std::vector<TenElemT> buffer(SplitIndexTPSDataSize(new_tps));
   if (rank_ == kMPIMasterRank) {
-    split_index_tps_ += (-step_len) * grad;
-    NormalizeTPS_();
+    PackSplitIndexTPSData(new_tps, buffer.data());
+  }
+  MPI_Request request;
+  HANDLE_MPI_ERROR(::MPI_Ibcast(buffer.data(), buffer.size(), hp_numeric::GetMPIDataType<TenElemT>(),
+                                kMPIMasterRank, comm_, &request));
+  int broadcast_done = 0;
+  ForEachChain_([this, &request, &broadcast_done](const size_t chain) {
+    std::uniform_real_distribution<double> u_double(0, 1);
+    std::vector<double> accept_rates;
+    for (size_t i = 0; i < optimize_para.pipeline_stale_sweeps; i++) {
+      random_engine.NextSweep();
+      Chain_(chain).MonteCarloSweepUpdate(split_index_tps_, u_double, accept_rates);
+      // chain 0 runs in the calling thread, the only one which calls MPI
+      if (chain == 0 && !broadcast_done) {
+        HANDLE_MPI_ERROR(::MPI_Test(&request, &broadcast_done, MPI_STATUS_IGNORE));
+      }
+    }
+  });
+  if (!broadcast_done) {
+    HANDLE_MPI_ERROR(::MPI_Wait(&request, MPI_STATUS_IGNORE));
+  }
+  if (rank_ != kMPIMasterRank) {
+    UnpackSplitIndexTPSData(buffer.data(), new_tps);
+  }
+}
+
+/**
+ * Move the TPS by -step_len * direction (given in master) and normalize it, with a single packed broadcast.
+ * The packed scheme broadcasts the updated TPS. The delta schemes broadcast -step_len * direction,
+ * optionally in float32 or bfloat16, and all the processes including master apply the decoded delta,
+ * so the TPS stays identical over the processes.
+ * The tensors are aligned to all the blocks, so that the data layout is known by all the processes.
+ */
+template<typename TenElemT, typename QNT, typename WaveFunctionComponentType, typename EnergySolver>
+void VMCPEPSExecutor<TenElemT, QNT, WaveFunctionComponentType, EnergySolver>::BroadCastTPSUpdate_(
+    const SITPST &direction, double step_len) {
+  const TPSBroadcastScheme scheme = optimize_para.tps_broadcast_scheme;
+  SITPST new_tps = ZeroSplitIndexTPSWithAllBlocks(split_index_tps_);
+  new_tps += split_index_tps_;
+  std::vector<TenElemT> buffer(SplitIndexTPSDataSize(new_tps));
+  if (scheme == PackedTPSBroadcast) {
+    if (rank_ == kMPIMasterRank) {
+      new_tps += (-step_len) * direction;
+      new_tps.ScaleMaxAbsForAllSite(1.0);
+      PackSplitIndexTPSData(new_tps, buffer.data());
+    }
+    HANDLE_MPI_ERROR(::MPI_Bcast(buffer.data(), buffer.size(), hp_numeric::GetMPIDataType<TenElemT>(),
+                                 kMPIMasterRank, comm_));
+    if (rank_ != kMPIMasterRank) {
+      UnpackSplitIndexTPSData(buffer.data(), new_tps);
+    }
+    tps_broadcast_bytes_ = buffer.size() * sizeof(TenElemT);
+  } else {
+    SITPST delta = ZeroSplitIndexTPSWithAllBlocks(split_index_tps_);
+    if (rank_ == kMPIMasterRank) {
+      delta += (-step_len) * direction;
+      PackSplitIndexTPSData(delta, buffer.data());
+    }
+    // the real and imaginary parts are encoded as separate doubles
+    double *real_data = reinterpret_cast<double *>(buffer.data());
+    const size_t real_size = buffer.size() * (sizeof(TenElemT) / sizeof(double));
+    if (scheme == DeltaTPSBroadcast) {
+      HANDLE_MPI_ERROR(::MPI_Bcast(real_data, real_size, MPI_DOUBLE, kMPIMasterRank, comm_));
+      tps_broadcast_bytes_ = real_size * sizeof(double);
+    } else if (scheme == DeltaFloatTPSBroadcast) {
+      std::vector<float> encoded(real_size);
+      if (rank_ == kMPIMasterRank) {
+        EncodeFloat(real_data, real_size, encoded.data());
+      }
+      HANDLE_MPI_ERROR(::MPI_Bcast(encoded.data(), real_size, MPI_FLOAT, kMPIMasterRank, comm_));
+      DecodeFloat(encoded.data(), real_size, real_data);
+      tps_broadcast_bytes_ = real_size * sizeof(float);
+    } else {
+      std::vector<uint16_t> encoded(real_size);
+      if (rank_ == kMPIMasterRank) {
+        EncodeBF16(real_data, real_size, encoded.data());
+      }
+      HANDLE_MPI_ERROR(::MPI_Bcast(encoded.data(), real_size, MPI_UINT16_T, kMPIMasterRank, comm_));
+      DecodeBF16(encoded.data(), real_size, real_data);
+      tps_broadcast_bytes_ = real_size * sizeof(uint16_t);
+    }
+    UnpackSplitIndexTPSData(buffer.data(), delta);
+    new_tps += delta;
+    new_tps.ScaleMaxAbsForAllSite(1.0);
   }
-  BroadCast(split_index_tps_, comm_);
-  Configuration config = tps_sample_.config;
-  tps_sample_ = WaveFunctionComponentType(split_index_tps_, config);
+  split_index_tps_ = std::move(new_tps);
 }
 
 template<typename TenElemT, typename QNT, typename WaveFunctionComponentType, typename EnergySolver>
@@ -673,6 +1470,11 @@ void VMCPEPSExecutor<TenElemT, QNT,
                      WaveFunctionComponentType,
                      EnergySolver>::BoundGradElementUpdateTPS_(VMCPEPSExecutor::SITPST &grad,
                                                                double step_len) {
+  if (tps_update_sharded_) {
+    ShardedUpdateTPS_(grad, step_len, true);
+    return;
+  }
+  const bool packed_broadcast = (optimize_para.tps_broadcast_scheme != PerTensorTPSBroadcast);
   if (rank_ == kMPIMasterRank) {
     for (size_t row = 0; row < ly_; row++)
       for (size_t col = 0; col < lx_; col++) {
@@ -680,12 +1482,74 @@ void VMCPEPSExecutor<TenElemT, QNT,
         for (size_t compt = 0; compt < phy_dim; compt++) {
           Tensor &grad_ten = grad({row, col})[compt];
           grad_ten.ElementWiseBoundTo(step_len);
-          split_index_tps_({row, col})[compt] += (-step_len) * grad_ten;
+          if (!packed_broadcast) {
+            split_index_tps_({row, col})[compt] += (-step_len) * grad_ten;
+          }
         }
       }
-    NormalizeTPS_();
+    if (!packed_broadcast) {
+      NormalizeTPS_();
+    }
+  }
+  if (packed_broadcast) {
+    BroadCastTPSUpdate_(grad, step_len);
+  } else {
+    BroadCast(split_index_tps_, comm_);
+    tps_broadcast_bytes_ = SplitIndexTPSDataSize(split_index_tps_) * sizeof(TenElemT);
   }
-  BroadCast(split_index_tps_, comm_);
+}
+
+/**
+ * Sharded version of the TPS update. Each process moves and normalizes the tensors of its own sites
+ * by its shard of grad, then the updated sites are all-gathered by one MPI_Allgatherv.
+ * The updated tensors have all the blocks, so that the data layout is the same in all the processes.
+ */
+template<typename TenElemT, typename QNT, typename WaveFunctionComponentType, typename EnergySolver>
+void VMCPEPSExecutor<TenElemT, QNT, WaveFunctionComponentType, EnergySolver>::ShardedUpdateTPS_(
+    const SITPST &grad, double step_len, const bool bound_grad_element) {
+  SITPST new_tps = ZeroSplitIndexTPSWithAllBlocks(split_index_tps_);
+  for (size_t site = tps_shard_.SiteBegin(); site < tps_shard_.SiteEnd(); site++) {
+    const SiteIdx site_idx = {site / lx_, site % lx_};
+    for (size_t compt = 0; compt < new_tps(site_idx).size(); compt++) {
+      Tensor &ten = new_tps(site_idx)[compt];
+      if (ten.IsDefault()) {
+        continue;
+      }
+      ten += split_index_tps_(site_idx)[compt];
+      if (grad(site_idx)[compt].IsDefault()) {
+        continue;
+      }
+      Tensor grad_ten = grad(site_idx)[compt];
+      if (bound_grad_element) {
+        grad_ten.ElementWiseBoundTo(step_len);
+      }
+      ten += (-step_len) * grad_ten;
+    }
+    new_tps.ScaleMaxAbsForSite(site_idx, 1.0);
+  }
+  MPIAllGatherSplitIndexTPS(new_tps, tps_shard_, comm_);
+  split_index_tps_ = std::move(new_tps);
+}
+
+template<typename TenElemT, typename QNT, typename WaveFunctionComponentType, typename EnergySolver>
+bool VMCPEPSExecutor<TenElemT, QNT, WaveFunctionComponentType, EnergySolver>::ShardedTPSUpdateSupported_(void) const {
+  switch (optimize_para.update_scheme) {
+    case StochasticGradient:
+    case BoundGradientElement:break;
+    case StochasticReconfiguration:
+    case NormalizedStochasticReconfiguration: {
+      if (!optimize_para.cg_params.has_value()) {
+        return false;
+      }
+      const ConjugateGradientParams &cg_params = optimize_para.cg_params.value();
+      if (cg_params.preconditioner != NoSRPreconditioner || cg_params.recycle_dim > 0) {
+        return false;
+      }
+      break;
+    }
+    default:return false;
+  }
+  return optimize_para.pipeline_stale_sweeps == 0;
 }
 
 template<typename TenElemT, typename QNT, typename WaveFunctionComponentType, typename EnergySolver>
@@ -704,6 +1568,122 @@ std::pair<size_t, double> VMCPEPSExecutor<TenElemT,
   return std::make_pair(cgsolver_iter, natural_grad_norm);
 }
 
+template<typename TenElemT, typename QNT, typename WaveFunctionComponentType, typename EnergySolver>
+double VMCPEPSExecutor<TenElemT, QNT, WaveFunctionComponentType, EnergySolver>::MinSRUpdateTPS_(
+    double step_len,
+    const TenElemT energy) {
+  natural_grad_ = MinSRNaturalGradient(dense_s_matrix_, gten_ave_, energy_samples_, energy,
+                                       optimize_para.cg_params.value().diag_shift, comm_);
+  double natural_grad_norm = natural_grad_.NormSquare();
+  UpdateTPSByVecAndSynchronize_(natural_grad_, step_len);
+  return natural_grad_norm;
+}
+
+/**
+ * Update by Momentum, Adam or AMSGrad. The moments are kept in master, with all the blocks
+ * so that the element-wise updates work on the raw data.
+ */
+template<typename TenElemT, typename QNT, typename WaveFunctionComponentType, typename EnergySolver>
+void VMCPEPSExecutor<TenElemT, QNT, WaveFunctionComponentType, EnergySolver>::MomentUpdateTPS_(double step_len) {
+  const WAVEFUNCTION_UPDATE_SCHEME scheme = optimize_para.update_scheme;
+  const SITPST *update_dir = &grad_; // only used in master
+  SITPST adam_dir;
+  if (rank_ == kMPIMasterRank) {
+    const MomentOptimizerPara &para = optimize_para.moment_para;
+    if (moment_step_ == 0) {
+      first_moment_ = ZeroSplitIndexTPSWithAllBlocks(grad_);
+      if (scheme != Momentum) {
+        second_moment_ = first_moment_;
+      }
+      if (scheme == AMSGrad) {
+        second_moment_max_ = first_moment_;
+      }
+    }
+    moment_step_++;
+    if (scheme == Momentum) {
+      first_moment_ *= para.beta1;
+      first_moment_ += grad_;
+      update_dir = &first_moment_;
+    } else {
+      const bool amsgrad = (scheme == AMSGrad);
+      const double bias1 = 1.0 - std::pow(para.beta1, double(moment_step_));
+      const double bias2 = 1.0 - std::pow(para.beta2, double(moment_step_));
+      adam_dir = first_moment_;
+      for (size_t row = 0; row < ly_; row++) {
+        for (size_t col = 0; col < lx_; col++) {
+          for (size_t compt = 0; compt < first_moment_({row, col}).size(); compt++) {
+            Tensor &m = first_moment_({row, col})[compt];
+            if (m.IsDefault()) {
+              continue;
+            }
+            const Tensor &g = grad_({row, col})[compt];
+            const TenElemT *pg = g.IsDefault() ? nullptr : g.GetRawDataPtr();
+            Tensor aligned_g;
+            if (g.IsDefault() || g.GetActualDataSize() != m.GetActualDataSize()) {
+              aligned_g = ZeroTensorWithAllBlocks(m);
+              if (!g.IsDefault()) {
+                aligned_g += g;
+              }
+              pg = aligned_g.GetRawDataPtr();
+            }
+            Tensor &v = second_moment_({row, col})[compt];
+            TenElemT *pv_max = amsgrad ? second_moment_max_({row, col})[compt].GetRawDataPtr() : nullptr;
+            const size_t n = m.GetActualDataSize();
+            AdamMomentUpdate(n, para.beta1, para.beta2, pg, m.GetRawDataPtr(), v.GetRawDataPtr(), pv_max);
+            AdamDirection(n, bias1, bias2, para.epsilon, m.GetRawDataPtr(), amsgrad ? pv_max : v.GetRawDataPtr(),
+                          adam_dir({row, col})[compt].GetRawDataPtr());
+          }
+        }
+      }
+      update_dir = &adam_dir;
+    }
+  }
+  UpdateTPSByVecAndSynchronize_(*update_dir, step_len);
+}
+
+///< Dump the moments in master next to the TPS, so that the optimization can be continued
+template<typename TenElemT, typename QNT, typename WaveFunctionComponentType, typename EnergySolver>
+void VMCPEPSExecutor<TenElemT, QNT, WaveFunctionComponentType, EnergySolver>::DumpMoments_(
+    const std::string &tps_path) {
+  if (moment_step_ == 0) {
+    return;
+  }
+  first_moment_.Dump(tps_path + "moment1");
+  if (optimize_para.update_scheme == Adam || optimize_para.update_scheme == AMSGrad) {
+    second_moment_.Dump(tps_path + "moment2");
+  }
+  if (optimize_para.update_scheme == AMSGrad) {
+    second_moment_max_.Dump(tps_path + "moment2max");
+  }
+  std::ofstream ofs(tps_path + "moment1/moment_step");
+  ofs << moment_step_;
+  ofs.close();
+}
+
+///< Load the moments dumped by DumpMoments_. Return false and start from zero moments if they are absent.
+template<typename TenElemT, typename QNT, typename WaveFunctionComponentType, typename EnergySolver>
+bool VMCPEPSExecutor<TenElemT, QNT, WaveFunctionComponentType, EnergySolver>::LoadMoments_(
+    const std::string &tps_path) {
+  moment_step_ = 0;
+  std::ifstream ifs(tps_path + "moment1/moment_step");
+  size_t step(0);
+  if (!(ifs >> step) || step == 0) {
+    return false;
+  }
+  const bool adam = (optimize_para.update_scheme == Adam || optimize_para.update_scheme == AMSGrad);
+  first_moment_ = SITPST(ly_, lx_);
+  second_moment_ = SITPST(ly_, lx_);
+  second_moment_max_ = SITPST(ly_, lx_);
+  if (!first_moment_.Load(tps_path + "moment1")
+      || (adam && !second_moment_.Load(tps_path + "moment2"))
+      || (optimize_para.update_scheme == AMSGrad && !second_moment_max_.Load(tps_path + "moment2max"))) {
+    std::cout << "Loading the moments fails, start from zero moments." << std::endl;
+    return false;
+  }
+  moment_step_ = step;
+  return true;
+}
+
 ///< Normalize split index tps according to the max abs of tensors in each site
 template<typename TenElemT, typename QNT, typename WaveFunctionComponentType, typename EnergySolver>
 void VMCPEPSExecutor<TenElemT,
@@ -721,46 +1701,295 @@ size_t VMCPEPSExecutor<TenElemT, QNT, WaveFunctionComponentType, EnergySolver>::
     pgten_ave_ = &gten_ave_;
   }
   const ConjugateGradientParams &cg_params = optimize_para.cg_params.value();
-  SRSMatrix s_matrix(&gten_samples_, pgten_ave_, mpi_size_);
-  s_matrix.diag_shift = cg_params.diag_shift;
   size_t cgsolver_iter;
+  auto solve = [&](const auto &s_matrix, const SITPST &b) {
+    auto cg_solve = [&](const SITPST &x0, size_t &iter) {
+      if (tps_update_sharded_) {
+        return ConjugateGradientSolverSharded(s_matrix, b, x0,
+                                              cg_params.max_iter, cg_params.tolerance,
+                                              cg_params.residue_restart_step, iter, tps_shard_, comm_);
+      }
+      if (cg_params.preconditioner != NoSRPreconditioner) {
+        return PreconditionedConjugateGradientSolver(s_matrix, b, x0, sr_preconditioner_,
+                                                     cg_params.max_iter, cg_params.tolerance,
+                                                     cg_params.residue_restart_step, iter, comm_,
+                                                     cg_params.parallel_scheme);
+      }
+      return ConjugateGradientSolver(s_matrix, b, x0,
+                                     cg_params.max_iter, cg_params.tolerance,
+                                     cg_params.residue_restart_step, iter, comm_, cg_params.parallel_scheme);
+    };
+    if (cg_params.recycle_dim == 0) {
+      return cg_solve(init_guess, cgsolver_iter);
+    }
+    size_t plain_iter(0);
+    if (cg_params.recycle_benchmark) {
+      cg_solve(init_guess, plain_iter);
+    }
+    size_t projection_matvec(0);
+    SITPST res = cg_solve(RecycledInitialGuess(s_matrix, b, init_guess, sr_recycle_space_,
+                                               comm_, cg_params.parallel_scheme, &projection_matvec), cgsolver_iter);
+    if (cg_params.parallel_scheme != MasterSlaveCG || rank_ == kMPIMasterRank) {
+      sr_recycle_space_.Add(res);
+    }
+    // each CG iteration costs one S * v, and so does each basis vector of the projection
+    sr_saved_iter_ = long(plain_iter) - long(cgsolver_iter) - long(projection_matvec);
+    return res;
+  };
+  if (cg_params.preconditioner != NoSRPreconditioner) {
+    BuildSRPreconditioner_();
+  }
+  SITPST signed_grad = grad;
   if constexpr (QLTensor<TenElemT, QNT>::IsFermionic()) {
-    auto signed_grad = grad;
     signed_grad.ActFermionPOps();   // Act back
-    natural_grad_ = ConjugateGradientSolver(s_matrix, signed_grad, init_guess,
-                                            cg_params.max_iter, cg_params.tolerance,
-                                            cg_params.residue_restart_step, cgsolver_iter, comm_);
-    natural_grad_.ActFermionPOps(); // question: why works?
+  }
+  if (optimize_para.sr_sample_storage == SplitIndexTPSSamples) {
+    SRSMatrix s_matrix(&gten_samples_, pgten_ave_, mpi_size_);
+    s_matrix.diag_shift = cg_params.diag_shift;
+    natural_grad_ = solve(s_matrix, signed_grad);
   } else {
-    natural_grad_ = ConjugateGradientSolver(s_matrix, grad, init_guess,
-                                            cg_params.max_iter, cg_params.tolerance,
-                                            cg_params.residue_restart_step, cgsolver_iter, comm_);
+    dense_s_matrix_.SetAverageAndWorldSize(pgten_ave_, mpi_size_);
+    dense_s_matrix_.diag_shift = cg_params.diag_shift;
+    natural_grad_ = solve(dense_s_matrix_, signed_grad);
+  }
+  if constexpr (QLTensor<TenElemT, QNT>::IsFermionic()) {
+    natural_grad_.ActFermionPOps(); // question: why works?
   }
-
   return cgsolver_iter;
 }
 
+///< Build the SR preconditioner from the O_k samples of all the processes
+template<typename TenElemT, typename QNT, typename WaveFunctionComponentType, typename EnergySolver>
+void VMCPEPSExecutor<TenElemT, QNT, WaveFunctionComponentType, EnergySolver>::BuildSRPreconditioner_(void) {
+  const ConjugateGradientParams &cg_params = optimize_para.cg_params.value();
+  sr_preconditioner_ = SRPreconditioner<TenElemT, QNT>(cg_params.preconditioner);
+  sr_preconditioner_.Reset(split_index_tps_);
+  if (optimize_para.sr_sample_storage == SplitIndexTPSSamples) {
+    for (const SITPST &gten_sample : gten_samples_) {
+      sr_preconditioner_.AddSample(gten_sample);
+    }
+  } else {
+    std::vector<TenElemT> buffer;
+    for (size_t row = 0; row < ly_; row++) {
+      for (size_t col = 0; col < lx_; col++) {
+        for (size_t compt = 0; compt < split_index_tps_({row, col}).size(); compt++) {
+          size_t row_num;
+          const TenElemT *rows = dense_s_matrix_.BlockRows({row, col}, compt, row_num, buffer);
+          sr_preconditioner_.AddConjugateRows({row, col}, compt, rows, row_num);
+        }
+      }
+    }
+    sr_preconditioner_.AddSampleNum(dense_s_matrix_.SampleNum());
+  }
+  sr_preconditioner_.Build(rank_ == kMPIMasterRank ? &gten_ave_ : nullptr, cg_params.diag_shift, comm_,
+                           cg_params.parallel_scheme != MasterSlaveCG);
+}
+
 template<typename TenElemT, typename QNT, typename WaveFunctionComponentType, typename EnergySolver>
 void VMCPEPSExecutor<TenElemT, QNT, WaveFunctionComponentType, EnergySolver>::GradientRandElementSign_() {
-  if (rank_ == kMPIMasterRank)
+  if (rank_ == kMPIMasterRank) {
+    std::mt19937 sign_engine(random_engine()); // the generator type of the tensor interface
     for (size_t row = 0; row < ly_; row++) {
       for (size_t col = 0; col < lx_; col++) {
         size_t dim = split_index_tps_({row, col}).size();
         for (size_t i = 0; i < dim; i++)
-          grad_({row, col})[i].ElementWiseRandSign(unit_even_distribution, random_engine);
+          grad_({row, col})[i].ElementWiseRandSign(unit_even_distribution, sign_engine);
       }
     }
+  }
 }
 
 template<typename TenElemT, typename QNT, typename WaveFunctionComponentType, typename EnergySolver>
 std::vector<double> VMCPEPSExecutor<TenElemT, QNT, WaveFunctionComponentType, EnergySolver>::MCSweep_(void) {
+  return MCSweep_(tps_sample_);
+}
+
+template<typename TenElemT, typename QNT, typename WaveFunctionComponentType, typename EnergySolver>
+std::vector<double> VMCPEPSExecutor<TenElemT, QNT, WaveFunctionComponentType, EnergySolver>::MCSweep_(
+    WaveFunctionComponentType &chain) {
+  std::uniform_real_distribution<double> u_double(0, 1);
   std::vector<double> accept_rates;
   for (size_t i = 0; i < optimize_para.mc_sweeps_between_sample; i++) {
-    tps_sample_.MonteCarloSweepUpdate(split_index_tps_, unit_even_distribution, accept_rates);
+    random_engine.NextSweep(); // key the draws of the sweep by its index, see PhiloxEngine
+    chain.MonteCarloSweepUpdate(split_index_tps_, u_double, accept_rates);
   }
   return accept_rates;
 }
 
+/**
+ * Run task(chain) for all the Markov chains (indices) in this process, chain 0 in the calling thread
+ * and the others in separate threads. The random stream of each chain is installed into
+ * the (thread local) random_engine of its thread during the task.
+ */
+template<typename TenElemT, typename QNT, typename WaveFunctionComponentType, typename EnergySolver>
+template<typename ChainTask>
+void VMCPEPSExecutor<TenElemT, QNT, WaveFunctionComponentType, EnergySolver>::ForEachChain_(ChainTask &&task) {
+  const size_t chain_num = ChainNum_();
+  if (chain_num == 1) {
+    task(0);
+    return;
+  }
+  auto run_chain = [this, &task](const size_t chain) {
+    std::swap(random_engine, chain_random_engines_[chain]);
+    task(chain);
+    std::swap(random_engine, chain_random_engines_[chain]);
+  };
+  std::vector<std::thread> workers;
+  workers.reserve(chain_num - 1);
+  for (size_t chain = 1; chain < chain_num; chain++) {
+    workers.emplace_back(run_chain, chain);
+  }
+  run_chain(0);
+  for (auto &worker : workers) {
+    worker.join();
+  }
+}
+
+/**
+ * Sample optimize_para.mc_samples times in this process, distributed over the Markov chains.
+ * The gradient tensors are accumulated in each chain, and reduced into gten_sum_ and g_times_energy_sum_
+ * in this process before any MPI communication.
+ *
+ * With optimize_para.adaptive_sampling, the samples are taken in rounds of check_interval samples,
+ * and the sampling stops once AdaptiveSamplingStop_ says so. All the processes take the same number of samples.
+ *
+ * @param calc_holes whether to calculate the holes (gradient) or only the energy
+ * @param abort_energy the line search point is aborted if its energy is clearly above abort_energy
+ * @return the average acceptance rates
+ */
+template<typename TenElemT, typename QNT, typename WaveFunctionComponentType, typename EnergySolver>
+std::vector<double> VMCPEPSExecutor<TenElemT, QNT, WaveFunctionComponentType, EnergySolver>::MCSampling_(
+    const bool calc_holes,
+    const double abort_energy) {
+  const size_t chain_num = ChainNum_();
+  std::vector<std::vector<double>> chain_accept_rates(chain_num);
+  std::vector<SITPST> chain_gten_sums(chain_num - 1), chain_g_times_energy_sums(chain_num - 1);
+  if (calc_holes) {
+    for (size_t i = 0; i < chain_num - 1; i++) {
+      chain_gten_sums[i] = gten_sum_;  // zeros with all the blocks
+      chain_g_times_energy_sums[i] = g_times_energy_sum_;
+    }
+  }
+  std::vector<EnergySolver> chain_solvers(chain_num - 1, energy_solver_); // the other chains do not share the solver
+  const bool adaptive = optimize_para.adaptive_sampling.has_value();
+  const size_t max_samples = adaptive ? optimize_para.adaptive_sampling.value().max_samples : optimize_para.mc_samples;
+  const size_t check_interval = adaptive ? optimize_para.adaptive_sampling.value().check_interval : max_samples;
+  size_t sampled_num = 0;
+  sampling_aborted_ = false;
+  while (sampled_num < max_samples) {
+    const size_t round_samples = std::min(check_interval, max_samples - sampled_num);
+    ForEachChain_([&](const size_t chain) {
+      WaveFunctionComponentType &chain_sample = Chain_(chain);
+      const size_t sample_num = round_samples / chain_num + (chain < round_samples % chain_num);
+      EnergySolver &solver = chain == 0 ? energy_solver_ : chain_solvers[chain - 1];
+      SITPST &gten_sum = chain == 0 ? gten_sum_ : chain_gten_sums[chain - 1];
+      SITPST &g_times_energy_sum = chain == 0 ? g_times_energy_sum_ : chain_g_times_energy_sums[chain - 1];
+      std::vector<double> &accept_rates_accum = chain_accept_rates[chain];
+      for (size_t sweep = 0; sweep < sample_num; sweep++) {
+        std::vector<double> accept_rates = MCSweep_(chain_sample);
+        if (accept_rates_accum.empty()) {
+          accept_rates_accum = accept_rates;
+        } else {
+          for (size_t i = 0; i < accept_rates_accum.size(); i++) {
+            accept_rates_accum[i] += accept_rates[i];
+          }
+        }
+        const TenElemT psi_sweep = chain_sample.amplitude;
+        if (calc_holes) {
+          SampleEnergyAndHols_(chain_sample, solver, gten_sum, g_times_energy_sum, sample_workspaces_[chain]);
+        } else {
+          SampleEnergy_(chain_sample, solver, sample_workspaces_[chain]);
+        }
+        if (WaveFunctionComponentType::sweep_trun_para.has_value()) {
+          CheckSweepAmplitude_(psi_sweep, chain_sample.amplitude);
+        }
+      }
+    });
+    FlushChainSamples_();
+    if (sweep_amplitude_drift_) { // no chain is running, safe to change the static truncation parameter
+      WaveFunctionComponentType::sweep_trun_para = std::nullopt;
+      sweep_amplitude_drift_ = false;
+      std::cout << "Proc " << std::setw(4) << rank_
+                << " : the sweep amplitudes drift, fall back to the BMPS truncation of the energy solver." << std::endl;
+    }
+    sampled_num += round_samples;
+    if (adaptive && AdaptiveSamplingStop_(sampled_num, abort_energy)) {
+      break;
+    }
+  }
+  if (calc_holes && optimize_para.accumulation_scheme == KahanSummation) {
+    for (size_t chain = 0; chain < chain_num; chain++) {
+      SampleWorkspace &workspace = sample_workspaces_[chain];
+      KahanFinalize_(chain == 0 ? gten_sum_ : chain_gten_sums[chain - 1], workspace.gten_sum_comp);
+      KahanFinalize_(chain == 0 ? g_times_energy_sum_ : chain_g_times_energy_sums[chain - 1],
+                     workspace.g_times_energy_sum_comp);
+    }
+  }
+  if (calc_holes) {
+    for (size_t i = 0; i < chain_num - 1; i++) {
+      gten_sum_ += chain_gten_sums[i];
+      g_times_energy_sum_ += chain_g_times_energy_sums[i];
+    }
+  }
+  std::vector<double> accept_rates_avg = chain_accept_rates[0];
+  for (size_t chain = 1; chain < chain_num; chain++) {
+    for (size_t i = 0; i < accept_rates_avg.size() && i < chain_accept_rates[chain].size(); i++) {
+      accept_rates_avg[i] += chain_accept_rates[chain][i];
+    }
+  }
+  for (double &rates : accept_rates_avg) {
+    rates /= double(sampled_num);
+  }
+  return accept_rates_avg;
+}
+
+/**
+ * Compare the amplitude of the sweep, contracted with the sweep truncation, with the one recomputed
+ * by the energy solver, and flag the drift if they are inconsistent.
+ */
+template<typename TenElemT, typename QNT, typename WaveFunctionComponentType, typename EnergySolver>
+void VMCPEPSExecutor<TenElemT, QNT, WaveFunctionComponentType, EnergySolver>::CheckSweepAmplitude_(
+    const TenElemT psi_sweep, const TenElemT psi) {
+  const double tolerance = optimize_para.sweep_truncation.value().amplitude_tolerance;
+  if (!WaveFunctionAmplitudeConsistencyCheck(std::vector<TenElemT>{psi_sweep, psi}, tolerance)) {
+    sweep_amplitude_drift_ = true;
+  }
+}
+
+/**
+ * Estimate the energy and its error over the processes in sampling_comm_ from the samples up to now,
+ * by one MPI_Allreduce of (sum E, sum E^2, sample number), using the real part of the local energies.
+ * The samples are treated as independent.
+ *
+ * @return whether to stop sampling: the relative error reaches the target after min_samples,
+ *         or the energy is clearly above abort_energy (sampling_aborted_ is set then).
+ */
+template<typename TenElemT, typename QNT, typename WaveFunctionComponentType, typename EnergySolver>
+bool VMCPEPSExecutor<TenElemT, QNT, WaveFunctionComponentType, EnergySolver>::AdaptiveSamplingStop_(
+    const size_t sampled_num,
+    const double abort_energy) {
+  const AdaptiveSamplingPara &para = optimize_para.adaptive_sampling.value();
+  if (sampled_num < para.min_samples) {
+    return false;
+  }
+  double moments[3] = {0.0, 0.0, double(energy_samples_.size())};
+  for (const TenElemT &energy : energy_samples_) {
+    const double e = Real(energy);
+    moments[0] += e;
+    moments[1] += e * e;
+  }
+  HANDLE_MPI_ERROR(::MPI_Allreduce(MPI_IN_PLACE, moments, 3, MPI_DOUBLE, MPI_SUM, sampling_comm_));
+  const double n = moments[2];
+  const double mean = moments[0] / n;
+  const double variance = std::max(moments[1] / n - mean * mean, 0.0);
+  const double err = std::sqrt(variance / std::max(n - 1.0, 1.0));
+  if (para.line_search_abort_sigma > 0.0 && mean - para.line_search_abort_sigma * err > abort_energy) {
+    sampling_aborted_ = true;
+    return true;
+  }
+  return err <= para.target_relative_error * std::abs(mean);
+}
+
 template<typename TenElemT, typename QNT, typename WaveFunctionComponentType, typename EnergySolver>
 void VMCPEPSExecutor<TenElemT, QNT, WaveFunctionComponentType, EnergySolver>::LoadTenData(void) {
   LoadTenData(optimize_para.wavefunction_path);
@@ -776,8 +2005,27 @@ void VMCPEPSExecutor<TenElemT, QNT, WaveFunctionComponentType, EnergySolver>::Lo
 
 template<typename TenElemT, typename QNT, typename WaveFunctionComponentType, typename EnergySolver>
 void VMCPEPSExecutor<TenElemT, QNT, WaveFunctionComponentType, EnergySolver>::InitConfigs_(const std::string &path) {
+  // stream 0 of the process is random_engine itself, so the chains are keyed from 1
+  chain_random_engines_.clear();
+  if (optimize_para.mc_chains > 1) {
+    for (size_t chain = 0; chain < optimize_para.mc_chains; chain++) {
+      chain_random_engines_.emplace_back(random_seed_, rank_, chain + 1);
+    }
+  }
+  // the preset configuration, randomized in the random stream of the chain if only the occupation is preset
+  auto preset_config = [this](const size_t chain) {
+    if (!optimize_para.init_occupancy.has_value()) {
+      return optimize_para.init_config;
+    }
+    Configuration config(ly_, lx_);
+    config.Random(optimize_para.init_occupancy.value(),
+                  chain_random_engines_.empty() ? random_engine : chain_random_engines_[chain]);
+    return config;
+  };
+
   Configuration config(ly_, lx_);
   bool load_config = config.Load(path, rank_);
+  Timer build_timer("tps_sample_build");
   if (load_config) {
     tps_sample_ = WaveFunctionComponentType(split_index_tps_, config);
     warm_up_ = true;
@@ -785,9 +2033,22 @@ void VMCPEPSExecutor<TenElemT, QNT, WaveFunctionComponentType, EnergySolver>::In
     std::cout << "Loading configuration in rank " << rank_
               << " fails. Use preset configuration and random warm up."
               << std::endl;
-    tps_sample_ = WaveFunctionComponentType(split_index_tps_, optimize_para.init_config);
+    tps_sample_ = WaveFunctionComponentType(split_index_tps_, preset_config(0));
     warm_up_ = false;
   }
+  tps_sample_build_time_ = build_timer.Elapsed();
+
+  // the other chains are labeled by chain * mpi_size_ + rank_ in the configuration files
+  tps_sample_chains_.clear();
+  for (size_t chain = 1; chain < optimize_para.mc_chains; chain++) {
+    Configuration chain_config(ly_, lx_);
+    if (chain_config.Load(path, chain * mpi_size_ + rank_)) {
+      tps_sample_chains_.emplace_back(split_index_tps_, chain_config);
+    } else {
+      tps_sample_chains_.emplace_back(split_index_tps_, preset_config(chain));
+      warm_up_ = false;
+    }
+  }
 }
 
 template<typename TenElemT, typename QNT, typename WaveFunctionComponentType, typename EnergySolver>
@@ -802,12 +2063,15 @@ void VMCPEPSExecutor<TenElemT, QNT, WaveFunctionComponentType, EnergySolver>::Du
   if (rank_ == kMPIMasterRank) {
     split_index_tps_.Dump(tps_path, release_mem);
     tps_lowest_.Dump(tps_path + "lowest", release_mem);
+    DumpMoments_(tps_path);
     if (!qlmps::IsPathExist(energy_data_path)) {
       qlmps::CreatPath(energy_data_path);
     }
   }
   MPI_Barrier(comm_); // configurations dump will collapse when creating path if there is no barrier.
-  tps_sample_.config.Dump(tps_path, rank_);
+  for (size_t chain = 0; chain < ChainNum_(); chain++) {
+    Chain_(chain).config.Dump(tps_path, chain * mpi_size_ + rank_);
+  }
   DumpVecData(energy_data_path + "/energy_sample" + std::to_string(rank_), energy_samples_);
   if (rank_ == kMPIMasterRank) {
     DumpVecData(energy_data_path + "/energy_trajectory", energy_trajectory_);
@@ -21,11 +21,42 @@ class WaveFunctionComponent {
   TenElemT amplitude;
 
   static std::optional<BMPSTruncatePara> trun_para;
+  /**
+   * If set, the boundary MPS of the Monte-Carlo sweeps are truncated by sweep_trun_para instead of trun_para,
+   * e.g. with a smaller bond dimension. The energy solvers always use trun_para.
+   */
+  static std::optional<BMPSTruncatePara> sweep_trun_para;
+  /**
+   * If true, the energy solvers reuse the left boundary MPS which the vertical pass of the last Monte-Carlo sweep
+   * leaves consistent with the final configuration, instead of regrowing the right ones. Only effective when the
+   * sweeps are truncated by trun_para.
+   */
+  static bool reuse_sweep_bmps;
+  /**
+   * Threads of the NN bond traces, passed to TensorNetwork2D::SetBondTraceThreads by the samplers.
+   * Unmeasured above 1, and likely a loss for the single-pair proposals (see VMCOptimizePara::bond_trace_threads).
+   */
+  static size_t bond_trace_threads;
 
   WaveFunctionComponent(const size_t rows, const size_t cols) :
       config(rows, cols), amplitude(0) {}
   WaveFunctionComponent(const Configuration &config) : config(config), amplitude(0) {}
 
+  static const BMPSTruncatePara &SweepTruncPara(void) {
+    return sweep_trun_para.has_value() ? sweep_trun_para.value() : trun_para.value();
+  }
+
+  static bool ReuseSweepBMPS(void) {
+    return reuse_sweep_bmps && !sweep_trun_para.has_value();
+  }
+
+  /**
+   * Replace the tensors by the ones of the updated sitps, keeping the configuration, and return true.
+   * The default does nothing and returns false, upon which the caller rebuilds the whole component
+   * from sitps and config, by its constructor; override it to refresh the tensors in place instead.
+   */
+  virtual bool RefreshTensors(const SplitIndexTPS<TenElemT, QNT> &sitps) { return false; }
+
   virtual void MonteCarloSweepUpdate(const SplitIndexTPS<TenElemT, QNT> &sitps,
                                      std::uniform_real_distribution<double> &u_double,
                                      std::vector<double> &accept_rates) = 0;
@@ -41,6 +72,12 @@ bool IsAmplitudeSquareLegal(const ElemT &amplitude) {
 
 template<typename TenElemT, typename QNT>
 std::optional<BMPSTruncatePara> WaveFunctionComponent<TenElemT, QNT>::trun_para;
+template<typename TenElemT, typename QNT>
+std::optional<BMPSTruncatePara> WaveFunctionComponent<TenElemT, QNT>::sweep_trun_para;
+template<typename TenElemT, typename QNT>
+bool WaveFunctionComponent<TenElemT, QNT>::reuse_sweep_bmps = false;
+template<typename TenElemT, typename QNT>
+size_t WaveFunctionComponent<TenElemT, QNT>::bond_trace_threads = 1;
 }//qlpeps
 
 
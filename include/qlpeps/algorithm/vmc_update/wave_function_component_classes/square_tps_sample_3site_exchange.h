@@ -57,11 +57,21 @@ class SquareTPSSample3SiteExchange : public WaveFunctionComponent<TenElemT, QNT>
     }
   }
 
+  /**
+   * Replace the tensors by the ones of the updated sitps, keeping the configuration.
+   * The environments are regrown in the next Monte-Carlo sweep, which also recomputes the amplitude.
+   */
+  bool RefreshTensors(const SplitIndexTPS<TenElemT, QNT> &sitps) {
+    tn.RefreshTensors(sitps, this->config);
+    return true;
+  }
+
   void MonteCarloSweepUpdate(const SplitIndexTPS<TenElemT, QNT> &sitps,
                              std::uniform_real_distribution<double> &u_double,
                              std::vector<double> &accept_rates) {
     size_t flip_accept_num = 0;
-    tn.GenerateBMPSApproach(UP, this->trun_para.value());
+    const BMPSTruncatePara &trunc_para = this->SweepTruncPara();
+    tn.GenerateBMPSApproach(UP, trunc_para);
     for (size_t row = 0; row < tn.rows(); row++) {
       tn.InitBTen(LEFT, row);
       tn.GrowFullBTen(RIGHT, row, 3, true);
@@ -77,14 +87,14 @@ class SquareTPSSample3SiteExchange : public WaveFunctionComponent<TenElemT, QNT>
         }
       }
       if (row < tn.rows() - 1) {
-        tn.BMPSMoveStep(DOWN, this->trun_para.value());
+        tn.BMPSMoveStep(DOWN, trunc_para);
       }
     }
 
     tn.DeleteInnerBMPS(LEFT);
     tn.DeleteInnerBMPS(RIGHT);
 
-    tn.GenerateBMPSApproach(LEFT, this->trun_para.value());
+    tn.GenerateBMPSApproach(LEFT, trunc_para);
     for (size_t col = 0; col < tn.cols(); col++) {
       tn.InitBTen(UP, col);
       tn.GrowFullBTen(DOWN, col, 3, true);
@@ -99,7 +109,7 @@ class SquareTPSSample3SiteExchange : public WaveFunctionComponent<TenElemT, QNT>
         }
       }
       if (col < tn.cols() - 1) {
-        tn.BMPSMoveStep(RIGHT, this->trun_para.value());
+        tn.BMPSMoveStep(RIGHT, trunc_para);
       }
     }
 
@@ -0,0 +1,258 @@
+// SPDX-License-Identifier: LGPL-3.0-only
+
+/*
+* Author: Hao-Xin Wang<wanghaoxin1996@gmail.com>
+* Creation Date: 2024-10-16
+*
+* Description: QuantumLiquids/PEPS project. Explicit class of wave function component in square lattice.
+*              Monte Carlo sweep realized by NN, NNN (diagonal) and long-range row/column exchanges,
+*              with the constraint of U1 quantum number conservation. Suitable for, e.g. Heisenberg model.
+*/
+
+#ifndef QLPEPS_ALGORITHM_VMC_UPDATE_WAVE_FUNCTION_COMPONENT_CLASSES_SQUARE_TPS_SAMPLE_LONG_RANGE_EXCHANGE_H
+#define QLPEPS_ALGORITHM_VMC_UPDATE_WAVE_FUNCTION_COMPONENT_CLASSES_SQUARE_TPS_SAMPLE_LONG_RANGE_EXCHANGE_H
+
+#include <random>                                                   // uniform_int_distribution
+#include "qlpeps/algorithm/vmc_update/wave_function_component.h"    // WaveFunctionComponent
+#include "qlpeps/two_dim_tn/tensor_network_2d/tensor_network_2d.h"
+
+namespace qlpeps {
+
+/**
+ * On top of the NN exchanges of SquareTPSSampleNNExchange, a sweep proposes
+ *  - the two diagonal exchanges of each plaquette, evaluated by ReplaceNNNSiteTrace in the two-row environment;
+ *  - one exchange of two sites at a distance >= 2 in each row and in each column, chosen uniformly
+ *    (independently of the configuration), evaluated by ReplaceOneSiteTrace after growing the boundary
+ *    tensors over the first replaced site.
+ * All the proposals are symmetric and accepted by Metropolis, so that the detailed balance holds.
+ * The acceptance rates are returned per move type: {NN, NNN, long-range}.
+ */
+template<typename TenElemT, typename QNT>
+class SquareTPSSampleLongRangeExchange : public WaveFunctionComponent<TenElemT, QNT> {
+  using WaveFunctionComponentT = WaveFunctionComponent<TenElemT, QNT>;
+ public:
+  TensorNetwork2D<TenElemT, QNT> tn;
+
+  SquareTPSSampleLongRangeExchange(const size_t rows, const size_t cols) : WaveFunctionComponentT(rows, cols),
+                                                                           tn(rows, cols) {}
+
+  SquareTPSSampleLongRangeExchange(const SplitIndexTPS<TenElemT, QNT> &sitps, const Configuration &config)
+      : WaveFunctionComponentT(config), tn(config.rows(), config.cols()) {
+    tn = TensorNetwork2D<TenElemT, QNT>(sitps, config);
+    tn.GrowBMPSForRow(0, this->trun_para.value());
+    tn.GrowFullBTen(RIGHT, 0, 2, true);
+    tn.InitBTen(LEFT, 0);
+    this->amplitude = tn.Trace({0, 0}, HORIZONTAL);
+  }
+
+  void RandomInit(const SplitIndexTPS<TenElemT, QNT> &sitps,
+                  const std::vector<size_t> &occupancy_num) {
+    this->config.Random(occupancy_num);
+    tn = TensorNetwork2D<TenElemT, QNT>(sitps, this->config);
+    tn.GrowBMPSForRow(0, this->trun_para.value());
+    tn.GrowFullBTen(RIGHT, 0, 2, true);
+    tn.InitBTen(LEFT, 0);
+    this->amplitude = tn.Trace({0, 0}, HORIZONTAL);
+    amplitude_stale_ = false;
+  }
+
+  /**
+   * Replace the tensors by the ones of the updated sitps, keeping the configuration.
+   * The environments and the amplitude are recomputed lazily in the next Monte-Carlo sweep.
+   */
+  bool RefreshTensors(const SplitIndexTPS<TenElemT, QNT> &sitps) {
+    tn.RefreshTensors(sitps, this->config);
+    amplitude_stale_ = true;
+    return true;
+  }
+
+  void MonteCarloSweepUpdate(const SplitIndexTPS<TenElemT, QNT> &sitps,
+                             std::uniform_real_distribution<double> &u_double,
+                             std::vector<double> &accept_rates) {
+    size_t nn_accept_num = 0, nnn_accept_num = 0, long_range_accept_num = 0;
+    size_t long_range_move_num = 0;
+    const BMPSTruncatePara &trunc_para = this->SweepTruncPara();
+    tn.SetBondTraceThreads(this->bond_trace_threads);
+    if (this->sweep_trun_para.has_value()) {
+      amplitude_stale_ = true; // the amplitude from the energy solver is of another truncation
+    }
+    tn.GenerateBMPSApproach(UP, trunc_para);
+    for (size_t row = 0; row < tn.rows(); row++) {
+      tn.InitBTen(LEFT, row);
+      tn.GrowFullBTen(RIGHT, row, 2, true);
+      if (amplitude_stale_) {
+        this->amplitude = tn.Trace({row, 0}, HORIZONTAL);
+        amplitude_stale_ = false;
+      }
+      if (tn.cols() > 2) {
+        long_range_accept_num += LongRangeExchangeUpdate_(row, HORIZONTAL, sitps, u_double);
+        long_range_move_num++;
+      }
+      for (size_t col = 0; col < tn.cols() - 1; col++) {
+        nn_accept_num += ExchangeUpdate_({row, col}, {row, col + 1}, HORIZONTAL, sitps, u_double);
+        if (col < tn.cols() - 2) {
+          tn.BTenMoveStep(RIGHT);
+        }
+      }
+      if (row < tn.rows() - 1) {
+        tn.InitBTen2(LEFT, row);
+        tn.GrowFullBTen2(RIGHT, row, 2, true);
+        for (size_t col = 0; col < tn.cols() - 1; col++) {
+          nnn_accept_num += DiagonalExchangeUpdate_({row, col}, LEFTUP_TO_RIGHTDOWN, sitps, u_double);
+          nnn_accept_num += DiagonalExchangeUpdate_({row, col}, LEFTDOWN_TO_RIGHTUP, sitps, u_double);
+          if (col < tn.cols() - 2) {
+            tn.BTen2MoveStep(RIGHT, row);
+          }
+        }
+        // the accepted diagonal exchanges have erased the down boundary MPS containing the row + 1
+        if (tn.GetBMPS(DOWN).size() == tn.rows() - row) {
+          tn.BMPSMoveStep(DOWN, trunc_para);
+        } else {
+          tn.GrowBMPSForRow(row + 1, trunc_para);
+        }
+      }
+    }
+
+    tn.DeleteInnerBMPS(LEFT);
+    tn.DeleteInnerBMPS(RIGHT);
+
+    tn.GenerateBMPSApproach(LEFT, trunc_para);
+    for (size_t col = 0; col < tn.cols(); col++) {
+      tn.InitBTen(UP, col);
+      tn.GrowFullBTen(DOWN, col, 2, true);
+      if (tn.rows() > 2) {
+        long_range_accept_num += LongRangeExchangeUpdate_(col, VERTICAL, sitps, u_double);
+        long_range_move_num++;
+      }
+      for (size_t row = 0; row < tn.rows() - 1; row++) {
+        nn_accept_num += ExchangeUpdate_({row, col}, {row + 1, col}, VERTICAL, sitps, u_double);
+        if (row < tn.rows() - 2) {
+          tn.BTenMoveStep(DOWN);
+        }
+      }
+      if (col < tn.cols() - 1) {
+        tn.BMPSMoveStep(RIGHT, trunc_para);
+      }
+    }
+
+    tn.DeleteInnerBMPS(UP);
+    const double bond_num = tn.cols() * (tn.rows() - 1) + tn.rows() * (tn.cols() - 1);
+    const double nnn_bond_num = 2 * (tn.rows() - 1) * (tn.cols() - 1);
+    accept_rates = {double(nn_accept_num) / bond_num,
+                    nnn_bond_num > 0 ? double(nnn_accept_num) / nnn_bond_num : 0.0,
+                    long_range_move_num > 0 ? double(long_range_accept_num) / double(long_range_move_num) : 0.0};
+  }
+
+ private:
+  bool amplitude_stale_ = false;
+
+  bool MetropolisAccept_(const TenElemT psi_b, std::uniform_real_distribution<double> &u_double) const {
+    const TenElemT &psi_a = this->amplitude;
+    if (std::abs(psi_b) >= std::abs(psi_a)) {
+      return true;
+    }
+    double div = std::abs(psi_b) / std::abs(psi_a);
+    return u_double(random_engine) < div * div;
+  }
+
+  void Exchange_(const SiteIdx &site1, const SiteIdx &site2, const TenElemT psi_b,
+                 const SplitIndexTPS<TenElemT, QNT> &sitps) {
+    std::swap(this->config(site1), this->config(site2));
+    tn.UpdateSiteConfig(site1, this->config(site1), sitps);
+    tn.UpdateSiteConfig(site2, this->config(site2), sitps);
+    this->amplitude = psi_b;
+  }
+
+  bool ExchangeUpdate_(const SiteIdx &site1, const SiteIdx &site2, BondOrientation bond_dir,
+                       const SplitIndexTPS<TenElemT, QNT> &sitps,
+                       std::uniform_real_distribution<double> &u_double) {
+    if (this->config(site1) == this->config(site2)) {
+      return false;
+    }
+    TenElemT psi_b = tn.ReplaceNNSiteTrace(site1, site2, bond_dir, sitps(site1), this->config(site2),
+                                           sitps(site2), this->config(site1));
+    if (!MetropolisAccept_(psi_b, u_double)) {
+      return false;
+    }
+    Exchange_(site1, site2, psi_b, sitps);
+    return true;
+  }
+
+  /**
+   * Exchange on a diagonal of the plaquette with the left-up site left_up_site,
+   * with the two-row boundary tensors of the plaquette's rows grown to its columns.
+   */
+  bool DiagonalExchangeUpdate_(const SiteIdx &left_up_site, const DIAGONAL_DIR diagonal_dir,
+                               const SplitIndexTPS<TenElemT, QNT> &sitps,
+                               std::uniform_real_distribution<double> &u_double) {
+    const size_t row = left_up_site.row(), col = left_up_site.col();
+    SiteIdx site_left, site_right;
+    if (diagonal_dir == LEFTUP_TO_RIGHTDOWN) {
+      site_left = {row, col};
+      site_right = {row + 1, col + 1};
+    } else {
+      site_left = {row + 1, col};
+      site_right = {row, col + 1};
+    }
+    const size_t config_left = this->config(site_left), config_right = this->config(site_right);
+    if (config_left == config_right) {
+      return false;
+    }
+    TenElemT psi_b = tn.ReplaceNNNSiteTrace(left_up_site, diagonal_dir, HORIZONTAL,
+                                            sitps(site_left)[config_right], sitps(site_right)[config_left]);
+    if (!MetropolisAccept_(psi_b, u_double)) {
+      return false;
+    }
+    Exchange_(site_left, site_right, psi_b, sitps);
+    return true;
+  }
+
+  /**
+   * Exchange of two sites at a distance >= 2 on the row (HORIZONTAL) or column (VERTICAL) line,
+   * with the boundary tensors initialized on the line: the left/up ones of size 1, the right/down ones
+   * grown to all but 2 sites. The same state of the boundary tensors is restored on return.
+   */
+  bool LongRangeExchangeUpdate_(const size_t line, const BondOrientation orient,
+                                const SplitIndexTPS<TenElemT, QNT> &sitps,
+                                std::uniform_real_distribution<double> &u_double) {
+    const size_t length = orient == HORIZONTAL ? tn.cols() : tn.rows();
+    const BTenPOSITION grow_post = orient == HORIZONTAL ? LEFT : UP;
+    const BTenPOSITION oppo_post = Opposite(grow_post);
+    auto line_site = [line, orient](const size_t pos) {
+      return orient == HORIZONTAL ? SiteIdx({line, pos}) : SiteIdx({pos, line});
+    };
+    // the pair is uniform over all the pairs at a distance >= 2
+    std::uniform_int_distribution<size_t> u_pos(0, length - 1);
+    size_t pos1, pos2;
+    do {
+      pos1 = u_pos(random_engine);
+      pos2 = u_pos(random_engine);
+    } while (pos1 + 2 > pos2);
+    const SiteIdx site1 = line_site(pos1), site2 = line_site(pos2);
+    const size_t config1 = this->config(site1), config2 = this->config(site2);
+    if (config1 == config2) {
+      return false;
+    }
+    for (size_t pos = 0; pos < pos1; pos++) {
+      tn.GrowBTenStep(grow_post);
+    }
+    tn.UpdateSiteConfig(site1, config2, sitps, false); // the boundary MPS of the pass do not contain the line
+    for (size_t pos = pos1; pos < pos2; pos++) {
+      tn.GrowBTenStep(grow_post);
+    }
+    TenElemT psi_b = tn.ReplaceOneSiteTrace(site2, sitps(site2)[config1], orient);
+    const bool exchange = MetropolisAccept_(psi_b, u_double);
+    tn.UpdateSiteConfig(site1, config1, sitps, false);
+    tn.TruncateBTen(grow_post, 1);
+    if (exchange) {
+      Exchange_(site1, site2, psi_b, sitps);
+      tn.TruncateBTen(oppo_post, length - pos2);
+      tn.GrowFullBTen(oppo_post, line, 2, false);
+    }
+    return exchange;
+  }
+}; //SquareTPSSampleLongRangeExchange
+
+}//qlpeps
+
+#endif //QLPEPS_ALGORITHM_VMC_UPDATE_WAVE_FUNCTION_COMPONENT_CLASSES_SQUARE_TPS_SAMPLE_LONG_RANGE_EXCHANGE_H
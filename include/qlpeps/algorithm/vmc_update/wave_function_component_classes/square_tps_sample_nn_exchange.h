@@ -44,16 +44,36 @@ class SquareTPSSampleNNExchange : public WaveFunctionComponent<TenElemT, QNT> {
     tn.GrowFullBTen(RIGHT, 0, 2, true);
     tn.InitBTen(LEFT, 0);
     this->amplitude = tn.Trace({0, 0}, HORIZONTAL);
+    amplitude_stale_ = false;
+  }
+
+  /**
+   * Replace the tensors by the ones of the updated sitps, keeping the configuration.
+   * The environments and the amplitude are recomputed lazily in the next Monte-Carlo sweep.
+   */
+  bool RefreshTensors(const SplitIndexTPS<TenElemT, QNT> &sitps) {
+    tn.RefreshTensors(sitps, this->config);
+    amplitude_stale_ = true;
+    return true;
   }
 
   void MonteCarloSweepUpdate(const SplitIndexTPS<TenElemT, QNT> &sitps,
                              std::uniform_real_distribution<double> &u_double,
                              std::vector<double> &accept_rates) {
     size_t flip_accept_num = 0;
-    tn.GenerateBMPSApproach(UP, this->trun_para.value());
+    const BMPSTruncatePara &trunc_para = this->SweepTruncPara();
+    tn.SetBondTraceThreads(this->bond_trace_threads);
+    if (this->sweep_trun_para.has_value()) {
+      amplitude_stale_ = true; // the amplitude from the energy solver is of another truncation
+    }
+    tn.GenerateBMPSApproach(UP, trunc_para);
     for (size_t row = 0; row < tn.rows(); row++) {
       tn.InitBTen(LEFT, row);
       tn.GrowFullBTen(RIGHT, row, 2, true);
+      if (amplitude_stale_) {
+        this->amplitude = tn.Trace({row, 0}, HORIZONTAL);
+        amplitude_stale_ = false;
+      }
       for (size_t col = 0; col < tn.cols() - 1; col++) {
         flip_accept_num += ExchangeUpdate_({row, col}, {row, col + 1}, HORIZONTAL, sitps, u_double);
         if (col < tn.cols() - 2) {
@@ -61,14 +81,14 @@ class SquareTPSSampleNNExchange : public WaveFunctionComponent<TenElemT, QNT> {
         }
       }
       if (row < tn.rows() - 1) {
-        tn.BMPSMoveStep(DOWN, this->trun_para.value());
+        tn.BMPSMoveStep(DOWN, trunc_para);
       }
     }
 
     tn.DeleteInnerBMPS(LEFT);
     tn.DeleteInnerBMPS(RIGHT);
 
-    tn.GenerateBMPSApproach(LEFT, this->trun_para.value());
+    tn.GenerateBMPSApproach(LEFT, trunc_para);
     for (size_t col = 0; col < tn.cols(); col++) {
       tn.InitBTen(UP, col);
       tn.GrowFullBTen(DOWN, col, 2, true);
@@ -79,7 +99,7 @@ class SquareTPSSampleNNExchange : public WaveFunctionComponent<TenElemT, QNT> {
         }
       }
       if (col < tn.cols() - 1) {
-        tn.BMPSMoveStep(RIGHT, this->trun_para.value());
+        tn.BMPSMoveStep(RIGHT, trunc_para);
       }
     }
 
@@ -89,6 +109,8 @@ class SquareTPSSampleNNExchange : public WaveFunctionComponent<TenElemT, QNT> {
   }
 
  private:
+  bool amplitude_stale_ = false;
+
   // the code is exactly same for fermion and boson since only the square of norms are used.
   bool ExchangeUpdate_(const SiteIdx &site1, const SiteIdx &site2, BondOrientation bond_dir,
                        const SplitIndexTPS<TenElemT, QNT> &sitps,
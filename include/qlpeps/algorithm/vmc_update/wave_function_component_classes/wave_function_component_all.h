@@ -10,5 +10,6 @@
 #include "square_tps_sample_nn_exchange.h"
 #include "square_tps_sample_full_space_nn_flip.h"
 #include "square_tps_sample_3site_exchange.h"
+#include "square_tps_sample_long_range_exchange.h"
 
 #endif //QLPEPS_ALGORITHM_VMC_UPDATE_WAVE_FUNCTION_COMPONENT_CLASSES_WAVE_FUNCTION_COMPONENT_ALL_H
@@ -13,11 +13,14 @@
 #include <string>     // string
 #include <vector>     // vector
 #include <random>     // default_random_engine
+#include "qlpeps/monte_carlo_tools/philox_random.h"
 
 namespace qlpeps {
 
 //std::default_random_engine random_engine;
-std::mt19937 random_engine;
+// thread local so that Markov chains in different threads have independent random streams.
+// The counter-based engine is keyed by (seed, rank, chain, sweep) by the executors, so runs are reproducible.
+thread_local PhiloxEngine random_engine;
 
 enum BondOrientation {
   HORIZONTAL = 0,
@@ -0,0 +1,166 @@
+// SPDX-License-Identifier: LGPL-3.0-only
+
+/*
+* Author: Hao-Xin Wang<wanghaoxin1996@gmail.com>
+* Creation Date: 2024-10-16
+*
+* Description: QuantumLiquids/PEPS project. Counter-based Philox4x32-10 random number generator.
+*/
+
+#ifndef QLPEPS_MONTE_CARLO_TOOLS_PHILOX_RANDOM_H
+#define QLPEPS_MONTE_CARLO_TOOLS_PHILOX_RANDOM_H
+
+#include <array>      //array
+#include <cstddef>    //size_t
+#include <cstdint>    //uint32_t, uint64_t
+#include <istream>
+#include <ostream>
+
+namespace qlpeps {
+
+using PhiloxCounter = std::array<uint32_t, 4>;
+using PhiloxKey = std::array<uint32_t, 2>;
+
+/**
+ * The Philox4x32 bijection with 10 rounds (Salmon et al., SC'11), i.e. the random block of a counter under a key.
+ */
+inline PhiloxCounter Philox4x32(PhiloxCounter ctr, PhiloxKey key) {
+  const uint64_t kM0 = 0xD2511F53u, kM1 = 0xCD9E8D57u;
+  const uint32_t kW0 = 0x9E3779B9u, kW1 = 0xBB67AE85u;
+  for (size_t round = 0; round < 10; round++) {
+    if (round > 0) {
+      key[0] += kW0;
+      key[1] += kW1;
+    }
+    const uint64_t p0 = kM0 * ctr[0];
+    const uint64_t p1 = kM1 * ctr[2];
+    ctr = {uint32_t(p1 >> 32) ^ ctr[1] ^ key[0], uint32_t(p1),
+           uint32_t(p0 >> 32) ^ ctr[3] ^ key[1], uint32_t(p0)};
+  }
+  return ctr;
+}
+
+/**
+ * Philox4x32-10 as a UniformRandomBitGenerator (usable by std distributions, std::shuffle, etc.).
+ *
+ * The key is the 64-bit seed and the counter is (block, sweep, rank, chain), so that the stream of
+ * a Markov chain is determined by (seed, rank, chain) alone, and with NextSweep() the draws of a sweep
+ * by (seed, rank, chain, sweep), independent of the number of draws in the earlier sweeps.
+ * Different streams need no seeding heuristic and are statistically independent.
+ */
+class PhiloxEngine {
+ public:
+  using result_type = uint32_t;
+
+  static constexpr result_type min() { return 0; }
+  static constexpr result_type max() { return 0xffffffffu; }
+
+  PhiloxEngine(void) : PhiloxEngine(0) {}
+
+  explicit PhiloxEngine(const uint64_t seed, const uint32_t rank = 0, const uint32_t chain = 0) {
+    Seed(seed, rank, chain);
+  }
+
+  ///< Restart the stream (seed, rank, chain) from sweep 0
+  void Seed(const uint64_t seed, const uint32_t rank, const uint32_t chain) {
+    key_ = {uint32_t(seed), uint32_t(seed >> 32)};
+    ctr_ = {0, 0, rank, chain};
+    idx_ = 4;
+  }
+
+  ///< The interface of std engines, keeping the rank and chain of the stream
+  void seed(const uint64_t seed) { Seed(seed, ctr_[2], ctr_[3]); }
+
+  ///< Jump to the beginning of the sub-stream of the given sweep
+  void SetSweep(const uint32_t sweep) {
+    ctr_[0] = 0;
+    ctr_[1] = sweep;
+    idx_ = 4;
+  }
+
+  void NextSweep(void) { SetSweep(ctr_[1] + 1); }
+
+  uint32_t Sweep(void) const { return ctr_[1]; }
+
+  result_type operator()(void) {
+    if (idx_ == 4) {
+      Refill_();
+    }
+    return buffer_[idx_++];
+  }
+
+  void discard(unsigned long long n) {
+    for (; n > 0 && idx_ < 4; n--) { idx_++; }
+    ctr_[0] += uint32_t(n / 4);
+    if (n % 4 != 0) {
+      Refill_();
+      idx_ = n % 4;
+    }
+  }
+
+  ///< A uniform double in [0, 1) with 53 random bits
+  double Uniform(void) {
+    const uint32_t a = (*this)();
+    const uint32_t b = (*this)();
+    return ToDouble_(a, b);
+  }
+
+  /**
+   * Fill out[0, n) with uniform doubles in [0, 1), the same numbers as n calls of Uniform(),
+   * but generated block by block without the per-draw buffer check.
+   */
+  void FillUniform(double *out, const size_t n) {
+    size_t i = 0;
+    while (i < n && idx_ != 4) { out[i++] = Uniform(); }
+    for (; i + 2 <= n; i += 2) {
+      Refill_(4);
+      out[i] = ToDouble_(buffer_[0], buffer_[1]);
+      out[i + 1] = ToDouble_(buffer_[2], buffer_[3]);
+    }
+    if (i < n) { out[i] = Uniform(); }
+  }
+
+  bool operator==(const PhiloxEngine &rhs) const {
+    return key_ == rhs.key_ && ctr_ == rhs.ctr_ && idx_ == rhs.idx_ && (idx_ == 4 || buffer_ == rhs.buffer_);
+  }
+  bool operator!=(const PhiloxEngine &rhs) const { return !(*this == rhs); }
+
+  friend std::ostream &operator<<(std::ostream &os, const PhiloxEngine &engine) {
+    os << engine.key_[0] << " " << engine.key_[1];
+    for (uint32_t c : engine.ctr_) { os << " " << c; }
+    return os << " " << engine.idx_;
+  }
+
+  ///< The buffered block is regenerated from the counter
+  friend std::istream &operator>>(std::istream &is, PhiloxEngine &engine) {
+    is >> engine.key_[0] >> engine.key_[1];
+    for (uint32_t &c : engine.ctr_) { is >> c; }
+    is >> engine.idx_;
+    if (engine.idx_ < 4) {
+      engine.ctr_[0]--;
+      engine.Refill_(engine.idx_);
+    }
+    return is;
+  }
+
+ private:
+  ///< Generate the block of the current counter and increase the block index
+  void Refill_(const size_t idx = 0) {
+    buffer_ = Philox4x32(ctr_, key_);
+    ctr_[0]++;
+    idx_ = idx;
+  }
+
+  static double ToDouble_(const uint32_t a, const uint32_t b) {
+    return double((uint64_t(a >> 5) << 26) | (b >> 6)) * 0x1.0p-53;
+  }
+
+  PhiloxKey key_;
+  PhiloxCounter ctr_;     // ctr_[0] is the index of the next block
+  PhiloxCounter buffer_;
+  size_t idx_;            // the next output in buffer_, 4 if buffer_ is used up
+};
+
+}//qlpeps
+
+#endif //QLPEPS_MONTE_CARLO_TOOLS_PHILOX_RANDOM_H
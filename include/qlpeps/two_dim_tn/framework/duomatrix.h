@@ -60,10 +60,28 @@ class DuoMatrix {
   }
 
   /**
-   * Copy a DuoMatrix.
+   * Copy a DuoMatrix. If the two matrices have the same size, the allocated elements are
+   * reused by copy assignment instead of being reallocated.
    * @param rhs A DuoMatrix instance.
    */
   DuoMatrix<ElemT> &operator=(const DuoMatrix<ElemT> &rhs) {
+    if (this == &rhs) {
+      return *this;
+    }
+    if (rows() == rhs.rows() && cols() == rhs.cols()) {
+      for (size_t i = 0; i < rows(); ++i) {
+        for (size_t j = 0; j < cols(); ++j) {
+          if (rhs(i, j) == nullptr) {
+            dealloc(i, j);
+          } else if (raw_data_[i][j] != nullptr) {
+            *raw_data_[i][j] = *rhs(i, j);
+          } else {
+            raw_data_[i][j] = new ElemT(*rhs(i, j));
+          }
+        }
+      }
+      return *this;
+    }
     for (auto &row : raw_data_) {
       for (auto &elem : row) {
         if (elem != nullptr) {
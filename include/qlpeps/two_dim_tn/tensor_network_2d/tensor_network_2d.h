@@ -10,12 +10,16 @@
 #ifndef QLPEPS_TWO_DIM_TN_TPS_TENSOR_NETWORK_2D_H
 #define QLPEPS_TWO_DIM_TN_TPS_TENSOR_NETWORK_2D_H
 
+#include <tuple>                                    // tuple
+#include <limits>                                   // numeric_limits
+#include <algorithm>                                // min, max
 #include "qlten/qlten.h"
 #include "qlpeps/two_dim_tn/framework/ten_matrix.h"
 #include "qlpeps/two_dim_tn/framework/site_idx.h"
 #include "qlpeps/ond_dim_tn/boundary_mps/bmps.h"
 #include "qlpeps/basic.h"                           //BMPSTruncatePara
 #include "qlpeps/two_dim_tn/tps/configuration.h"    //Configure
+#include "qlpeps/utility/worker_pool.h"              //WorkerPool
 
 namespace qlpeps {
 using namespace qlten;
@@ -64,7 +68,7 @@ class TensorNetwork2D : public TenMatrix<QLTensor<TenElemT, QNT>> {
   TensorNetwork2D<TenElemT, QNT> &operator=(const TensorNetwork2D<TenElemT, QNT> &tn);
 
   const std::vector<BMPS<TenElemT, QNT>> &GetBMPS(const BMPSPOSITION position) const {
-    return bmps_set_[position];
+    return bmps_set_.at(position);
   }
 
   void InitBMPS();
@@ -97,9 +101,23 @@ class TensorNetwork2D : public TenMatrix<QLTensor<TenElemT, QNT>> {
 
   void BMPSMoveStep(const BMPSPOSITION position, const BMPSTruncatePara &trunc_para);
 
+  /**
+   * Prepare the boundary MPS for a pass over the columns. If reuse_left_bmps and the left boundary MPS of
+   * all the columns are present, they are kept and the pass runs from right to left; otherwise the right
+   * boundary MPS are regrown as by GenerateBMPSApproach(LEFT) and the pass runs from left to right.
+   * @return the position to be passed to BMPSMoveStep after each column
+   */
+  BMPSPOSITION GenerateBMPSForColPass(const BMPSTruncatePara &trunc_para, const bool reuse_left_bmps);
+
+  ///< The column visited at the step-th step of the pass prepared by GenerateBMPSForColPass
+  size_t ColPassCol(const BMPSPOSITION move_post, const size_t step) const {
+    return move_post == RIGHT ? step : this->cols() - 1 - step;
+  }
+
   void GrowFullBMPS(const BMPSPOSITION position, const BMPSTruncatePara &trunc_para);
 
   void DeleteInnerBMPS(const BMPSPOSITION position) {
+    ClearOpenSiteCache();
     if (!bmps_set_[position].empty()) {
       bmps_set_[position].erase(bmps_set_[position].begin() + 1, bmps_set_[position].end());
     }
@@ -142,6 +160,13 @@ class TensorNetwork2D : public TenMatrix<QLTensor<TenElemT, QNT>> {
   void UpdateSiteConfig(const SiteIdx &site, const size_t update_config, const SITPS &tps,
                         bool check_envs = true);
 
+  /**
+   * Replace all the site tensors by the projections of a new TPS with the same bond indices,
+   * and invalidate all the environments except the (configuration-independent) vacuum boundary MPS.
+   * Cheaper than constructing a new TensorNetwork2D; the environments are regrown lazily.
+   */
+  void RefreshTensors(const SITPS &tps, const Configuration &config);
+
   /**
    * Calculate the trace by contracting the environment tensors around a NN bond
    * We assume we have gotten all of the environment tensors
@@ -160,6 +185,72 @@ class TensorNetwork2D : public TenMatrix<QLTensor<TenElemT, QNT>> {
                               const BondOrientation bond_dir,
                               const Tensor &ten_a, const Tensor &ten_b) const;
 
+  /**
+   * ReplaceNNSiteTrace for all the pairs (tens_a[i], tens_b[j]), returned at i * tens_b.size() + j.
+   * The environment around the bond is contracted once, each candidate tensor once into its half,
+   * so that only the contractions of the two halves scale with the number of pairs.
+   */
+  std::vector<TenElemT> ReplaceNNSiteTraceBatch(const SiteIdx &site_a, const SiteIdx &site_b,
+                                                const BondOrientation bond_dir,
+                                                const std::vector<const Tensor *> &tens_a,
+                                                const std::vector<const Tensor *> &tens_b) const;
+
+  /**
+   * ReplaceNNSiteTrace with the candidate tensors site_a_tens[config_a] and site_b_tens[config_b], which are
+   * the projections of the TPS on the two sites. With the open-site cache enabled, the half of each site
+   * (environment plus site tensor) is kept keyed by (site, bond, config) until the environments or the
+   * site tensors change, and shared with Trace and the later calls on the same bond.
+   */
+  TenElemT ReplaceNNSiteTrace(const SiteIdx &site_a, const SiteIdx &site_b,
+                              const BondOrientation bond_dir,
+                              const std::vector<Tensor> &site_a_tens, const size_t config_a,
+                              const std::vector<Tensor> &site_b_tens, const size_t config_b) const;
+
+  /**
+   * Opt-in cache of the open-site tensors of the NN bond traces, keyed by (site, bond, side of the bond, config)
+   * in both Trace and the configuration overload of ReplaceNNSiteTrace. Trace knows the configurations of
+   * the site tensors set by the constructor from a configuration, UpdateSiteConfig and RefreshTensors,
+   * and bypasses the cache on the other sites. The cache is cleared by every change of the boundary MPS,
+   * the boundary tensors or the site tensors through the member functions, so that the keys need no version
+   * of the environments; site tensors written directly by operator() must be restored before the next trace.
+   * Since the environments move after every bond of the sweeps and the energy solvers, the built-in samplers
+   * and solvers do not use it; it only pays off for repeated traces in one fixed environment.
+   */
+  void EnableOpenSiteCache(const bool enable = true) {
+    open_site_cache_enabled_ = enable;
+    ClearOpenSiteCache();
+  }
+
+  bool OpenSiteCacheEnabled(void) const { return open_site_cache_enabled_; }
+
+  void ClearOpenSiteCache(void) const { open_site_cache_.clear(); }
+
+  size_t OpenSiteCacheHits(void) const { return open_site_cache_hits_; }
+  size_t OpenSiteCacheMisses(void) const { return open_site_cache_misses_; }
+  double OpenSiteCacheHitRate(void) const {
+    const size_t lookups = open_site_cache_hits_ + open_site_cache_misses_;
+    return lookups == 0 ? 0.0 : double(open_site_cache_hits_) / double(lookups);
+  }
+  void ResetOpenSiteCacheCounters(void) {
+    open_site_cache_hits_ = 0;
+    open_site_cache_misses_ = 0;
+  }
+
+  /**
+   * Number of threads over which the NN bond traces (Trace, ReplaceNNSiteTrace and ReplaceNNSiteTraceBatch)
+   * distribute the two halves of the bond and the candidate pairs; 1 (default) runs them in the calling thread.
+   * The results are the same as the sequential ones, and the path through the open-site cache stays sequential.
+   * The worker threads are owned by the network and reused by all the traces; a copy of the network starts its own.
+   *
+   * The speedup has not been measured. Trace and ReplaceNNSiteTrace have only the two halves to split,
+   * so every call costs a wake-up of the workers for at most a 2-way parallelism, which the small contractions
+   * of a single bond may not amortize. ReplaceNNSiteTraceBatch has one task per candidate pair and is the more
+   * promising case.
+   */
+  void SetBondTraceThreads(const size_t thread_num) { bond_trace_threads_ = std::max<size_t>(thread_num, 1); }
+
+  size_t BondTraceThreads(void) const { return bond_trace_threads_; }
+
   TenElemT ReplaceNNNSiteTrace(const SiteIdx &left_up_site,
                                const DIAGONAL_DIR nnn_dir,
                                const BondOrientation mps_orient,
@@ -200,6 +291,19 @@ class TensorNetwork2D : public TenMatrix<QLTensor<TenElemT, QNT>> {
    */
   void GrowBTen2Step_(const BTenPOSITION post, const size_t slice_num1);
 
+  Tensor NNBondSiteEnv_(const SiteIdx &site, const BondOrientation bond_dir, const bool first_site) const;
+
+  Tensor NNBondSiteHalf_(const Tensor &env, const SiteIdx &site, const BondOrientation bond_dir,
+                         const bool first_site, const Tensor &ten) const;
+
+  TenElemT ContractNNBondHalves_(const Tensor &half_a, const Tensor &half_b) const;
+
+  const Tensor &OpenSiteHalf_(const SiteIdx &site, const BondOrientation bond_dir, const bool first_site,
+                              const Tensor &ten, const size_t config) const;
+
+  template<typename TaskT>
+  void ParallelForBondTrace_(const size_t task_num, const TaskT &task) const;
+
   /** bmps_set_
    * left bmps: mps are numbered from left to right, mps tensors are numbered from top to bottom
    * down bmps: mps are numbered from bottom to top, mps tensors are numbered from left to right
@@ -209,6 +313,18 @@ class TensorNetwork2D : public TenMatrix<QLTensor<TenElemT, QNT>> {
   std::map<BMPSPOSITION, std::vector<BMPS<TenElemT, QNT>>> bmps_set_;
   std::map<BTenPOSITION, std::vector<Tensor>> bten_set_;  // for 1 layer between two bmps
   std::map<BTenPOSITION, std::vector<Tensor>> bten_set2_; // for 2 layers between two bmps
+
+  // (row, col, bond orientation, is site_a of the bond, config)
+  using OpenSiteKey = std::tuple<size_t, size_t, BondOrientation, bool, size_t>;
+  static constexpr size_t kUnknownConfig = std::numeric_limits<size_t>::max();
+  std::vector<size_t> site_configs_; // configurations of the site tensors in the row-major order, for the cache keys
+  bool open_site_cache_enabled_ = false;
+  mutable std::map<OpenSiteKey, Tensor> open_site_cache_;
+  mutable size_t open_site_cache_hits_ = 0;
+  mutable size_t open_site_cache_misses_ = 0;
+
+  size_t bond_trace_threads_ = 1;
+  mutable WorkerPool bond_trace_pool_;
 };
 
 }//qlpeps
@@ -16,7 +16,7 @@ using namespace qlten;
 
 template<typename TenElemT, typename QNT>
 TensorNetwork2D<TenElemT, QNT>::TensorNetwork2D(const size_t rows, const size_t cols)
-    : TenMatrix<QLTensor<TenElemT, QNT>>(rows, cols) {
+    : TenMatrix<QLTensor<TenElemT, QNT>>(rows, cols), site_configs_(rows * cols, kUnknownConfig) {
   for (size_t post_int = 0; post_int < 4; post_int++) {
     const BMPSPOSITION post = static_cast<BMPSPOSITION>(post_int);
     bmps_set_.insert(std::make_pair(post, std::vector<BMPS<TenElemT, QNT>>()));
@@ -33,6 +33,7 @@ TensorNetwork2D<TenElemT, QNT>::TensorNetwork2D(const SplitIndexTPS<TenElemT, QN
   for (size_t row = 0; row < tps.rows(); row++) {
     for (size_t col = 0; col < tps.cols(); col++) {
       (*this)({row, col}) = tps({row, col})[config({row, col})];
+      site_configs_[row * tps.cols() + col] = config({row, col});
     }
   }
 
@@ -43,6 +44,10 @@ TensorNetwork2D<TenElemT, QNT>::TensorNetwork2D(const SplitIndexTPS<TenElemT, QN
 template<typename TenElemT, typename QNT>
 TensorNetwork2D<TenElemT, QNT> &TensorNetwork2D<TenElemT, QNT>::operator=(const TensorNetwork2D<TenElemT, QNT> &tn) {
   TenMatrix<Tensor>::operator=(tn);
+  open_site_cache_enabled_ = tn.open_site_cache_enabled_;
+  bond_trace_threads_ = tn.bond_trace_threads_;
+  site_configs_ = tn.site_configs_;
+  ClearOpenSiteCache();
   //Question : directly set bmps_set_ = tn.bmps_set_ induce bug, the position in map is inconsistent with the position
   // inside the bmps. Why?
   for (BMPSPOSITION post : {LEFT, DOWN, RIGHT, UP}) {
@@ -61,6 +66,7 @@ void TensorNetwork2D<TenElemT, QNT>::InitBMPS(void) {
 
 template<typename TenElemT, typename QNT>
 void TensorNetwork2D<TenElemT, QNT>::InitBMPS(const qlpeps::BMPSPOSITION post) {
+  ClearOpenSiteCache();
   assert(bmps_set_.at(post).empty());
   const size_t mps_size = this->length(Rotate(Orientation(post)));
   std::vector<IndexT> boundary_indices;
@@ -104,10 +110,23 @@ TensorNetwork2D<TenElemT, QNT>::GenerateBMPSApproach(BMPSPOSITION post, const BM
   return bmps_set_;
 }
 
+template<typename TenElemT, typename QNT>
+BMPSPOSITION TensorNetwork2D<TenElemT, QNT>::GenerateBMPSForColPass(const BMPSTruncatePara &trunc_para,
+                                                                    const bool reuse_left_bmps) {
+  // the existed boundary MPS are always consistent with the site tensors, see UpdateSiteConfig
+  if (reuse_left_bmps && bmps_set_.at(LEFT).size() == this->cols()) {
+    DeleteInnerBMPS(RIGHT);
+    return LEFT;
+  }
+  GenerateBMPSApproach(LEFT, trunc_para);
+  return RIGHT;
+}
+
 template<typename TenElemT, typename QNT>
 size_t TensorNetwork2D<TenElemT, QNT>::GrowBMPSStep_(const BMPSPOSITION position,
                                                      TransferMPO mpo,
                                                      const BMPSTruncatePara &trunc_para) {
+  ClearOpenSiteCache();
   std::vector<BMPS<TenElemT, QNT>> &bmps_set = bmps_set_[position];
   bmps_set.push_back(
       bmps_set.back().MultipleMPO(mpo, trunc_para.compress_scheme,
@@ -161,6 +180,7 @@ void TensorNetwork2D<TenElemT, QNT>::GrowFullBMPS(const BMPSPOSITION position, c
         const TransferMPO &mpo = this->get_col(col);
         GrowBMPSStep_(position, mpo, trunc_para);
       }
+      break;
     }
     case RIGHT: {
       for (size_t col = cols - existed_bmps_size; col > 0; col--) {
@@ -231,6 +251,7 @@ TensorNetwork2D<TenElemT, QNT>::GetBMPSForCol(const size_t col, const BMPSTrunca
 
 template<typename TenElemT, typename QNT>
 void TensorNetwork2D<TenElemT, QNT>::BMPSMoveStep(const BMPSPOSITION position, const BMPSTruncatePara &trunc_para) {
+  ClearOpenSiteCache();
   bmps_set_[position].pop_back();
   auto oppo_post = Opposite(position);
   GrowBMPSStep_(oppo_post, trunc_para);
@@ -273,6 +294,8 @@ template<typename TenElemT, typename QNT>
 void TensorNetwork2D<TenElemT, QNT>::UpdateSiteConfig(const qlpeps::SiteIdx &site, const size_t update_config,
                                                       const SplitIndexTPS<TenElemT, QNT> &sitps, bool check_envs) {
   (*this)(site) = sitps(site)[update_config];
+  site_configs_[site[0] * this->cols() + site[1]] = update_config;
+  ClearOpenSiteCache();
   if (check_envs) {
     const size_t row = site[0];
     const size_t col = site[1];
@@ -296,6 +319,27 @@ void TensorNetwork2D<TenElemT, QNT>::UpdateSiteConfig(const qlpeps::SiteIdx &sit
   }
 }
 
+template<typename TenElemT, typename QNT>
+void TensorNetwork2D<TenElemT, QNT>::RefreshTensors(const SplitIndexTPS<TenElemT, QNT> &tps,
+                                                    const Configuration &config) {
+  ClearOpenSiteCache();
+  for (size_t row = 0; row < tps.rows(); row++) {
+    for (size_t col = 0; col < tps.cols(); col++) {
+      (*this)({row, col}) = tps({row, col})[config({row, col})];
+      site_configs_[row * tps.cols() + col] = config({row, col});
+    }
+  }
+  for (BMPSPOSITION post : {LEFT, DOWN, RIGHT, UP}) {
+    DeleteInnerBMPS(post);
+  }
+  for (auto &[post, btens] : bten_set_) {
+    btens.clear();
+  }
+  for (auto &[post, btens] : bten_set2_) {
+    btens.clear();
+  }
+}
+
 template<typename TenElemT, typename QNT>
 bool TensorNetwork2D<TenElemT, QNT>::DirectionCheck() const {
   for (const auto &[direction, bmps_vec] : bmps_set_) {
@@ -15,6 +15,7 @@ using namespace qlten;
 
 template<typename TenElemT, typename QNT>
 void TensorNetwork2D<TenElemT, QNT>::InitBTen(const qlpeps::BTenPOSITION position, const size_t slice_num) {
+  ClearOpenSiteCache();
   bten_set_[position].clear();
   IndexT index0, index1, index2;
   switch (position) {
@@ -64,6 +65,7 @@ void TensorNetwork2D<TenElemT, QNT>::InitBTen(const qlpeps::BTenPOSITION positio
 
 template<typename TenElemT, typename QNT>
 void TensorNetwork2D<TenElemT, QNT>::TruncateBTen(const qlpeps::BTenPOSITION position, const size_t length) {
+  ClearOpenSiteCache();
   auto &btens = bten_set_.at(position);
   if (btens.size() > length) {
     btens.resize(length);
@@ -132,6 +134,7 @@ void TensorNetwork2D<TenElemT, QNT>::GrowFullBTen(const qlpeps::BTenPOSITION pos
                                                   const size_t slice_num,
                                                   const size_t remain_sites,
                                                   bool init) {
+  ClearOpenSiteCache();
   if (init) {
     InitBTen(position, slice_num);
   }
@@ -409,6 +412,7 @@ void TensorNetwork2D<TenElemT, QNT>::GrowFullBTen2(const BTenPOSITION post, cons
 
 template<typename TenElemT, typename QNT>
 void TensorNetwork2D<TenElemT, QNT>::BTenMoveStep(const BTenPOSITION position) {
+  ClearOpenSiteCache();
   bten_set_[position].pop_back();
   GrowBTenStep(Opposite(position));
 }
@@ -468,6 +472,7 @@ QLTensor<TenElemT, QNT> FermionGrowBTenStep(
 
 template<typename TenElemT, typename QNT>
 void TensorNetwork2D<TenElemT, QNT>::GrowBTenStep(const BTenPOSITION post) {
+  ClearOpenSiteCache();
   size_t ctrct_mpo_start_idx = (size_t(post) + 3) % 4;
   BMPSPOSITION pre_post = BMPSPOSITION(ctrct_mpo_start_idx);
   BMPSPOSITION next_post = BMPSPOSITION((size_t(post) + 1) % 4);
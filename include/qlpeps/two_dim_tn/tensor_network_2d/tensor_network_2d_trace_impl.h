@@ -28,6 +28,14 @@ TenElemT TensorNetwork2D<TenElemT, QNT>::Trace(const SiteIdx &site_a, const Site
                                                const BondOrientation bond_dir) const {
   const Tensor &ten_a = (*this)(site_a);
   const Tensor &ten_b = (*this)(site_b);
+  const size_t config_a = site_configs_[site_a[0] * this->cols() + site_a[1]];
+  const size_t config_b = site_configs_[site_b[0] * this->cols() + site_b[1]];
+  if (open_site_cache_enabled_ && config_a != kUnknownConfig && config_b != kUnknownConfig) {
+    // the same keys as the projections passed to ReplaceNNSiteTrace, so that the halves are shared
+    const Tensor &half_a = OpenSiteHalf_(site_a, bond_dir, true, ten_a, config_a);
+    const Tensor &half_b = OpenSiteHalf_(site_b, bond_dir, false, ten_b, config_b);
+    return ContractNNBondHalves_(half_a, half_b);
+  }
   return ReplaceNNSiteTrace(site_a, site_b, bond_dir, ten_a, ten_b);
 }
 
@@ -120,6 +128,16 @@ TensorNetwork2D<TenElemT, QNT>::ReplaceNNSiteTrace(const SiteIdx &site_a, const
     assert(bten_set_.at(DOWN).size() + 1 > this->rows() - site_b[0]);
   }
 #endif
+  if (bond_trace_threads_ > 1) {
+    // the two halves of the bond are independent
+    Tensor half[2];
+    ParallelForBondTrace_(2, [&](const size_t k) {
+      const SiteIdx &site = k == 0 ? site_a : site_b;
+      const Tensor env = NNBondSiteEnv_(site, bond_dir, k == 0);
+      half[k] = NNBondSiteHalf_(env, site, bond_dir, k == 0, k == 0 ? ten_a : ten_b);
+    });
+    return ContractNNBondHalves_(half[0], half[1]);
+  }
   Tensor tmp[7];
   if (bond_dir == HORIZONTAL) {
     /*
@@ -238,6 +256,169 @@ TensorNetwork2D<TenElemT, QNT>::ReplaceNNSiteTrace(const SiteIdx &site_a, const
   }
 } //ReplaceNNSiteTrace
 
+/**
+ * The environment of one site of a NN bond without the site tensor, i.e. the boundary tensor and the
+ * boundary-MPS tensor on the outer side of the site (first_site: site_a).
+ * Same contractions as in ReplaceNNSiteTrace.
+ */
+template<typename TenElemT, typename QNT>
+QLTensor<TenElemT, QNT>
+TensorNetwork2D<TenElemT, QNT>::NNBondSiteEnv_(const SiteIdx &site, const BondOrientation bond_dir,
+                                               const bool first_site) const {
+  Tensor env;
+  const size_t row = site[0];
+  const size_t col = site[1];
+  if (bond_dir == HORIZONTAL) {
+    if (first_site) {
+      Contract<TenElemT, QNT, true, true>(bmps_set_.at(UP)[row][this->cols() - col - 1],
+                                          bten_set_.at(LEFT)[col], 2, 0, 1, env);
+    } else {
+      Contract<TenElemT, QNT, true, true>(bmps_set_.at(DOWN)[this->rows() - row - 1][col],
+                                          bten_set_.at(RIGHT)[this->cols() - col - 1], 2, 0, 1, env);
+    }
+  } else {
+    if (first_site) {
+      Contract<TenElemT, QNT, true, true>(bmps_set_.at(RIGHT)[this->cols() - col - 1][this->rows() - row - 1],
+                                          bten_set_.at(UP)[row], 2, 0, 1, env);
+    } else {
+      Contract<TenElemT, QNT, true, true>(bmps_set_.at(LEFT)[col][row],
+                                          bten_set_.at(DOWN)[this->rows() - row - 1], 2, 0, 1, env);
+    }
+  }
+  if constexpr (Tensor::IsFermionic()) {
+    env.FuseIndex(0, 5);
+  }
+  return env;
+}
+
+///< The half of a NN bond trace: the site environment closed by the site tensor and the inner boundary-MPS tensor
+template<typename TenElemT, typename QNT>
+QLTensor<TenElemT, QNT>
+TensorNetwork2D<TenElemT, QNT>::NNBondSiteHalf_(const Tensor &env, const SiteIdx &site,
+                                                const BondOrientation bond_dir, const bool first_site,
+                                                const Tensor &ten) const {
+  const size_t row = site[0];
+  const size_t col = site[1];
+  const Tensor *mps_ten;
+  if (bond_dir == HORIZONTAL) {
+    mps_ten = first_site ? &bmps_set_.at(DOWN)[this->rows() - row - 1][col]
+                         : &bmps_set_.at(UP)[row][this->cols() - col - 1];
+  } else {
+    mps_ten = first_site ? &bmps_set_.at(LEFT)[col][row]
+                         : &bmps_set_.at(RIGHT)[this->cols() - col - 1][this->rows() - row - 1];
+  }
+  Tensor tmp, half;
+  if constexpr (Tensor::IsFermionic()) {
+    if (bond_dir == HORIZONTAL) {
+      if (first_site) {
+        Contract(&env, {2, 3}, &ten, {3, 0}, &tmp);
+        Contract(&tmp, {2, 3}, mps_ten, {0, 1}, &half);
+      } else {
+        Contract(&env, {2, 3}, &ten, {1, 2}, &tmp);
+        Contract(&tmp, {2, 4}, mps_ten, {0, 1}, &half);
+      }
+    } else {
+      Contract(&env, {2, 3}, &ten, first_site ? std::vector<size_t>{2, 3} : std::vector<size_t>{0, 1}, &tmp);
+      Contract(&tmp, {2, 3}, mps_ten, {0, 1}, &half);
+    }
+    half.FuseIndex(0, 5);
+  } else {
+    size_t ctrct_idx;
+    if (bond_dir == HORIZONTAL) {
+      ctrct_idx = first_site ? 3 : 1;
+    } else {
+      ctrct_idx = first_site ? 2 : 0;
+    }
+    Contract<TenElemT, QNT, false, false>(env, ten, 1, ctrct_idx, 2, tmp);
+    Contract(&tmp, {0, 2}, mps_ten, {0, 1}, &half);
+  }
+  return half;
+}
+
+template<typename TenElemT, typename QNT>
+TenElemT TensorNetwork2D<TenElemT, QNT>::ContractNNBondHalves_(const Tensor &half_a, const Tensor &half_b) const {
+  Tensor scalar;
+  if constexpr (Tensor::IsFermionic()) {
+    Contract(&half_a, {1, 2, 4}, &half_b, {4, 2, 1}, &scalar);
+    scalar.Transpose({0, 1, 3, 2});
+    return scalar.GetElem({0, 0, 0, 0});
+  } else {
+    Contract(&half_a, {0, 1, 2}, &half_b, {2, 1, 0}, &scalar);
+    return scalar();
+  }
+}
+
+template<typename TenElemT, typename QNT>
+std::vector<TenElemT>
+TensorNetwork2D<TenElemT, QNT>::ReplaceNNSiteTraceBatch(const SiteIdx &site_a, const SiteIdx &site_b,
+                                                        const BondOrientation bond_dir,
+                                                        const std::vector<const Tensor *> &tens_a,
+                                                        const std::vector<const Tensor *> &tens_b) const {
+#ifndef NDEBUG
+  if (bond_dir == HORIZONTAL) {
+    assert(site_a.row() == site_b.row());
+    assert(site_a.col() + 1 == site_b.col());
+  } else {
+    assert(site_a.row() + 1 == site_b.row());
+    assert(site_a.col() == site_b.col());
+  }
+#endif
+  const size_t num_a = tens_a.size(), num_b = tens_b.size();
+  Tensor env[2];
+  ParallelForBondTrace_(2, [&](const size_t k) {
+    env[k] = NNBondSiteEnv_(k == 0 ? site_a : site_b, bond_dir, k == 0);
+  });
+  std::vector<Tensor> half_a(num_a), half_b(num_b);
+  ParallelForBondTrace_(num_a + num_b, [&](const size_t k) {
+    if (k < num_a) {
+      half_a[k] = NNBondSiteHalf_(env[0], site_a, bond_dir, true, *tens_a[k]);
+    } else {
+      half_b[k - num_a] = NNBondSiteHalf_(env[1], site_b, bond_dir, false, *tens_b[k - num_a]);
+    }
+  });
+  std::vector<TenElemT> psi(num_a * num_b);
+  ParallelForBondTrace_(psi.size(), [&](const size_t k) {
+    psi[k] = ContractNNBondHalves_(half_a[k / num_b], half_b[k % num_b]);
+  });
+  return psi;
+} //ReplaceNNSiteTraceBatch
+
+template<typename TenElemT, typename QNT>
+TenElemT
+TensorNetwork2D<TenElemT, QNT>::ReplaceNNSiteTrace(const SiteIdx &site_a, const SiteIdx &site_b,
+                                                   const BondOrientation bond_dir,
+                                                   const std::vector<Tensor> &site_a_tens, const size_t config_a,
+                                                   const std::vector<Tensor> &site_b_tens, const size_t config_b) const {
+  if (!open_site_cache_enabled_) {
+    return ReplaceNNSiteTrace(site_a, site_b, bond_dir, site_a_tens[config_a], site_b_tens[config_b]);
+  }
+  const Tensor &half_a = OpenSiteHalf_(site_a, bond_dir, true, site_a_tens[config_a], config_a);
+  const Tensor &half_b = OpenSiteHalf_(site_b, bond_dir, false, site_b_tens[config_b], config_b);
+  return ContractNNBondHalves_(half_a, half_b);
+}
+
+template<typename TenElemT, typename QNT>
+const QLTensor<TenElemT, QNT> &
+TensorNetwork2D<TenElemT, QNT>::OpenSiteHalf_(const SiteIdx &site, const BondOrientation bond_dir,
+                                              const bool first_site, const Tensor &ten, const size_t config) const {
+  const OpenSiteKey key = {site[0], site[1], bond_dir, first_site, config};
+  auto iter = open_site_cache_.find(key);
+  if (iter != open_site_cache_.end()) {
+    open_site_cache_hits_++;
+    return iter->second;
+  }
+  open_site_cache_misses_++;
+  const Tensor env = NNBondSiteEnv_(site, bond_dir, first_site);
+  return open_site_cache_.emplace(key, NNBondSiteHalf_(env, site, bond_dir, first_site, ten)).first->second;
+}
+
+///< Run task(0), ..., task(task_num - 1) striped over at most bond_trace_threads_ threads, the calling one included
+template<typename TenElemT, typename QNT>
+template<typename TaskT>
+void TensorNetwork2D<TenElemT, QNT>::ParallelForBondTrace_(const size_t task_num, const TaskT &task) const {
+  bond_trace_pool_.ParallelFor(bond_trace_threads_, task_num, task);
+}
+
 template<typename TenElemT, typename QNT>
 TenElemT TensorNetwork2D<TenElemT, QNT>::ReplaceNNNSiteTrace(const SiteIdx &left_up_site,
                                                              const DIAGONAL_DIR nnn_dir,
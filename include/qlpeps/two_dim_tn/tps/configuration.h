@@ -10,6 +10,7 @@
 #include <random>
 #include "qlmps/qlmps.h"
 #include "qlpeps/two_dim_tn/framework/duomatrix.h"
+#include "qlpeps/basic.h"   //random_engine
 #include "mpi.h"        //MPI BroadCast
 
 namespace qlpeps {
@@ -26,33 +27,23 @@ class Configuration : public DuoMatrix<size_t> {
    *
    * @param occupancy_num  a vector with length dim, where dim is the dimension of loccal hilbert space
    *                  occupancy_num[i] indicates how many sites occupy the i-th state.
-   * @param seed seed for random number generator
+   * @param rand_num_gen random number generator
    */
-  void Random(const std::vector<size_t> &occupancy_num) {
-    size_t dim = occupancy_num.size();
-    size_t rows = this->rows();
-    size_t cols = this->cols();
-    std::vector<size_t> configuration_list(rows * cols);
-    size_t off_set = 0;
-    for (size_t i = 0; i < dim; i++) {
-      std::fill(configuration_list.begin() + off_set, configuration_list.begin() + off_set + occupancy_num[i], i);
-      off_set += occupancy_num[i];
-    }
-    assert(off_set == configuration_list.size());
-
-    // random_device can generate different random number during the running
-    // and do not need to feed the seed;
-    // But if the mt19937 is not feed the seed, the rand number it generate in
-    // each time is the same.
-    std::random_device rd;
-    std::mt19937 rand_num_gen(rd());
+  template<typename RandGenerator>
+  void Random(const std::vector<size_t> &occupancy_num, RandGenerator &rand_num_gen) {
+    std::vector<size_t> configuration_list = OrderedList_(occupancy_num);
     std::shuffle(configuration_list.begin(), configuration_list.end(), rand_num_gen);
+    SetFromList_(configuration_list);
+  }
 
-    for (size_t row = 0; row < rows; row++) {
-      for (size_t col = 0; col < cols; col++) {
-        (*this)({row, col}) = configuration_list.at(row * cols + col);
-      }
-    }
+  ///< The configuration with the occupation numbers in the order of the basis, without any random number
+  void Ordered(const std::vector<size_t> &occupancy_num) {
+    SetFromList_(OrderedList_(occupancy_num));
+  }
+
+  ///< Random generate a configuration by the random_engine of the thread, reproducible for a fixed seed
+  void Random(const std::vector<size_t> &occupancy_num) {
+    Random(occupancy_num, random_engine);
   }
 
   size_t Sum(void) const {
@@ -101,7 +92,24 @@ class Configuration : public DuoMatrix<size_t> {
   }
 
  private:
+  std::vector<size_t> OrderedList_(const std::vector<size_t> &occupancy_num) const {
+    std::vector<size_t> configuration_list(this->rows() * this->cols());
+    size_t off_set = 0;
+    for (size_t i = 0; i < occupancy_num.size(); i++) {
+      std::fill(configuration_list.begin() + off_set, configuration_list.begin() + off_set + occupancy_num[i], i);
+      off_set += occupancy_num[i];
+    }
+    assert(off_set == configuration_list.size());
+    return configuration_list;
+  }
 
+  void SetFromList_(const std::vector<size_t> &configuration_list) {
+    for (size_t row = 0; row < this->rows(); row++) {
+      for (size_t col = 0; col < this->cols(); col++) {
+        (*this)({row, col}) = configuration_list.at(row * this->cols() + col);
+      }
+    }
+  }
 };
 
 inline void MPI_Send(
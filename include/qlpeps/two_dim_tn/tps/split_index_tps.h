@@ -8,6 +8,7 @@
 #ifndef QLPEPS_VMC_PEPS_SPLIT_INDEX_TPS_H
 #define QLPEPS_VMC_PEPS_SPLIT_INDEX_TPS_H
 
+#include <climits>                                      // INT_MAX
 #include "qlten/qlten.h"
 #include "qlpeps/two_dim_tn/framework/ten_matrix.h"
 #include "qlpeps/two_dim_tn/tps/tps.h"                  // TPS
@@ -192,24 +193,28 @@ class SplitIndexTPS : public TenMatrix<std::vector<QLTensor<TenElemT, QNT>>> {
 
   ///< Inner product, return Dag(*this) * right
   TenElemT operator*(const SplitIndexTPS &right) const {
+    return InnerProductOnSites(right, 0, this->rows() * this->cols());
+  }
+
+  ///< Dag(*this) * right restricted to the sites [site_begin, site_end) in the row-major order
+  TenElemT InnerProductOnSites(const SplitIndexTPS &right, const size_t site_begin, const size_t site_end) const {
     TenElemT res(0);
     size_t phy_dim = PhysicalDim();
-    for (size_t row = 0; row < this->rows(); ++row) {
-      for (size_t col = 0; col < this->cols(); ++col) {
-        for (size_t i = 0; i < phy_dim; i++) {
-          if ((*this)({row, col})[i].IsDefault() || right({row, col})[i].IsDefault()) {
-            continue;
-          }
-          Tensor ten_dag = Dag((*this)({row, col})[i]);
-          Tensor scalar;
-          if constexpr (Tensor::IsFermionic()) {
-            ten_dag.ActFermionPOps();
-            Contract(&ten_dag, {0, 1, 2, 3, 4}, &right({row, col})[i], {0, 1, 2, 3, 4}, &scalar);
-          } else {
-            Contract(&ten_dag, {0, 1, 2, 3}, &right({row, col})[i], {0, 1, 2, 3}, &scalar);
-          }
-          res += TenElemT(scalar());
+    for (size_t site = site_begin; site < site_end; ++site) {
+      const size_t row = site / this->cols(), col = site % this->cols();
+      for (size_t i = 0; i < phy_dim; i++) {
+        if ((*this)({row, col})[i].IsDefault() || right({row, col})[i].IsDefault()) {
+          continue;
+        }
+        Tensor ten_dag = Dag((*this)({row, col})[i]);
+        Tensor scalar;
+        if constexpr (Tensor::IsFermionic()) {
+          ten_dag.ActFermionPOps();
+          Contract(&ten_dag, {0, 1, 2, 3, 4}, &right({row, col})[i], {0, 1, 2, 3, 4}, &scalar);
+        } else {
+          Contract(&ten_dag, {0, 1, 2, 3}, &right({row, col})[i], {0, 1, 2, 3}, &scalar);
         }
+        res += TenElemT(scalar());
       }
     }
     return res;
@@ -249,6 +254,9 @@ class SplitIndexTPS : public TenMatrix<std::vector<QLTensor<TenElemT, QNT>>> {
   ///< definition: summation of tensor element squares
   double NormSquare() const;
 
+  ///< NormSquare restricted to the sites [site_begin, site_end) in the row-major order
+  double NormSquareOnSites(const size_t site_begin, const size_t site_end) const;
+
   /**
    * Normalize the site tensors
    * to make the sum of 2-norm square of tensors in the site equal to 1.
@@ -74,15 +74,19 @@ bool SplitIndexTPS<TenElemT, QNT>::IsBondDimensionEven(void) const {
 
 template<typename TenElemT, typename QNT>
 double SplitIndexTPS<TenElemT, QNT>::NormSquare() const {
+  return NormSquareOnSites(0, this->rows() * this->cols());
+}
+
+template<typename TenElemT, typename QNT>
+double SplitIndexTPS<TenElemT, QNT>::NormSquareOnSites(const size_t site_begin, const size_t site_end) const {
   double norm_square = 0;
   const size_t phy_dim = PhysicalDim();
-  for (size_t row = 0; row < this->rows(); ++row) {
-    for (size_t col = 0; col < this->cols(); ++col) {
-      for (size_t i = 0; i < phy_dim; i++) {
-        if (!(*this)({row, col})[i].IsDefault()) {
-          double norm_local = (*this)({row, col})[i].GetQuasi2Norm();
-          norm_square += norm_local * norm_local;
-        }
+  for (size_t site = site_begin; site < site_end; ++site) {
+    const size_t row = site / this->cols(), col = site % this->cols();
+    for (size_t i = 0; i < phy_dim; i++) {
+      if (!(*this)({row, col})[i].IsDefault()) {
+        double norm_local = (*this)({row, col})[i].GetQuasi2Norm();
+        norm_square += norm_local * norm_local;
       }
     }
   }
@@ -241,6 +245,379 @@ operator*(const QLTEN_Double scalar, const SplitIndexTPS<QLTEN_Complex, QNT> &sp
   return split_idx_tps * QLTEN_Complex(scalar, 0.0);
 }
 
+/**
+ * Zero tensor with all the blocks allowed by the divergence of ten.
+ * The accumulated tensors initialized in this way share the same data layout in all processes,
+ * so that they can be reduced as a packed buffer.
+ */
+template<typename TenElemT, typename QNT>
+QLTensor<TenElemT, QNT> ZeroTensorWithAllBlocks(const QLTensor<TenElemT, QNT> &ten) {
+  if (ten.IsDefault()) {
+    return QLTensor<TenElemT, QNT>();
+  }
+  QLTensor<TenElemT, QNT> res(ten.GetIndexes());
+  res.Fill(ten.Div(), TenElemT(0.0));
+  return res;
+}
+
+///< Zero split index TPS whose tensors are given by ZeroTensorWithAllBlocks
+template<typename TenElemT, typename QNT>
+SplitIndexTPS<TenElemT, QNT> ZeroSplitIndexTPSWithAllBlocks(const SplitIndexTPS<TenElemT, QNT> &sitps) {
+  SplitIndexTPS<TenElemT, QNT> res(sitps.rows(), sitps.cols());
+  for (size_t row = 0; row < sitps.rows(); row++) {
+    for (size_t col = 0; col < sitps.cols(); col++) {
+      const size_t phy_dim = sitps({row, col}).size();
+      res({row, col}) = std::vector<QLTensor<TenElemT, QNT>>(phy_dim);
+      for (size_t compt = 0; compt < phy_dim; compt++) {
+        res({row, col})[compt] = ZeroTensorWithAllBlocks(sitps({row, col})[compt]);
+      }
+    }
+  }
+  return res;
+}
+
+/**
+ * Number of the elements stored in the non-default tensors of the split index TPS,
+ * i.e. the buffer length used by PackSplitIndexTPSData and UnpackSplitIndexTPSData.
+ */
+template<typename TenElemT, typename QNT>
+size_t SplitIndexTPSDataSize(const SplitIndexTPS<TenElemT, QNT> &v) {
+  size_t data_size = 0;
+  for (const auto &tens : v) {
+    for (const auto &ten : tens) {
+      if (!ten.IsDefault()) {
+        data_size += ten.GetActualDataSize();
+      }
+    }
+  }
+  return data_size;
+}
+
+/**
+ * Copy the raw data of the non-default tensors into a contiguous buffer.
+ *
+ * @return the pointer past the last written element, so that several split index TPS can be packed in sequence.
+ */
+template<typename TenElemT, typename QNT>
+TenElemT *PackSplitIndexTPSData(const SplitIndexTPS<TenElemT, QNT> &v, TenElemT *buffer) {
+  for (const auto &tens : v) {
+    for (const auto &ten : tens) {
+      if (!ten.IsDefault()) {
+        const size_t data_size = ten.GetActualDataSize();
+        hp_numeric::VectorCopy(ten.GetRawDataPtr(), data_size, buffer);
+        buffer += data_size;
+      }
+    }
+  }
+  return buffer;
+}
+
+/**
+ * Inverse of PackSplitIndexTPSData. The block structures of the tensors in v should be the same as the packed ones.
+ *
+ * @return the pointer past the last read element.
+ */
+template<typename TenElemT, typename QNT>
+const TenElemT *UnpackSplitIndexTPSData(const TenElemT *buffer, SplitIndexTPS<TenElemT, QNT> &v) {
+  for (auto &tens : v) {
+    for (auto &ten : tens) {
+      if (!ten.IsDefault()) {
+        const size_t data_size = ten.GetActualDataSize();
+        hp_numeric::VectorCopy(buffer, data_size, ten.GetRawDataPtr());
+        buffer += data_size;
+      }
+    }
+  }
+  return buffer;
+}
+
+///< Largest element number of one MPI message, as the MPI counts are int
+constexpr size_t kMPIMaxCount = size_t(INT_MAX);
+
+/**
+ * Sum the buffer over the processes in place, by MPI_Allreduce (or MPI_Reduce to master)
+ * in chunks of at most kMPIMaxCount elements, so that the int counts do not overflow for huge states.
+ */
+template<typename TenElemT>
+void MPISumBufferInChunks(TenElemT *data, const size_t data_size, const bool all_reduce, const MPI_Comm &comm) {
+  int rank;
+  MPI_Comm_rank(comm, &rank);
+  for (size_t offset = 0; offset < data_size; offset += kMPIMaxCount) {
+    const int count = int(std::min(kMPIMaxCount, data_size - offset));
+    if (all_reduce) {
+      HANDLE_MPI_ERROR(::MPI_Allreduce(MPI_IN_PLACE, data + offset, count,
+                                       hp_numeric::GetMPIDataType<TenElemT>(), MPI_SUM, comm));
+    } else {
+      HANDLE_MPI_ERROR(::MPI_Reduce(rank == kMPIMasterRank ? MPI_IN_PLACE : data + offset, data + offset, count,
+                                    hp_numeric::GetMPIDataType<TenElemT>(), MPI_SUM, kMPIMasterRank, comm));
+    }
+  }
+}
+
+/**
+ * Average a list of split index TPS over the processes by a single MPI_Reduce (or MPI_Allreduce) call.
+ *
+ * All the split index TPS are packed into one contiguous buffer, so the reduction costs one collective
+ * with O(log(mpi_size)) latency instead of the per-tensor point-to-point gathering on master
+ * (one per kMPIMaxCount elements if the buffer exceeds the int range of the MPI counts).
+ * The block structures of the tensors should be the same on all the processes,
+ * e.g. by initializing the accumulated tensors with all the blocks allowed by the divergence.
+ *
+ * @param all_reduce  if false, only the master obtains the averaged results;
+ *                    the data in the other processes are unchanged.
+ */
+template<typename TenElemT, typename QNT>
+void MPIMeanSplitIndexTPS(
+    const std::vector<SplitIndexTPS<TenElemT, QNT> *> &sitps_list,
+    const MPI_Comm &comm,
+    const bool all_reduce = false
+) {
+  int rank, mpi_size;
+  MPI_Comm_rank(comm, &rank);
+  MPI_Comm_size(comm, &mpi_size);
+  if (mpi_size == 1) {
+    return;
+  }
+  size_t data_size = 0;
+  for (const auto *psitps : sitps_list) {
+    data_size += SplitIndexTPSDataSize(*psitps);
+  }
+#ifndef NDEBUG
+  size_t max_data_size;
+  HANDLE_MPI_ERROR(::MPI_Allreduce(&data_size, &max_data_size, 1, MPI_UNSIGNED_LONG_LONG, MPI_MAX, comm));
+  assert(max_data_size == data_size);
+#endif
+  std::vector<TenElemT> buffer(data_size);
+  TenElemT *pbuffer = buffer.data();
+  for (const auto *psitps : sitps_list) {
+    pbuffer = PackSplitIndexTPSData(*psitps, pbuffer);
+  }
+  MPISumBufferInChunks(buffer.data(), data_size, all_reduce, comm);
+  if (all_reduce || rank == kMPIMasterRank) {
+    const double inv_size = 1.0 / double(mpi_size);
+    for (auto &elem : buffer) {
+      elem *= inv_size;
+    }
+    const TenElemT *pdata = buffer.data();
+    for (auto *psitps : sitps_list) {
+      pdata = UnpackSplitIndexTPSData(pdata, *psitps);
+    }
+  }
+}
+
+/**
+ * Partition of the sites over the processes for the sharded updates of a split index TPS.
+ * The sites are ordered row-major, and the process r owns the sites [site_offsets[r], site_offsets[r + 1]).
+ */
+struct SplitIndexTPSShard {
+  std::vector<size_t> site_offsets;
+  int rank = 0;
+
+  bool Empty(void) const { return site_offsets.empty(); }
+  size_t SiteBegin(void) const { return site_offsets[rank]; }
+  size_t SiteEnd(void) const { return site_offsets[rank + 1]; }
+};
+
+///< Number of the elements in the non-default tensors of the sites [site_begin, site_end)
+template<typename TenElemT, typename QNT>
+size_t SplitIndexTPSSitesDataSize(const SplitIndexTPS<TenElemT, QNT> &v,
+                                  const size_t site_begin, const size_t site_end) {
+  size_t data_size = 0;
+  for (size_t site = site_begin; site < site_end; site++) {
+    for (const auto &ten : v({site / v.cols(), site % v.cols()})) {
+      if (!ten.IsDefault()) {
+        data_size += ten.GetActualDataSize();
+      }
+    }
+  }
+  return data_size;
+}
+
+///< PackSplitIndexTPSData restricted to the sites [site_begin, site_end) in the row-major order
+template<typename TenElemT, typename QNT>
+TenElemT *PackSplitIndexTPSSitesData(const SplitIndexTPS<TenElemT, QNT> &v,
+                                     const size_t site_begin, const size_t site_end,
+                                     TenElemT *buffer) {
+  for (size_t site = site_begin; site < site_end; site++) {
+    for (const auto &ten : v({site / v.cols(), site % v.cols()})) {
+      if (!ten.IsDefault()) {
+        const size_t data_size = ten.GetActualDataSize();
+        hp_numeric::VectorCopy(ten.GetRawDataPtr(), data_size, buffer);
+        buffer += data_size;
+      }
+    }
+  }
+  return buffer;
+}
+
+///< Inverse of PackSplitIndexTPSSitesData
+template<typename TenElemT, typename QNT>
+const TenElemT *UnpackSplitIndexTPSSitesData(const TenElemT *buffer,
+                                             const size_t site_begin, const size_t site_end,
+                                             SplitIndexTPS<TenElemT, QNT> &v) {
+  for (size_t site = site_begin; site < site_end; site++) {
+    for (auto &ten : v({site / v.cols(), site % v.cols()})) {
+      if (!ten.IsDefault()) {
+        const size_t data_size = ten.GetActualDataSize();
+        hp_numeric::VectorCopy(buffer, data_size, ten.GetRawDataPtr());
+        buffer += data_size;
+      }
+    }
+  }
+  return buffer;
+}
+
+/**
+ * Split the sites into mpi_size contiguous ranges with nearly equal data sizes.
+ * v should share the data layout in all the processes, so that all the processes get the same partition.
+ */
+template<typename TenElemT, typename QNT>
+SplitIndexTPSShard BalancedSplitIndexTPSShard(const SplitIndexTPS<TenElemT, QNT> &v, const MPI_Comm &comm) {
+  int rank, mpi_size;
+  MPI_Comm_rank(comm, &rank);
+  MPI_Comm_size(comm, &mpi_size);
+  const size_t site_num = v.rows() * v.cols();
+  const size_t total_size = SplitIndexTPSDataSize(v);
+  SplitIndexTPSShard shard;
+  shard.rank = rank;
+  shard.site_offsets.assign(mpi_size + 1, site_num);
+  shard.site_offsets[0] = 0;
+  size_t site = 0, accumulated_size = 0;
+  for (int r = 1; r < mpi_size; r++) {
+    const double aim_size = double(total_size) * r / mpi_size;
+    while (site < site_num && double(accumulated_size) < aim_size) {
+      accumulated_size += SplitIndexTPSSitesDataSize(v, site, site + 1);
+      site++;
+    }
+    shard.site_offsets[r] = site;
+  }
+  return shard;
+}
+
+/**
+ * Data sizes of the shards of all the processes, as the counts of the vector collectives.
+ * Exit if the total data size exceeds the int range of the counts and displacements.
+ */
+template<typename TenElemT, typename QNT>
+std::vector<int> SplitIndexTPSShardDataCounts(const SplitIndexTPS<TenElemT, QNT> &v,
+                                              const SplitIndexTPSShard &shard) {
+  std::vector<int> counts(shard.site_offsets.size() - 1);
+  size_t total_size = 0;
+  for (size_t r = 0; r < counts.size(); r++) {
+    const size_t size = SplitIndexTPSSitesDataSize(v, shard.site_offsets[r], shard.site_offsets[r + 1]);
+    total_size += size;
+    counts[r] = int(size);
+  }
+  // the displacements of MPI_Allgatherv are int as well, so the total size is checked
+  if (total_size > kMPIMaxCount) {
+    if (shard.rank == kMPIMasterRank) {
+      std::cout << "Sharded split index TPS: the data size " << total_size
+                << " exceeds the int range of the MPI counts." << std::endl;
+    }
+    exit(1);
+  }
+  return counts;
+}
+
+/**
+ * Sum v over the processes by one MPI_Reduce_scatter, multiplied by scale.
+ * Only the sites owned by the process get the sums; the other sites keep the local data.
+ * The block structures of the tensors should be the same on all the processes.
+ */
+template<typename TenElemT, typename QNT>
+void MPIReduceScatterSplitIndexTPS(SplitIndexTPS<TenElemT, QNT> &v,
+                                   const SplitIndexTPSShard &shard,
+                                   const MPI_Comm &comm,
+                                   const double scale = 1.0) {
+  const std::vector<int> counts = SplitIndexTPSShardDataCounts(v, shard);
+  std::vector<TenElemT> send_buffer(SplitIndexTPSDataSize(v));
+  PackSplitIndexTPSSitesData(v, 0, v.rows() * v.cols(), send_buffer.data());
+  std::vector<TenElemT> recv_buffer(counts[shard.rank]);
+  HANDLE_MPI_ERROR(::MPI_Reduce_scatter(send_buffer.data(), recv_buffer.data(), counts.data(),
+                                        hp_numeric::GetMPIDataType<TenElemT>(), MPI_SUM, comm));
+  if (scale != 1.0) {
+    for (auto &elem : recv_buffer) {
+      elem *= scale;
+    }
+  }
+  UnpackSplitIndexTPSSitesData(recv_buffer.data(), shard.SiteBegin(), shard.SiteEnd(), v);
+}
+
+/**
+ * Inverse of MPIReduceScatterSplitIndexTPS: gather the sites owned by each process into all the processes
+ * by one MPI_Allgatherv. The block structures of the tensors should be the same on all the processes.
+ */
+template<typename TenElemT, typename QNT>
+void MPIAllGatherSplitIndexTPS(SplitIndexTPS<TenElemT, QNT> &v,
+                               const SplitIndexTPSShard &shard,
+                               const MPI_Comm &comm) {
+  const std::vector<int> counts = SplitIndexTPSShardDataCounts(v, shard);
+  std::vector<int> displs(counts.size(), 0);
+  for (size_t r = 1; r < counts.size(); r++) {
+    displs[r] = displs[r - 1] + counts[r - 1];
+  }
+  std::vector<TenElemT> buffer(SplitIndexTPSDataSize(v));
+  PackSplitIndexTPSSitesData(v, shard.SiteBegin(), shard.SiteEnd(), buffer.data() + displs[shard.rank]);
+  HANDLE_MPI_ERROR(::MPI_Allgatherv(MPI_IN_PLACE, 0, MPI_DATATYPE_NULL,
+                                    buffer.data(), counts.data(), displs.data(),
+                                    hp_numeric::GetMPIDataType<TenElemT>(), comm));
+  UnpackSplitIndexTPSSitesData(buffer.data(), 0, v.rows() * v.cols(), v);
+}
+
+///< The sharded vector operations used by ConjugateGradientSolverSharded
+template<typename TenElemT, typename QNT>
+void CGSolverShardAllGatherVector(SplitIndexTPS<TenElemT, QNT> &v,
+                                  const SplitIndexTPSShard &shard,
+                                  const MPI_Comm &comm) {
+  MPIAllGatherSplitIndexTPS(v, shard, comm);
+}
+
+template<typename TenElemT, typename QNT>
+void CGSolverShardReduceScatterSumVector(SplitIndexTPS<TenElemT, QNT> &v,
+                                         const SplitIndexTPSShard &shard,
+                                         const MPI_Comm &comm) {
+  MPIReduceScatterSplitIndexTPS(v, shard, comm);
+}
+
+template<typename TenElemT, typename QNT>
+TenElemT CGSolverShardInnerProduct(const SplitIndexTPS<TenElemT, QNT> &v1,
+                                   const SplitIndexTPS<TenElemT, QNT> &v2,
+                                   const SplitIndexTPSShard &shard) {
+  return v1.InnerProductOnSites(v2, shard.SiteBegin(), shard.SiteEnd());
+}
+
+template<typename TenElemT, typename QNT>
+double CGSolverShardNormSquare(const SplitIndexTPS<TenElemT, QNT> &v,
+                               const SplitIndexTPSShard &shard) {
+  return v.NormSquareOnSites(shard.SiteBegin(), shard.SiteEnd());
+}
+
+///< y = alpha * x + beta * y on the sites of the shard
+template<typename TenElemT, typename QNT, typename AlphaT, typename BetaT>
+void CGSolverShardAxpby(const AlphaT alpha,
+                        const SplitIndexTPS<TenElemT, QNT> &x,
+                        const BetaT beta,
+                        SplitIndexTPS<TenElemT, QNT> &y,
+                        const SplitIndexTPSShard &shard) {
+  for (size_t site = shard.SiteBegin(); site < shard.SiteEnd(); site++) {
+    const SiteIdx site_idx = {site / y.cols(), site % y.cols()};
+    for (size_t compt = 0; compt < y(site_idx).size(); compt++) {
+      const auto &x_ten = x(site_idx)[compt];
+      auto &y_ten = y(site_idx)[compt];
+      if (y_ten.IsDefault()) {
+        if (!x_ten.IsDefault()) {
+          y_ten = x_ten * TenElemT(alpha);
+        }
+        continue;
+      }
+      y_ten *= TenElemT(beta);
+      if (!x_ten.IsDefault()) {
+        y_ten += x_ten * TenElemT(alpha);
+      }
+    }
+  }
+}
+
 template<typename TenElemT, typename QNT>
 void BroadCast(
     SplitIndexTPS<TenElemT, QNT> &split_index_tps,
@@ -319,6 +696,62 @@ MPI_Status CGSolverRecvVector(
   return status;
 }
 
+/**
+ * Sum the vector over the processes in place, used by the collective-based CG solvers.
+ * The block structures of the tensors should be the same on all the processes.
+ */
+template<typename TenElemT, typename QNT>
+void CGSolverAllReduceSumVector(
+    SplitIndexTPS<TenElemT, QNT> &v,
+    const MPI_Comm &comm
+) {
+  const size_t data_size = SplitIndexTPSDataSize(v);
+#ifndef NDEBUG
+  size_t max_data_size;
+  HANDLE_MPI_ERROR(::MPI_Allreduce(&data_size, &max_data_size, 1, MPI_UNSIGNED_LONG_LONG, MPI_MAX, comm));
+  assert(max_data_size == data_size);
+#endif
+  std::vector<TenElemT> buffer(data_size);
+  PackSplitIndexTPSData(v, buffer.data());
+  MPISumBufferInChunks(buffer.data(), data_size, true, comm);
+  UnpackSplitIndexTPSData(buffer.data(), v);
+}
+
+template<typename TenElemT>
+struct SplitIndexTPSAllReduceHandle {
+  std::vector<TenElemT> buffer;
+  std::vector<MPI_Request> requests; ///< one per chunk of at most kMPIMaxCount elements
+};
+
+///< Non-blocking version of CGSolverAllReduceSumVector, v is updated by CGSolverAllReduceSumVectorWait.
+template<typename TenElemT, typename QNT>
+SplitIndexTPSAllReduceHandle<TenElemT> CGSolverAllReduceSumVectorStart(
+    const SplitIndexTPS<TenElemT, QNT> &v,
+    const MPI_Comm &comm
+) {
+  SplitIndexTPSAllReduceHandle<TenElemT> handle;
+  handle.buffer.resize(SplitIndexTPSDataSize(v));
+  PackSplitIndexTPSData(v, handle.buffer.data());
+  const size_t data_size = handle.buffer.size();
+  for (size_t offset = 0; offset < data_size; offset += kMPIMaxCount) {
+    handle.requests.emplace_back();
+    HANDLE_MPI_ERROR(::MPI_Iallreduce(MPI_IN_PLACE, handle.buffer.data() + offset,
+                                      int(std::min(kMPIMaxCount, data_size - offset)),
+                                      hp_numeric::GetMPIDataType<TenElemT>(), MPI_SUM, comm,
+                                      &handle.requests.back()));
+  }
+  return handle;
+}
+
+template<typename TenElemT, typename QNT>
+void CGSolverAllReduceSumVectorWait(
+    SplitIndexTPSAllReduceHandle<TenElemT> &handle,
+    SplitIndexTPS<TenElemT, QNT> &v
+) {
+  HANDLE_MPI_ERROR(::MPI_Waitall(int(handle.requests.size()), handle.requests.data(), MPI_STATUSES_IGNORE));
+  UnpackSplitIndexTPSData(handle.buffer.data(), v);
+}
+
 }//qlpeps
 
 #endif //QLPEPS_VMC_PEPS_SPLIT_INDEX_TPS_IMPL_H
@@ -12,6 +12,9 @@
 
 #include <cstddef>   //size_t
 #include <iostream>  //cout, endl
+#include <vector>
+#include <deque>
+#include <cmath>     //sqrt, abs
 #include "mpi.h"
 #ifndef  NDEBUG
 
@@ -83,6 +86,13 @@ VectorType ConjugateGradientSolver(
   return x;
 }
 
+///< Communication schemes of the parallel conjugate gradient solver
+enum ConjugateGradientParallelScheme {
+  MasterSlaveCG,          //0, master drives the iteration, the other processes only do the multiplications
+  AllReduceCG,            //1, all processes hold the iterate, one MPI_Allreduce per iteration
+  PipelinedAllReduceCG    //2, Ghysels-Vanroose pipelined CG, the MPI_Iallreduce overlaps with the vector updates
+};
+
 //forward declaration
 
 template<typename MatrixType, typename VectorType>
@@ -113,7 +123,34 @@ VectorType ConjugateGradientSolverMaster(
     double tolerance,
     int,
     size_t &iter,
-    const MPI_Comm &comm
+    const MPI_Comm &comm,
+    bool *converged = nullptr
+);
+
+template<typename MatrixType, typename VectorType>
+VectorType ConjugateGradientSolverAllReduce(
+    const MatrixType &matrix_a,
+    const VectorType &b,
+    const VectorType &x0, //initial guess
+    size_t max_iter,
+    double tolerance,
+    int residue_restart_step,
+    size_t &iter,
+    const MPI_Comm &comm,
+    bool *converged = nullptr
+);
+
+template<typename MatrixType, typename VectorType>
+VectorType ConjugateGradientSolverPipelined(
+    const MatrixType &matrix_a,
+    const VectorType &b,
+    const VectorType &x0, //initial guess
+    size_t max_iter,
+    double tolerance,
+    int residue_restart_step,
+    size_t &iter,
+    const MPI_Comm &comm,
+    bool *converged = nullptr
 );
 
 // virtual forward declaration
@@ -139,6 +176,25 @@ VectorType ConjugateGradientSolverMaster(
 //    const size_t src,
 //    const int tag
 //);
+//
+// and for the AllReduceCG and PipelinedAllReduceCG schemes,
+//template<typename VectorType>
+//void CGSolverAllReduceSumVector(
+//    VectorType &v,
+//    const MPI_Comm& comm
+//);
+//
+//template<typename VectorType>
+//HandleType CGSolverAllReduceSumVectorStart(  // only for PipelinedAllReduceCG
+//    const VectorType &v,
+//    const MPI_Comm& comm
+//);
+//
+//template<typename VectorType>
+//void CGSolverAllReduceSumVectorWait(         // only for PipelinedAllReduceCG
+//    HandleType &handle,
+//    VectorType &v
+//);
 
 /**
  * Parallel version. matrix_a is stored distributed in different processor
@@ -150,6 +206,12 @@ VectorType ConjugateGradientSolverMaster(
  * @param x0
  * @param max_iter
  * @param tolerance
+ * @param scheme  for MasterSlaveCG, b and x0 are only needed in master and only the return in master is valid;
+ *                for AllReduceCG and PipelinedAllReduceCG, b and x0 are broadcast from master and
+ *                the return in all the processes is valid.
+ * @param iter  the number of iterations done, max_iter both if the residue reaches the tolerance in the last
+ *              iteration and if it never does
+ * @param converged  if not null, set to whether the residue reached the tolerance, where the return is valid
  * @return  only return in proc 0 is valid
  */
 template<typename MatrixType, typename VectorType>
@@ -161,13 +223,24 @@ VectorType ConjugateGradientSolver(
     const double tolerance,
     const int residue_restart_step,
     size_t &iter,    //return value
-    const MPI_Comm &comm
+    const MPI_Comm &comm,
+    const ConjugateGradientParallelScheme scheme = MasterSlaveCG,
+    bool *converged = nullptr  //return value if not null
 ) {
+  if (scheme == AllReduceCG) {
+    return ConjugateGradientSolverAllReduce(
+        matrix_a, b, x0, max_iter, tolerance, residue_restart_step, iter, comm, converged
+    );
+  } else if (scheme == PipelinedAllReduceCG) {
+    return ConjugateGradientSolverPipelined(
+        matrix_a, b, x0, max_iter, tolerance, residue_restart_step, iter, comm, converged
+    );
+  }
   int rank;
   MPI_Comm_rank(comm, &rank);
   if (rank == kMPIMasterRank) {
     return ConjugateGradientSolverMaster(
-        matrix_a, b, x0, max_iter, tolerance, residue_restart_step, iter, comm
+        matrix_a, b, x0, max_iter, tolerance, residue_restart_step, iter, comm, converged
     );
   } else {
     ConjugateGradientSolverSlave<MatrixType, VectorType>(
@@ -229,7 +302,8 @@ VectorType ConjugateGradientSolverMaster(
     double tolerance,
     int residue_restart_step,
     size_t &iter,
-    const MPI_Comm &comm
+    const MPI_Comm &comm,
+    bool *converged
 ) {
   MasterBroadcastInstruction(start, comm);
 
@@ -240,6 +314,9 @@ VectorType ConjugateGradientSolverMaster(
   double rk_2norm = r.NormSquare();
   if (rk_2norm < tol) {
     iter = 0;
+    if (converged) {
+      *converged = true;
+    }
     MasterBroadcastInstruction(finish, comm);
     return x0;
   }
@@ -273,6 +350,9 @@ VectorType ConjugateGradientSolverMaster(
 
     if (rkp1_2norm < tol) {
       iter = k + 1;
+      if (converged) {
+        *converged = true;
+      }
       MasterBroadcastInstruction(finish, comm);
       return x;
     }
@@ -294,6 +374,9 @@ VectorType ConjugateGradientSolverMaster(
     rk_2norm = rkp1_2norm;
   }
   iter = max_iter;
+  if (converged) {
+    *converged = false;
+  }
   std::cout << "warning: convergence may fail on gradient solving linear equation. rkp1_2norm = " << std::scientific
             << rkp1_2norm
             << std::endl;
@@ -366,6 +449,721 @@ void MatrixMultiplyVectorSlave(
   CGSolverSendVector(comm, res, kMPIMasterRank, 0);
 }
 
+template<typename MatrixType, typename VectorType>
+VectorType MatrixMultiplyVectorAllReduce(
+    const MatrixType &mat,
+    const VectorType &v,
+    const MPI_Comm &comm
+) {
+#ifdef QLPEPS_TIMING_MODE
+  qlten::Timer cg_mat_vec_mult_timer("conjugate gradient matrix vector multiplication");
+#endif
+  VectorType res = mat * v;
+#ifdef QLPEPS_TIMING_MODE
+  qlten::Timer cg_all_reduce_vec_timer("conjugate gradient all reduce vector");
+#endif
+  CGSolverAllReduceSumVector(res, comm); //defined by user
+#ifdef QLPEPS_TIMING_MODE
+  cg_all_reduce_vec_timer.PrintElapsed();
+  cg_mat_vec_mult_timer.PrintElapsed();
+#endif
+  return res;
+}
+
+/**
+ * SPMD version of the parallel CG. All the processes hold the iterate, and the partial
+ * products matrix_a * p are summed by one MPI_Allreduce per iteration.
+ * The inner products are calculated locally, so no instruction or scalar is broadcast.
+ *
+ * The iterates are kept the same in all the processes as long as MPI_Allreduce returns
+ * the same result in all the processes, which is the case in the common MPI implementations.
+ */
+template<typename MatrixType, typename VectorType>
+VectorType ConjugateGradientSolverAllReduce(
+    const MatrixType &matrix_a,
+    const VectorType &b,
+    const VectorType &x0, //initial guess
+    size_t max_iter,
+    double tolerance,
+    int residue_restart_step,
+    size_t &iter,
+    const MPI_Comm &comm,
+    bool *converged
+) {
+  VectorType b_all = b, x = x0;
+  CGSolverBroadCastVector(b_all, comm);
+  CGSolverBroadCastVector(x, comm);
+  double tol = b_all.NormSquare() * tolerance;
+
+  VectorType r = b_all - MatrixMultiplyVectorAllReduce(matrix_a, x, comm);
+  double rk_2norm = r.NormSquare();
+  if (rk_2norm < tol) {
+    iter = 0;
+    if (converged) {
+      *converged = true;
+    }
+    return x;
+  }
+  VectorType p = r;
+  double rkp1_2norm;
+  for (size_t k = 0; k < max_iter; k++) {
+    VectorType ap = MatrixMultiplyVectorAllReduce(matrix_a, p, comm);
+    auto pap = (p * ap);
+    auto alpha = rk_2norm / pap; //auto is double or complex
+#ifndef NDEBUG
+    assert(pap_check(pap));
+#endif
+    x += alpha * p;
+
+    if (residue_restart_step > 0 && (k % residue_restart_step) == (residue_restart_step - 1)) {
+      r = b_all - MatrixMultiplyVectorAllReduce(matrix_a, x, comm);
+    } else {
+      r += (-alpha) * ap;
+    }
+    rkp1_2norm = r.NormSquare();
+
+    if (rkp1_2norm < tol) {
+      iter = k + 1;
+      if (converged) {
+        *converged = true;
+      }
+      return x;
+    }
+    double beta = rkp1_2norm / rk_2norm;
+    p = r + beta * p;
+    rk_2norm = rkp1_2norm;
+  }
+  iter = max_iter;
+  if (converged) {
+    *converged = false;
+  }
+  int rank;
+  MPI_Comm_rank(comm, &rank);
+  if (rank == kMPIMasterRank) {
+    std::cout << "warning: convergence may fail on gradient solving linear equation. rkp1_2norm = "
+              << std::scientific << rkp1_2norm << std::endl;
+  }
+  return x;
+}
+
+/**
+ * Pipelined CG without preconditioner, following
+ * P. Ghysels and W. Vanroose, Parallel Computing 40, 224 (2014).
+ *
+ * The recurrences of s = A p and z = A s are carried along with r and w = A r, so the only
+ * matrix-vector multiplication per iteration is n = A w. Its MPI_Iallreduce is overlapped with
+ * the updates of s, p, x, r, which do not depend on n. The inner products are local as in
+ * ConjugateGradientSolverAllReduce.
+ *
+ * Every residue_restart_step iterations the residue is recalculated as b - A x and
+ * the recurrences restart from it, to suppress the accumulated rounding errors,
+ * which are larger than in the standard CG.
+ */
+template<typename MatrixType, typename VectorType>
+VectorType ConjugateGradientSolverPipelined(
+    const MatrixType &matrix_a,
+    const VectorType &b,
+    const VectorType &x0, //initial guess
+    size_t max_iter,
+    double tolerance,
+    int residue_restart_step,
+    size_t &iter,
+    const MPI_Comm &comm,
+    bool *converged
+) {
+  VectorType b_all = b, x = x0;
+  CGSolverBroadCastVector(b_all, comm);
+  CGSolverBroadCastVector(x, comm);
+  double tol = b_all.NormSquare() * tolerance;
+
+  VectorType r = b_all - MatrixMultiplyVectorAllReduce(matrix_a, x, comm);
+  VectorType w = MatrixMultiplyVectorAllReduce(matrix_a, r, comm);
+  VectorType z, s, p;
+  double gamma = r.NormSquare(), gamma_old = gamma;
+  if (gamma < tol) {
+    iter = 0;
+    if (converged) {
+      *converged = true;
+    }
+    return x;
+  }
+  decltype(r * w) alpha(1.0);
+  bool restart = true;
+  for (size_t k = 0; k < max_iter; k++) {
+    auto delta = r * w;
+    VectorType n = matrix_a * w;
+    auto handle = CGSolverAllReduceSumVectorStart(n, comm); //defined by user
+    if (restart) {
+      alpha = gamma / delta;
+      s = w;
+      p = r;
+    } else {
+      double beta = gamma / gamma_old;
+      alpha = gamma / (delta - beta * gamma / alpha);
+      s = w + beta * s;
+      p = r + beta * p;
+    }
+    x += alpha * p;
+    r += (-alpha) * s;
+    CGSolverAllReduceSumVectorWait(handle, n); //defined by user
+    if (restart) {
+      z = n;
+    } else {
+      z = n + (gamma / gamma_old) * z;
+    }
+    w += (-alpha) * z;
+    restart = false;
+
+    if (residue_restart_step > 0 && (k % residue_restart_step) == (residue_restart_step - 1)) {
+      r = b_all - MatrixMultiplyVectorAllReduce(matrix_a, x, comm);
+      w = MatrixMultiplyVectorAllReduce(matrix_a, r, comm);
+      restart = true;
+    }
+    gamma_old = gamma;
+    gamma = r.NormSquare();
+    if (gamma < tol) {
+      iter = k + 1;
+      if (converged) {
+        *converged = true;
+      }
+      return x;
+    }
+  }
+  iter = max_iter;
+  if (converged) {
+    *converged = false;
+  }
+  int rank;
+  MPI_Comm_rank(comm, &rank);
+  if (rank == kMPIMasterRank) {
+    std::cout << "warning: convergence may fail on gradient solving linear equation. rkp1_2norm = "
+              << std::scientific << gamma << std::endl;
+  }
+  return x;
+}
+
+/**
+ * CG with the vectors sharded over the processes, e.g. by the sites of a split index TPS.
+ * Each process only updates its shard of x, r and p, and the inner products are summed by scalar MPI_Allreduce.
+ * The multiplication gathers p by an all-gather, multiplies it by the local part of matrix_a and
+ * sums the shards back by a reduce-scatter, which together communicate as much as one MPI_Allreduce of the vector.
+ *
+ * The user should define the following functions for the VectorType and the ShardType,
+ *    CGSolverShardAllGatherVector(v, shard, comm),
+ *    CGSolverShardReduceScatterSumVector(v, shard, comm),
+ *    CGSolverShardInnerProduct(v1, v2, shard) and CGSolverShardNormSquare(v, shard), the local parts,
+ *    CGSolverShardAxpby(alpha, x, beta, y, shard), y = alpha * x + beta * y on the shard.
+ *
+ * @param b, x0  only the shards of the process are used
+ * @return  the solution gathered to all the processes
+ */
+template<typename MatrixType, typename VectorType, typename ShardType>
+VectorType ConjugateGradientSolverSharded(
+    const MatrixType &matrix_a,
+    const VectorType &b,
+    const VectorType &x0, //initial guess
+    size_t max_iter,
+    double tolerance,
+    int residue_restart_step,
+    size_t &iter,
+    const ShardType &shard,
+    const MPI_Comm &comm
+) {
+  auto all_reduce_sum = [&comm](auto value) {
+    HANDLE_MPI_ERROR(::MPI_Allreduce(MPI_IN_PLACE, &value, 1, hp_numeric::GetMPIDataType<decltype(value)>(),
+                                     MPI_SUM, comm));
+    return value;
+  };
+  auto multiply = [&](VectorType &v) {
+    CGSolverShardAllGatherVector(v, shard, comm);
+    VectorType res = matrix_a * v;
+    CGSolverShardReduceScatterSumVector(res, shard, comm);
+    return res;
+  };
+  auto residue = [&](VectorType &x) {
+    VectorType r = multiply(x);
+    CGSolverShardAxpby(1.0, b, -1.0, r, shard);
+    return r;
+  };
+  const double tol = all_reduce_sum(CGSolverShardNormSquare(b, shard)) * tolerance;
+  VectorType x = x0;
+  VectorType r = residue(x);
+  double rk_2norm = all_reduce_sum(CGSolverShardNormSquare(r, shard));
+  if (rk_2norm < tol) {
+    iter = 0;
+    CGSolverShardAllGatherVector(x, shard, comm);
+    return x;
+  }
+  VectorType p = r;
+  double rkp1_2norm;
+  for (size_t k = 0; k < max_iter; k++) {
+    VectorType ap = multiply(p);
+    auto pap = all_reduce_sum(CGSolverShardInnerProduct(p, ap, shard));
+    auto alpha = rk_2norm / pap; //auto is double or complex
+#ifndef NDEBUG
+    assert(pap_check(pap));
+#endif
+    CGSolverShardAxpby(alpha, p, 1.0, x, shard);
+
+    if (residue_restart_step > 0 && (k % residue_restart_step) == (residue_restart_step - 1)) {
+      r = residue(x);
+    } else {
+      CGSolverShardAxpby(-alpha, ap, 1.0, r, shard);
+    }
+    rkp1_2norm = all_reduce_sum(CGSolverShardNormSquare(r, shard));
+
+    if (rkp1_2norm < tol) {
+      iter = k + 1;
+      CGSolverShardAllGatherVector(x, shard, comm);
+      return x;
+    }
+    double beta = rkp1_2norm / rk_2norm;
+    CGSolverShardAxpby(1.0, r, beta, p, shard);
+    rk_2norm = rkp1_2norm;
+  }
+  iter = max_iter;
+  CGSolverShardAllGatherVector(x, shard, comm);
+  int rank;
+  MPI_Comm_rank(comm, &rank);
+  if (rank == kMPIMasterRank) {
+    std::cout << "warning: convergence may fail on gradient solving linear equation. rkp1_2norm = "
+              << std::scientific << rkp1_2norm << std::endl;
+  }
+  return x;
+}
+
+/**
+ * Serial preconditioned CG. preconditioner(r) returns M^{-1} r, where M is a self-conjugated positive
+ * definite approximation of matrix_a. The tolerance is on |r|^2 as in the serial ConjugateGradientSolver.
+ */
+template<typename MatrixType, typename VectorType, typename PreconditionerType>
+VectorType PreconditionedConjugateGradientSolver(
+    const MatrixType &matrix_a,
+    const VectorType &b,
+    const VectorType &x0, //initial guess
+    const PreconditionerType &preconditioner,
+    const size_t max_iter,
+    const double tolerance,
+    size_t &iter   //return
+) {
+  VectorType x = x0;
+  VectorType r = b - matrix_a * x0;
+  double r_2norm = r.NormSquare();
+  if (r_2norm < tolerance) {
+    iter = 0;
+    return x;
+  }
+  VectorType z = preconditioner(r);
+  VectorType p = z;
+  auto rz = r * z;
+  for (size_t k = 0; k < max_iter; k++) {
+    VectorType ap = matrix_a * p;
+    auto alpha = rz / (p * ap);
+    x += alpha * p;
+    r += (-alpha) * ap;
+    r_2norm = r.NormSquare();
+    if (r_2norm < tolerance) {
+      iter = k + 1;
+      return x;
+    }
+    z = preconditioner(r);
+    auto rz_new = r * z;
+    auto beta = rz_new / rz;
+    p = z + beta * p;
+    rz = rz_new;
+  }
+  iter = max_iter;
+  std::cout << "warning: convergence may fail on gradient solving linear equation. rkp1_2norm = " << std::scientific
+            << r_2norm
+            << std::endl;
+  return x;
+}
+
+/**
+ * Parallel preconditioned CG. The preconditioner is applied where the iterate is held:
+ * only in master for MasterSlaveCG (the slaves run the same ConjugateGradientSolverSlave),
+ * and in all the processes for AllReduceCG. PipelinedAllReduceCG falls back to the preconditioned
+ * AllReduceCG. The tolerance, validity of arguments and return are the same as ConjugateGradientSolver.
+ */
+template<typename MatrixType, typename VectorType, typename PreconditionerType>
+VectorType PreconditionedConjugateGradientSolver(
+    const MatrixType &matrix_a,
+    const VectorType &b,
+    const VectorType &x0, //initial guess
+    const PreconditionerType &preconditioner,
+    const size_t max_iter,
+    const double tolerance,
+    const int residue_restart_step,
+    size_t &iter,    //return value
+    const MPI_Comm &comm,
+    const ConjugateGradientParallelScheme scheme = MasterSlaveCG
+) {
+  int rank;
+  MPI_Comm_rank(comm, &rank);
+  const bool master_slave = (scheme == MasterSlaveCG);
+  if (master_slave && rank != kMPIMasterRank) {
+    ConjugateGradientSolverSlave<MatrixType, VectorType>(matrix_a, comm);
+    return x0;
+  }
+  auto multiply = [&](const VectorType &v) {
+    if (master_slave) {
+      return MatrixMultiplyVectorMaster(matrix_a, v, comm);
+    } else {
+      return MatrixMultiplyVectorAllReduce(matrix_a, v, comm);
+    }
+  };
+  auto finish_solve = [&]() {
+    if (master_slave) {
+      MasterBroadcastInstruction(finish, comm);
+    }
+  };
+  VectorType b_all = b, x = x0;
+  if (master_slave) {
+    MasterBroadcastInstruction(start, comm);
+  } else {
+    CGSolverBroadCastVector(b_all, comm);
+    CGSolverBroadCastVector(x, comm);
+  }
+  const double tol = b_all.NormSquare() * tolerance;
+
+  VectorType r = b_all - multiply(x);
+  double r_2norm = r.NormSquare();
+  if (r_2norm < tol) {
+    iter = 0;
+    finish_solve();
+    return x;
+  }
+  VectorType z = preconditioner(r);
+  VectorType p = z;
+  auto rz = r * z;
+  for (size_t k = 0; k < max_iter; k++) {
+    if (master_slave) {
+      MasterBroadcastInstruction(multiplication, comm);
+    }
+    VectorType ap = multiply(p);
+    auto pap = (p * ap);
+    auto alpha = rz / pap;
+#ifndef NDEBUG
+    assert(pap_check(pap));
+#endif
+    x += alpha * p;
+    if (residue_restart_step > 0 && (k % residue_restart_step) == (residue_restart_step - 1)) {
+      if (master_slave) {
+        MasterBroadcastInstruction(multiplication, comm);
+      }
+      r = b_all - multiply(x);
+    } else {
+      r += (-alpha) * ap;
+    }
+    r_2norm = r.NormSquare();
+    if (r_2norm < tol) {
+      iter = k + 1;
+      finish_solve();
+      return x;
+    }
+    z = preconditioner(r);
+    auto rz_new = r * z;
+    auto beta = rz_new / rz;
+    p = z + beta * p;
+    rz = rz_new;
+  }
+  iter = max_iter;
+  if (rank == kMPIMasterRank) {
+    std::cout << "warning: convergence may fail on gradient solving linear equation. rkp1_2norm = "
+              << std::scientific << r_2norm << std::endl;
+  }
+  finish_solve();
+  return x;
+}
+
+/**
+ * Krylov subspace recycling for a sequence of correlated linear systems A_i x_i = b_i,
+ * e.g. the SR equations of the consecutive optimization iterations.
+ *
+ * The space keeps the solutions of the last max_dim solves. Before the next solve, the initial guess x0 is
+ * replaced by the Galerkin projection onto span{x0, recycled solutions}, as the initial guess of init-CG:
+ *          x0' = V (V^dag A V)^{-1} V^dag b,
+ * where V is an orthonormal basis of the span. x0' has the minimal A-norm error in the span, so it is never
+ * worse than x0, at the cost of dim(V) extra matrix-vector multiplications. Only the initial guess changes:
+ * the CG iterations run on A itself, without the deflated operator of deflated CG or GCRO-DR.
+ */
+template<typename VectorType>
+class CGRecycleSpace {
+ public:
+  CGRecycleSpace(void) : CGRecycleSpace(0) {}
+
+  explicit CGRecycleSpace(const size_t max_dim) : max_dim_(max_dim) {}
+
+  ///< Add a solution, dropping the oldest one if the space is full
+  void Add(const VectorType &x) {
+    if (max_dim_ == 0) {
+      return;
+    }
+    if (vecs_.size() == max_dim_) {
+      vecs_.pop_front();
+    }
+    vecs_.push_back(x);
+  }
+
+  void Clear(void) { vecs_.clear(); }
+
+  size_t Dim(void) const { return vecs_.size(); }
+
+  size_t MaxDim(void) const { return max_dim_; }
+
+  const std::deque<VectorType> &Vectors(void) const { return vecs_; }
+
+ private:
+  size_t max_dim_;
+  std::deque<VectorType> vecs_;
+};
+
+/**
+ * Solve the small dense linear equation a * x = b by Gaussian elimination with partial pivoting.
+ *
+ * @param a  n x n matrix, row major
+ */
+template<typename ElemT>
+std::vector<ElemT> SolveSmallDenseLinearEquation(std::vector<ElemT> a, std::vector<ElemT> b) {
+  const size_t n = b.size();
+  for (size_t k = 0; k < n; k++) {
+    size_t pivot = k;
+    for (size_t i = k + 1; i < n; i++) {
+      if (std::abs(a[i * n + k]) > std::abs(a[pivot * n + k])) {
+        pivot = i;
+      }
+    }
+    if (pivot != k) {
+      for (size_t j = 0; j < n; j++) {
+        std::swap(a[k * n + j], a[pivot * n + j]);
+      }
+      std::swap(b[k], b[pivot]);
+    }
+    for (size_t i = k + 1; i < n; i++) {
+      ElemT factor = a[i * n + k] / a[k * n + k];
+      for (size_t j = k; j < n; j++) {
+        a[i * n + j] -= factor * a[k * n + j];
+      }
+      b[i] -= factor * b[k];
+    }
+  }
+  std::vector<ElemT> x(n);
+  for (size_t i = n; i-- > 0;) {
+    ElemT sum = b[i];
+    for (size_t j = i + 1; j < n; j++) {
+      sum -= a[i * n + j] * x[j];
+    }
+    x[i] = sum / a[i * n + i];
+  }
+  return x;
+}
+
+/**
+ * Orthonormal basis of span{x0, recycled vectors} by the modified Gram-Schmidt process.
+ * Vectors (almost) linearly dependent on the previous ones are dropped.
+ */
+template<typename VectorType>
+std::vector<VectorType> RecycleSpaceBasis(const VectorType &x0, const CGRecycleSpace<VectorType> &space) {
+  const double drop_tolerance = 1e-10;
+  std::vector<VectorType> basis;
+  basis.reserve(space.Dim() + 1);
+  auto add = [&](VectorType v) {
+    const double norm_square = v.NormSquare();
+    if (norm_square == 0.0) {
+      return;
+    }
+    for (const VectorType &u : basis) {
+      v += (-(u * v)) * u;
+    }
+    const double residual_norm_square = v.NormSquare();
+    if (residual_norm_square > drop_tolerance * norm_square) {
+      basis.push_back((1.0 / std::sqrt(residual_norm_square)) * v);
+    }
+  };
+  add(x0);
+  for (const VectorType &v : space.Vectors()) {
+    add(v);
+  }
+  return basis;
+}
+
+/**
+ * Galerkin projection of the solution of matrix_a * x = b onto the span of the basis,
+ * given the products a_basis[j] = matrix_a * basis[j] and the projections basis_b[i] = basis[i]^dag * b.
+ */
+template<typename VectorType, typename ElemT>
+VectorType GalerkinProjectedSolution(const std::vector<VectorType> &basis,
+                                     const std::vector<VectorType> &a_basis,
+                                     const std::vector<ElemT> &basis_b) {
+  const size_t n = basis.size();
+  std::vector<ElemT> g(n * n);
+  for (size_t i = 0; i < n; i++) {
+    for (size_t j = 0; j < n; j++) {
+      g[i * n + j] = basis[i] * a_basis[j];
+    }
+  }
+  std::vector<ElemT> c = SolveSmallDenseLinearEquation(g, basis_b);
+  VectorType x = c[0] * basis[0];
+  for (size_t j = 1; j < n; j++) {
+    x += c[j] * basis[j];
+  }
+  return x;
+}
+
+/**
+ * Serial version of the recycled initial guess, see CGRecycleSpace
+ *
+ * @param matvec_num  if not null, returns the number of matrix-vector multiplications spent on the projection
+ */
+template<typename MatrixType, typename VectorType>
+VectorType RecycledInitialGuess(
+    const MatrixType &matrix_a,
+    const VectorType &b,
+    const VectorType &x0,
+    const CGRecycleSpace<VectorType> &space,
+    size_t *matvec_num = nullptr
+) {
+  std::vector<VectorType> basis = RecycleSpaceBasis(x0, space);
+  if (matvec_num != nullptr) {
+    *matvec_num = basis.size();
+  }
+  if (basis.empty()) {
+    return x0;
+  }
+  std::vector<VectorType> a_basis;
+  std::vector<decltype(b * b)> basis_b;
+  for (const VectorType &v : basis) {
+    a_basis.push_back(matrix_a * v);
+    basis_b.push_back(v * b);
+  }
+  return GalerkinProjectedSolution(basis, a_basis, basis_b);
+}
+
+/**
+ * Parallel version of the recycled initial guess. The communication follows the scheme:
+ * for MasterSlaveCG, x0, b and the space are only needed in master, and the slaves join the
+ * matrix-vector multiplications; for AllReduceCG and PipelinedAllReduceCG, the space should be
+ * the same in all the processes (as the solutions of these schemes are), and x0 is broadcast from master.
+ *
+ * @param matvec_num  if not null, returns the number of matrix-vector multiplications spent on the projection,
+ *                    in all the processes
+ * @return  the same validity as the solution of the scheme
+ */
+template<typename MatrixType, typename VectorType>
+VectorType RecycledInitialGuess(
+    const MatrixType &matrix_a,
+    const VectorType &b,
+    const VectorType &x0,
+    const CGRecycleSpace<VectorType> &space,
+    const MPI_Comm &comm,
+    const ConjugateGradientParallelScheme scheme,
+    size_t *matvec_num = nullptr
+) {
+  using ElemT = decltype(b * b);
+  int rank;
+  MPI_Comm_rank(comm, &rank);
+  if (scheme == MasterSlaveCG) {
+    std::vector<VectorType> basis;
+    size_t basis_dim;
+    if (rank == kMPIMasterRank) {
+      basis = RecycleSpaceBasis(x0, space);
+      basis_dim = basis.size();
+    }
+    HANDLE_MPI_ERROR(::MPI_Bcast(&basis_dim, 1, MPI_UNSIGNED_LONG_LONG, kMPIMasterRank, comm));
+    if (matvec_num != nullptr) {
+      *matvec_num = basis_dim;
+    }
+    if (basis_dim == 0) {
+      return x0;
+    }
+    if (rank != kMPIMasterRank) {
+      ConjugateGradientSolverSlave<MatrixType, VectorType>(matrix_a, comm);
+      return x0;
+    }
+    std::vector<VectorType> a_basis;
+    std::vector<ElemT> basis_b;
+    MasterBroadcastInstruction(start, comm);
+    for (size_t j = 0; j < basis_dim; j++) {
+      if (j > 0) {
+        MasterBroadcastInstruction(multiplication, comm);
+      }
+      a_basis.push_back(MatrixMultiplyVectorMaster(matrix_a, basis[j], comm));
+      basis_b.push_back(basis[j] * b);
+    }
+    MasterBroadcastInstruction(finish, comm);
+    return GalerkinProjectedSolution(basis, a_basis, basis_b);
+  }
+
+  VectorType x0_all = x0;
+  CGSolverBroadCastVector(x0_all, comm);
+  std::vector<VectorType> basis = RecycleSpaceBasis(x0_all, space);
+  if (matvec_num != nullptr) {
+    *matvec_num = basis.size();
+  }
+  if (basis.empty()) {
+    return x0_all;
+  }
+  std::vector<VectorType> a_basis;
+  std::vector<ElemT> basis_b(basis.size());
+  for (size_t j = 0; j < basis.size(); j++) {
+    a_basis.push_back(MatrixMultiplyVectorAllReduce(matrix_a, basis[j], comm));
+    if (rank == kMPIMasterRank) {
+      basis_b[j] = basis[j] * b;
+    }
+  }
+  HANDLE_MPI_ERROR(::MPI_Bcast(basis_b.data(), basis_b.size(), hp_numeric::GetMPIDataType<ElemT>(),
+                               kMPIMasterRank, comm));
+  return GalerkinProjectedSolution(basis, a_basis, basis_b);
+}
+
+/**
+ * Serial CG with Krylov subspace recycling. The initial guess is improved by the recycle space,
+ * and the solution is added into the space for the next solve.
+ */
+template<typename MatrixType, typename VectorType>
+VectorType RecycledConjugateGradientSolver(
+    const MatrixType &matrix_a,
+    const VectorType &b,
+    const VectorType &x0, //initial guess
+    const size_t max_iter,
+    const double tolerance,
+    size_t &iter,   //return
+    CGRecycleSpace<VectorType> &space
+) {
+  VectorType x = ConjugateGradientSolver(matrix_a, b, RecycledInitialGuess(matrix_a, b, x0, space),
+                                         max_iter, tolerance, iter);
+  space.Add(x);
+  return x;
+}
+
+/**
+ * Parallel CG with Krylov subspace recycling. The validity of the arguments and return is the same as
+ * ConjugateGradientSolver. For MasterSlaveCG the space is only used in master;
+ * for the other schemes the space is updated identically in all the processes.
+ */
+template<typename MatrixType, typename VectorType>
+VectorType RecycledConjugateGradientSolver(
+    const MatrixType &matrix_a,
+    const VectorType &b,
+    const VectorType &x0, //initial guess
+    const size_t max_iter,
+    const double tolerance,
+    const int residue_restart_step,
+    size_t &iter,    //return value
+    const MPI_Comm &comm,
+    const ConjugateGradientParallelScheme scheme,
+    CGRecycleSpace<VectorType> &space
+) {
+  VectorType x = ConjugateGradientSolver(matrix_a, b, RecycledInitialGuess(matrix_a, b, x0, space, comm, scheme),
+                                         max_iter, tolerance, residue_restart_step, iter, comm, scheme);
+  int rank;
+  MPI_Comm_rank(comm, &rank);
+  if (scheme != MasterSlaveCG || rank == kMPIMasterRank) {
+    space.Add(x);
+  }
+  return x;
+}
+
 }//qlpeps
 
 #endif //QLPEPS_VMC_PEPS_CONJUGATE_GRADIENT_SOLVER_H
@@ -0,0 +1,68 @@
+// SPDX-License-Identifier: LGPL-3.0-only
+
+/*
+* Author: Hao-Xin Wang<wanghaoxin1996@gmail.com>
+* Creation Date: 2024-10-16
+*
+* Description: QuantumLiquids/PEPS project. Fused in-place accumulation kernels for running sums of samples.
+*/
+
+#ifndef QLPEPS_UTILITY_FUSED_ACCUMULATION_H
+#define QLPEPS_UTILITY_FUSED_ACCUMULATION_H
+
+#include <cstddef>   //size_t
+
+namespace qlpeps {
+
+enum SumAccumulationScheme {
+  NaiveSummation,   //0, y += a * x
+  KahanSummation    //1, compensated summation, keeps the low-order bits lost when adding small to large numbers
+};
+
+/**
+ * y += a * x and z += b * x in a single pass over x, without temporaries.
+ */
+template<typename ElemT>
+void FusedAxpyAccumulate(const size_t n, const ElemT a, const ElemT b,
+                         const ElemT *x, ElemT *y, ElemT *z) {
+  for (size_t i = 0; i < n; i++) {
+    const ElemT xi = x[i];
+    y[i] += a * xi;
+    z[i] += b * xi;
+  }
+}
+
+/**
+ * Kahan-compensated version of FusedAxpyAccumulate.
+ * y_comp and z_comp store the (negative) lost low-order parts, which should be zero initially,
+ * and the compensated sums are y - y_comp and z - z_comp (see KahanFinalize).
+ */
+template<typename ElemT>
+void FusedAxpyAccumulateKahan(const size_t n, const ElemT a, const ElemT b, const ElemT *x,
+                              ElemT *y, ElemT *y_comp, ElemT *z, ElemT *z_comp) {
+  for (size_t i = 0; i < n; i++) {
+    const ElemT xi = x[i];
+    const ElemT dy = a * xi - y_comp[i];
+    const ElemT ty = y[i] + dy;
+    y_comp[i] = (ty - y[i]) - dy;
+    y[i] = ty;
+
+    const ElemT dz = b * xi - z_comp[i];
+    const ElemT tz = z[i] + dz;
+    z_comp[i] = (tz - z[i]) - dz;
+    z[i] = tz;
+  }
+}
+
+///< y -= y_comp and clear y_comp, i.e. fold the compensation into the sum.
+template<typename ElemT>
+void KahanFinalize(const size_t n, ElemT *y, ElemT *y_comp) {
+  for (size_t i = 0; i < n; i++) {
+    y[i] -= y_comp[i];
+    y_comp[i] = ElemT(0);
+  }
+}
+
+}//qlpeps
+
+#endif //QLPEPS_UTILITY_FUSED_ACCUMULATION_H
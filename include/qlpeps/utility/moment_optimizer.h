@@ -0,0 +1,52 @@
+// SPDX-License-Identifier: LGPL-3.0-only
+
+/*
+* Author: Hao-Xin Wang<wanghaoxin1996@gmail.com>
+* Creation Date: 2024-10-16
+*
+* Description: QuantumLiquids/PEPS project. Element-wise kernels of the Adam-type optimizers.
+*/
+
+#ifndef QLPEPS_UTILITY_MOMENT_OPTIMIZER_H
+#define QLPEPS_UTILITY_MOMENT_OPTIMIZER_H
+
+#include <cstddef>   //size_t
+#include <cmath>     //sqrt
+#include <complex>   //norm
+
+namespace qlpeps {
+
+/**
+ * Update the moments of the gradient g in a single pass,
+ *        m = beta1 * m + (1 - beta1) * g,
+ *        v = beta2 * v + (1 - beta2) * |g|^2,
+ * and v_max = max(v_max, v) if v_max is not null (AMSGrad).
+ * v and v_max are real but stored in ElemT, so that they share the layout with the tensors.
+ */
+template<typename ElemT>
+void AdamMomentUpdate(const size_t n, const double beta1, const double beta2,
+                      const ElemT *g, ElemT *m, ElemT *v, ElemT *v_max) {
+  for (size_t i = 0; i < n; i++) {
+    m[i] = beta1 * m[i] + (1.0 - beta1) * g[i];
+    v[i] = beta2 * std::real(v[i]) + (1.0 - beta2) * std::norm(g[i]);
+    if (v_max != nullptr && std::real(v[i]) > std::real(v_max[i])) {
+      v_max[i] = v[i];
+    }
+  }
+}
+
+/**
+ * The update direction d = (m / bias1) / (sqrt(v / bias2) + epsilon),
+ * where bias1 = 1 - beta1^t and bias2 = 1 - beta2^t correct the zero initial moments.
+ */
+template<typename ElemT>
+void AdamDirection(const size_t n, const double bias1, const double bias2, const double epsilon,
+                   const ElemT *m, const ElemT *v, ElemT *d) {
+  for (size_t i = 0; i < n; i++) {
+    d[i] = (m[i] / bias1) / (std::sqrt(std::real(v[i]) / bias2) + epsilon);
+  }
+}
+
+}//qlpeps
+
+#endif //QLPEPS_UTILITY_MOMENT_OPTIMIZER_H
@@ -0,0 +1,68 @@
+// SPDX-License-Identifier: LGPL-3.0-only
+
+/*
+* Author: Hao-Xin Wang<wanghaoxin1996@gmail.com>
+* Creation Date: 2024-10-16
+*
+* Description: QuantumLiquids/PEPS project. Lossy float32 and bfloat16 encodings of double data for communication.
+*/
+
+#ifndef QLPEPS_UTILITY_REDUCED_PRECISION_H
+#define QLPEPS_UTILITY_REDUCED_PRECISION_H
+
+#include <cstddef>   //size_t
+#include <cstdint>   //uint16_t, uint32_t
+#include <cstring>   //memcpy
+
+namespace qlpeps {
+
+/**
+ * Round a float to the upper 16 bits (bfloat16: 8 exponent bits and 7 mantissa bits),
+ * rounding to the nearest and ties to even. NaN is kept as a quiet NaN.
+ */
+inline uint16_t FloatToBF16(const float x) {
+  uint32_t bits;
+  std::memcpy(&bits, &x, sizeof(bits));
+  if ((bits & 0x7fffffffu) > 0x7f800000u) { //NaN
+    return uint16_t((bits >> 16) | 0x0040u);
+  }
+  bits += 0x7fffu + ((bits >> 16) & 1u);
+  return uint16_t(bits >> 16);
+}
+
+inline float BF16ToFloat(const uint16_t x) {
+  const uint32_t bits = uint32_t(x) << 16;
+  float res;
+  std::memcpy(&res, &bits, sizeof(res));
+  return res;
+}
+
+///< y[i] = float(x[i]), i < n. For complex data, pass the real and imaginary parts as 2n doubles.
+inline void EncodeFloat(const double *x, const size_t n, float *y) {
+  for (size_t i = 0; i < n; i++) {
+    y[i] = float(x[i]);
+  }
+}
+
+inline void DecodeFloat(const float *y, const size_t n, double *x) {
+  for (size_t i = 0; i < n; i++) {
+    x[i] = double(y[i]);
+  }
+}
+
+///< y[i] = bfloat16(x[i]), i < n, with relative error up to 2^-8
+inline void EncodeBF16(const double *x, const size_t n, uint16_t *y) {
+  for (size_t i = 0; i < n; i++) {
+    y[i] = FloatToBF16(float(x[i]));
+  }
+}
+
+inline void DecodeBF16(const uint16_t *y, const size_t n, double *x) {
+  for (size_t i = 0; i < n; i++) {
+    x[i] = double(BF16ToFloat(y[i]));
+  }
+}
+
+}//qlpeps
+
+#endif //QLPEPS_UTILITY_REDUCED_PRECISION_H
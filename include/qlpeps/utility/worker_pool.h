@@ -0,0 +1,139 @@
+// SPDX-License-Identifier: LGPL-3.0-only
+
+/*
+* Author: Hao-Xin Wang<wanghaoxin1996@gmail.com>
+* Creation Date: 2024-10-16
+*
+* Description: QuantumLiquids/PEPS project. A small persistent pool of worker threads for fine-grained parallel loops.
+*/
+
+#ifndef QLPEPS_UTILITY_WORKER_POOL_H
+#define QLPEPS_UTILITY_WORKER_POOL_H
+
+#include <cstddef>              // size_t
+#include <vector>               // vector
+#include <thread>               // thread
+#include <mutex>                // mutex, unique_lock
+#include <condition_variable>   // condition_variable
+#include <functional>           // function
+#include <algorithm>            // min
+
+namespace qlpeps {
+
+/**
+ * Worker threads which are started once and then reused by every ParallelFor call, so that loops of a few
+ * tensor contractions, called once per Monte-Carlo proposal, do not pay the thread creation each time.
+ *
+ * The workers are started lazily by the first ParallelFor which needs them and joined by the destructor.
+ * Copies do not share or copy the threads: a copied pool is empty and starts its own workers when used.
+ * ParallelFor must not be called concurrently, or from inside a task, on the same pool.
+ */
+class WorkerPool {
+ public:
+  WorkerPool(void) = default;
+
+  WorkerPool(const WorkerPool &) : WorkerPool() {}
+
+  WorkerPool &operator=(const WorkerPool &) { return *this; }
+
+  ~WorkerPool() { Stop_(); }
+
+  size_t WorkerNum(void) const { return workers_.size(); }
+
+  /**
+   * Run task(0), ..., task(task_num - 1) striped over thread_num threads, the calling one included,
+   * and return once all of them have finished.
+   */
+  template<typename TaskT>
+  void ParallelFor(const size_t thread_num, const size_t task_num, const TaskT &task) {
+    const size_t stride = std::min(thread_num, task_num);
+    if (stride <= 1) {
+      for (size_t k = 0; k < task_num; k++) {
+        task(k);
+      }
+      return;
+    }
+    if (workers_.size() + 1 < stride) {
+      Stop_();
+      Start_(stride - 1);
+    }
+    const std::function<void(size_t)> task_func = [&task](const size_t k) { task(k); };
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      task_ = &task_func;
+      task_num_ = task_num;
+      stride_ = stride;
+      pending_ = stride - 1;
+      generation_++;
+    }
+    task_cv_.notify_all();
+    for (size_t k = 0; k < task_num; k += stride) {
+      task(k);
+    }
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_cv_.wait(lock, [this]() { return pending_ == 0; });
+    task_ = nullptr;
+  }
+
+ private:
+  void Start_(const size_t worker_num) {
+    stop_ = false;
+    const size_t generation = generation_;
+    workers_.reserve(worker_num);
+    for (size_t worker = 0; worker < worker_num; worker++) {
+      workers_.emplace_back([this, worker, generation]() { WorkerLoop_(worker + 1, generation); });
+    }
+  }
+
+  void Stop_(void) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    task_cv_.notify_all();
+    for (auto &worker : workers_) {
+      worker.join();
+    }
+    workers_.clear();
+  }
+
+  ///< thread_id 0 is the calling thread; worker i runs the tasks i, i + stride, ... if i < stride
+  void WorkerLoop_(const size_t thread_id, size_t seen_generation) {
+    while (true) {
+      std::unique_lock<std::mutex> lock(mutex_);
+      task_cv_.wait(lock, [this, seen_generation]() { return stop_ || generation_ != seen_generation; });
+      if (stop_) {
+        return;
+      }
+      seen_generation = generation_;
+      if (thread_id >= stride_) {
+        continue;
+      }
+      const std::function<void(size_t)> &task = *task_;
+      const size_t task_num = task_num_, stride = stride_;
+      lock.unlock();
+      for (size_t k = thread_id; k < task_num; k += stride) {
+        task(k);
+      }
+      lock.lock();
+      if (--pending_ == 0) {
+        done_cv_.notify_one();
+      }
+    }
+  }
+
+  std::vector<std::thread> workers_;
+  std::mutex mutex_;
+  std::condition_variable task_cv_;
+  std::condition_variable done_cv_;
+  const std::function<void(size_t)> *task_ = nullptr;
+  size_t task_num_ = 0;
+  size_t stride_ = 0;
+  size_t pending_ = 0;
+  size_t generation_ = 0;
+  bool stop_ = false;
+};
+
+}//qlpeps
+
+#endif //QLPEPS_UTILITY_WORKER_POOL_H
@@ -0,0 +1,104 @@
+// SPDX-License-Identifier: LGPL-3.0-only
+
+/*
+* Author: Hao-Xin Wang<wanghaoxin1996@gmail.com>
+* Creation Date: 2024-10-16
+*
+* Description: QuantumLiquids/PEPS project. Profile the Monte-Carlo sweeps with the NN bond traces split over threads.
+*
+* Usage: ./bond_trace_threads_profile [Ly Lx D Db threads sweeps]
+* The same Markov chain (same random stream) of the Heisenberg NN-exchange sampler is run with 1 and `threads`
+* bond-trace threads. Reported are the time per sweep and whether the two chains end in the same configuration,
+* which they do since only the evaluation of each proposal is parallel, not the acceptance.
+*/
+
+#include <iomanip>
+#include "qlten/qlten.h"
+#include "qlpeps/algorithm/vmc_update/vmc_peps.h"
+#include "qlpeps/algorithm/vmc_update/wave_function_component_classes/wave_function_component_all.h"
+
+using namespace qlten;
+using namespace qlpeps;
+
+using qlten::special_qn::U1QN;
+using IndexT = Index<U1QN>;
+using QNSctT = QNSector<U1QN>;
+using TenElemT = QLTEN_Double;
+using Tensor = QLTensor<TenElemT, U1QN>;
+using SITPST = SplitIndexTPS<TenElemT, U1QN>;
+using SampleT = SquareTPSSampleNNExchange<TenElemT, U1QN>;
+
+SITPST GenRandomSITPS(const size_t ly, const size_t lx, const size_t D, const size_t phy_dim) {
+  const U1QN qn0 = U1QN({QNCard("Sz", U1QNVal(0))});
+  const IndexT vb_out = IndexT({QNSctT(qn0, D)}, TenIndexDirType::OUT);
+  const IndexT vb_in = InverseIndex(vb_out);
+  SITPST sitps(ly, lx, phy_dim);
+  for (auto &tens : sitps) {
+    for (auto &ten : tens) {
+      ten = Tensor({vb_in, vb_out, vb_out, vb_in});
+      ten.Random(qn0);
+    }
+  }
+  return sitps;
+}
+
+struct SweepProfile {
+  double time_per_sweep;
+  double accept_rate;
+  Configuration config;
+};
+
+SweepProfile ProfileSweeps(const SITPST &sitps, const Configuration &init_config,
+                           const BMPSTruncatePara &trunc_para, const size_t threads, const size_t sweeps) {
+  SampleT::trun_para = trunc_para;
+  SampleT::sweep_trun_para = std::nullopt;
+  SampleT::bond_trace_threads = threads;
+  random_engine = PhiloxEngine(2024);
+  SampleT sample(sitps, init_config);
+  std::uniform_real_distribution<double> u_double(0, 1);
+  std::vector<double> accept_rates;
+  SweepProfile res{0, 0, init_config};
+  for (size_t i = 0; i < sweeps; i++) {
+    random_engine.NextSweep();
+    Timer sweep_timer("sweep");
+    sample.MonteCarloSweepUpdate(sitps, u_double, accept_rates);
+    res.time_per_sweep += sweep_timer.Elapsed();
+    res.accept_rate += accept_rates[0];
+  }
+  res.time_per_sweep /= double(sweeps);
+  res.accept_rate /= double(sweeps);
+  res.config = sample.config;
+  return res;
+}
+
+int main(int argc, char *argv[]) {
+  size_t ly = 16, lx = 16, D = 8, Db = 24, threads = 2, sweeps = 2;
+  if (argc == 7) {
+    ly = std::stoul(argv[1]);
+    lx = std::stoul(argv[2]);
+    D = std::stoul(argv[3]);
+    Db = std::stoul(argv[4]);
+    threads = std::stoul(argv[5]);
+    sweeps = std::stoul(argv[6]);
+  }
+  const SITPST sitps = GenRandomSITPS(ly, lx, D, 2);
+  Configuration init_config(ly, lx);
+  init_config.Random({ly * lx / 2, ly * lx - ly * lx / 2});
+  const BMPSTruncatePara trunc_para(Db, Db, 1e-15, CompressMPSScheme::SVD_COMPRESS,
+                                    std::make_optional<double>(1e-14), std::make_optional<size_t>(10));
+
+  std::cout << "Lattice " << ly << "x" << lx << ", D = " << D << ", Db = " << Db << ", "
+            << sweeps << " sweeps" << std::endl;
+  std::cout << std::setw(10) << "threads" << std::setw(16) << "T/sweep (s)" << std::setw(12) << "accept" << std::endl;
+  const SweepProfile serial = ProfileSweeps(sitps, init_config, trunc_para, 1, sweeps);
+  const SweepProfile parallel = ProfileSweeps(sitps, init_config, trunc_para, threads, sweeps);
+  for (auto [thread_num, profile] : {std::make_pair(size_t(1), serial), std::make_pair(threads, parallel)}) {
+    std::cout << std::setw(10) << thread_num
+              << std::setw(16) << std::scientific << std::setprecision(3) << profile.time_per_sweep
+              << std::setw(12) << std::fixed << std::setprecision(4) << profile.accept_rate << std::endl;
+  }
+  std::cout << "same chain : " << (serial.config == parallel.config ? "yes" : "no") << std::endl;
+  std::cout << "speedup : " << std::fixed << std::setprecision(2)
+            << serial.time_per_sweep / parallel.time_per_sweep << std::endl;
+  return 0;
+}
@@ -0,0 +1,105 @@
+// SPDX-License-Identifier: LGPL-3.0-only
+
+/*
+* Author: Hao-Xin Wang<wanghaoxin1996@gmail.com>
+* Creation Date: 2024-10-16
+*
+* Description: QuantumLiquids/PEPS project. Profile the reduction of the gradient (split index TPS) over processes.
+*
+* Usage: mpirun -np <N> ./mpi_reduce_split_index_tps_profile [Ly Lx D repeat]
+* The reduction time is reported for the communicators formed by the first 1, 2, 4, ..., N processes,
+* for both the per-tensor gathering on master (MPIMeanTensor) and the packed MPI_Reduce (MPIMeanSplitIndexTPS).
+*/
+
+#include <iomanip>
+#include "qlten/qlten.h"
+#include "qlpeps/algorithm/vmc_update/vmc_peps.h"
+
+using namespace qlten;
+using namespace qlpeps;
+
+using qlten::special_qn::U1QN;
+using IndexT = Index<U1QN>;
+using QNSctT = QNSector<U1QN>;
+using TenElemT = QLTEN_Double;
+using Tensor = QLTensor<TenElemT, U1QN>;
+using SITPST = SplitIndexTPS<TenElemT, U1QN>;
+
+SITPST GenRandomSITPS(const size_t ly, const size_t lx, const size_t D, const size_t phy_dim) {
+  const U1QN qn0 = U1QN({QNCard("Sz", U1QNVal(0))});
+  const IndexT vb_out = IndexT({QNSctT(qn0, D)}, TenIndexDirType::OUT);
+  const IndexT vb_in = InverseIndex(vb_out);
+  SITPST sitps(ly, lx, phy_dim);
+  for (auto &tens : sitps) {
+    for (auto &ten : tens) {
+      ten = Tensor({vb_in, vb_out, vb_out, vb_in});
+      ten.Random(qn0);
+    }
+  }
+  return sitps;
+}
+
+double ProfilePerTensorMean(SITPST grad, const MPI_Comm &comm, const size_t repeat) {
+  MPI_Barrier(comm);
+  Timer timer("per_tensor_mean");
+  for (size_t i = 0; i < repeat; i++) {
+    for (auto &tens : grad) {
+      for (auto &ten : tens) {
+        Tensor res = MPIMeanTensor(ten, comm);
+      }
+    }
+  }
+  MPI_Barrier(comm);
+  return timer.Elapsed() / double(repeat);
+}
+
+double ProfilePackedMean(SITPST grad, const MPI_Comm &comm, const size_t repeat) {
+  MPI_Barrier(comm);
+  Timer timer("packed_mean");
+  for (size_t i = 0; i < repeat; i++) {
+    MPIMeanSplitIndexTPS<TenElemT, U1QN>({&grad}, comm);
+  }
+  MPI_Barrier(comm);
+  return timer.Elapsed() / double(repeat);
+}
+
+int main(int argc, char *argv[]) {
+  MPI_Init(&argc, &argv);
+  int world_rank, world_size;
+  MPI_Comm_rank(MPI_COMM_WORLD, &world_rank);
+  MPI_Comm_size(MPI_COMM_WORLD, &world_size);
+  size_t ly = 8, lx = 8, D = 8, repeat = 5;
+  if (argc == 5) {
+    ly = std::stoul(argv[1]);
+    lx = std::stoul(argv[2]);
+    D = std::stoul(argv[3]);
+    repeat = std::stoul(argv[4]);
+  }
+  const SITPST grad = GenRandomSITPS(ly, lx, D, 2);
+  if (world_rank == kMPIMasterRank) {
+    std::cout << "Lattice " << ly << "x" << lx << ", D = " << D
+              << ", data size = " << SplitIndexTPSDataSize(grad) * sizeof(TenElemT) / 1024.0 / 1024.0 << " MB"
+              << std::endl;
+    std::cout << std::setw(10) << "ranks" << std::setw(20) << "per-tensor (s)"
+              << std::setw(20) << "packed (s)" << std::setw(12) << "speedup" << std::endl;
+  }
+  for (int procs = 1; procs <= world_size; procs *= 2) {
+    MPI_Comm sub_comm;
+    MPI_Comm_split(MPI_COMM_WORLD, world_rank < procs ? 0 : MPI_UNDEFINED, world_rank, &sub_comm);
+    if (sub_comm != MPI_COMM_NULL) {
+      double t_per_tensor = ProfilePerTensorMean(grad, sub_comm, repeat);
+      double t_packed = ProfilePackedMean(grad, sub_comm, repeat);
+      if (world_rank == kMPIMasterRank) {
+        std::cout << std::setw(10) << procs
+                  << std::setw(20) << std::scientific << std::setprecision(3) << t_per_tensor
+                  << std::setw(20) << t_packed
+                  << std::setw(12) << std::fixed << std::setprecision(2) << t_per_tensor / t_packed
+                  << std::endl;
+      }
+      MPI_Comm_free(&sub_comm);
+    }
+    MPI_Barrier(MPI_COMM_WORLD);
+  }
+  MPI_Finalize();
+  return 0;
+}
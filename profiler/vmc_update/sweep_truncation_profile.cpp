@@ -0,0 +1,121 @@
+// SPDX-License-Identifier: LGPL-3.0-only
+
+/*
+* Author: Hao-Xin Wang<wanghaoxin1996@gmail.com>
+* Creation Date: 2024-10-16
+*
+* Description: QuantumLiquids/PEPS project. Profile the Monte-Carlo sweeps with a reduced boundary-MPS truncation.
+*
+* Usage: ./sweep_truncation_profile [Ly Lx D Db Db_sweep sweeps]
+* The same Markov chain (same random stream) is run with the boundary-MPS bond dimension Db and Db_sweep.
+* Reported are the time per sweep, the acceptance rate, and the relative deviation of the sweep amplitudes
+* from the amplitudes contracted with Db, i.e. the bias the cheaper contraction brings into the acceptance.
+*/
+
+#include <iomanip>
+#include "qlten/qlten.h"
+#include "qlpeps/algorithm/vmc_update/vmc_peps.h"
+#include "qlpeps/algorithm/vmc_update/wave_function_component_classes/wave_function_component_all.h"
+
+using namespace qlten;
+using namespace qlpeps;
+
+using qlten::special_qn::U1QN;
+using IndexT = Index<U1QN>;
+using QNSctT = QNSector<U1QN>;
+using TenElemT = QLTEN_Double;
+using Tensor = QLTensor<TenElemT, U1QN>;
+using SITPST = SplitIndexTPS<TenElemT, U1QN>;
+using SampleT = SquareTPSSampleNNExchange<TenElemT, U1QN>;
+
+SITPST GenRandomSITPS(const size_t ly, const size_t lx, const size_t D, const size_t phy_dim) {
+  const U1QN qn0 = U1QN({QNCard("Sz", U1QNVal(0))});
+  const IndexT vb_out = IndexT({QNSctT(qn0, D)}, TenIndexDirType::OUT);
+  const IndexT vb_in = InverseIndex(vb_out);
+  SITPST sitps(ly, lx, phy_dim);
+  for (auto &tens : sitps) {
+    for (auto &ten : tens) {
+      ten = Tensor({vb_in, vb_out, vb_out, vb_in});
+      ten.Random(qn0);
+    }
+  }
+  return sitps;
+}
+
+TenElemT ExactAmplitude(const SITPST &sitps, const Configuration &config, const BMPSTruncatePara &trunc_para) {
+  TensorNetwork2D<TenElemT, U1QN> tn(sitps, config);
+  tn.GrowBMPSForRow(0, trunc_para);
+  tn.GrowFullBTen(qlpeps::RIGHT, 0, 2, true);
+  tn.InitBTen(qlpeps::LEFT, 0);
+  return tn.Trace({0, 0}, HORIZONTAL);
+}
+
+struct SweepProfile {
+  double time_per_sweep;
+  double accept_rate;
+  double mean_deviation;
+  double max_deviation;
+};
+
+SweepProfile ProfileSweeps(const SITPST &sitps, const Configuration &init_config,
+                           const BMPSTruncatePara &trunc_para,
+                           const std::optional<BMPSTruncatePara> &sweep_trunc_para,
+                           const size_t sweeps) {
+  SampleT::trun_para = trunc_para;
+  SampleT::sweep_trun_para = sweep_trunc_para;
+  random_engine = PhiloxEngine(2024);
+  SampleT sample(sitps, init_config);
+  std::uniform_real_distribution<double> u_double(0, 1);
+  std::vector<double> accept_rates;
+  SweepProfile res{0, 0, 0, 0};
+  for (size_t i = 0; i < sweeps; i++) {
+    random_engine.NextSweep();
+    Timer sweep_timer("sweep");
+    sample.MonteCarloSweepUpdate(sitps, u_double, accept_rates);
+    res.time_per_sweep += sweep_timer.Elapsed();
+    res.accept_rate += accept_rates[0];
+    const double psi = std::abs(ExactAmplitude(sitps, sample.config, trunc_para));
+    const double deviation = std::abs(std::abs(sample.amplitude) - psi) / psi;
+    res.mean_deviation += deviation;
+    res.max_deviation = std::max(res.max_deviation, deviation);
+  }
+  res.time_per_sweep /= double(sweeps);
+  res.accept_rate /= double(sweeps);
+  res.mean_deviation /= double(sweeps);
+  return res;
+}
+
+int main(int argc, char *argv[]) {
+  size_t ly = 8, lx = 8, D = 6, Db = 36, Db_sweep = 12, sweeps = 10;
+  if (argc == 7) {
+    ly = std::stoul(argv[1]);
+    lx = std::stoul(argv[2]);
+    D = std::stoul(argv[3]);
+    Db = std::stoul(argv[4]);
+    Db_sweep = std::stoul(argv[5]);
+    sweeps = std::stoul(argv[6]);
+  }
+  const SITPST sitps = GenRandomSITPS(ly, lx, D, 2);
+  Configuration init_config(ly, lx);
+  init_config.Random({ly * lx / 2, ly * lx - ly * lx / 2});
+  const BMPSTruncatePara trunc_para(Db, Db, 1e-15, CompressMPSScheme::SVD_COMPRESS,
+                                    std::make_optional<double>(1e-14), std::make_optional<size_t>(10));
+  BMPSTruncatePara sweep_trunc_para = trunc_para;
+  sweep_trunc_para.D_min = sweep_trunc_para.D_max = Db_sweep;
+
+  std::cout << "Lattice " << ly << "x" << lx << ", D = " << D << ", " << sweeps << " sweeps" << std::endl;
+  std::cout << std::setw(10) << "Db" << std::setw(16) << "T/sweep (s)" << std::setw(12) << "accept"
+            << std::setw(16) << "mean |dpsi|" << std::setw(16) << "max |dpsi|" << std::endl;
+  const SweepProfile full = ProfileSweeps(sitps, init_config, trunc_para, std::nullopt, sweeps);
+  const SweepProfile reduced = ProfileSweeps(sitps, init_config, trunc_para, sweep_trunc_para, sweeps);
+  for (auto [db, profile] : {std::make_pair(Db, full), std::make_pair(Db_sweep, reduced)}) {
+    std::cout << std::setw(10) << db
+              << std::setw(16) << std::scientific << std::setprecision(3) << profile.time_per_sweep
+              << std::setw(12) << std::fixed << std::setprecision(4) << profile.accept_rate
+              << std::setw(16) << std::scientific << std::setprecision(3) << profile.mean_deviation
+              << std::setw(16) << profile.max_deviation << std::endl;
+  }
+  std::cout << "speedup : " << std::fixed << std::setprecision(2)
+            << full.time_per_sweep / reduced.time_per_sweep << std::endl;
+  return 0;
+}
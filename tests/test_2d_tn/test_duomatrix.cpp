@@ -73,6 +73,41 @@ TEST(TestDuoMatrix, TestConstructors) {
   RunTestDuoMatrixConstructorsCase<double>(3, 2);
 }
 
+struct AllocCountedElem {
+  static size_t alloc_num;
+  AllocCountedElem(void) { alloc_num++; }
+  AllocCountedElem(const AllocCountedElem &rhs) : val(rhs.val) { alloc_num++; }
+  AllocCountedElem &operator=(const AllocCountedElem &rhs) = default;
+  int val = 0;
+};
+size_t AllocCountedElem::alloc_num = 0;
+
+TEST(TestDuoMatrix, TestCopyAssignReuseElems) {
+  DuoMatrix<AllocCountedElem> src(3, 2), dst(3, 2);
+  for (size_t i = 0; i < 3; ++i) {
+    for (size_t j = 0; j < 2; ++j) {
+      src({i, j}).val = int(i * 2 + j);
+    }
+  }
+  dst = src; // first assignment allocates the elements
+  auto craw_data = dst.cdata();
+  const size_t alloc_num = AllocCountedElem::alloc_num;
+  for (size_t sample = 0; sample < 10; ++sample) {
+    src({1, 1}).val = int(sample);
+    dst = src;
+    EXPECT_EQ(dst({1, 1}).val, int(sample));
+  }
+  EXPECT_EQ(AllocCountedElem::alloc_num, alloc_num); // no allocation in the steady state
+  EXPECT_EQ(dst.cdata(), craw_data);
+
+  src.dealloc(0, 0);
+  dst = src;
+  EXPECT_EQ(dst(0, 0), nullptr);
+  const DuoMatrix<AllocCountedElem> &dst_alias = dst;
+  dst = dst_alias; // self assignment
+  EXPECT_EQ(dst({2, 1}).val, 5);
+}
+
 TEST(TestDuoMatrix, TestElemAccess) {
   DuoMatrix<int> intduomat(1, 1);
   intduomat({0, 0}) = 3;
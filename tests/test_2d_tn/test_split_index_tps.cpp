@@ -10,6 +10,10 @@
 #include "gtest/gtest.h"
 #include "qlten/qlten.h"
 #include "qlpeps/two_dim_tn/tps/split_index_tps.h"
+#include "qlpeps/algorithm/vmc_update/stochastic_reconfiguration_smatrix.h"
+#include "qlpeps/algorithm/vmc_update/stochastic_reconfiguration_dense_smatrix.h"
+#include "qlpeps/algorithm/vmc_update/stochastic_reconfiguration_preconditioner.h"
+#include "qlpeps/utility/conjugate_gradient_solver.h"
 
 using namespace qlten;
 using namespace qlpeps;
@@ -101,3 +105,166 @@ TEST_F(SplitIdxTPSData, TestNormalization) {
   }
   EXPECT_DOUBLE_EQ(dsitps2.NormSquare(), (double) Lx * Ly);
 }
+
+TEST_F(SplitIdxTPSData, TestPackAndUnpackData) {
+  const size_t data_size = SplitIndexTPSDataSize(dsitps);
+  size_t expected_size = 0;
+  for (const std::vector<DTensor> &split_ten : dsitps) {
+    for (const DTensor &ten : split_ten) {
+      expected_size += ten.GetActualDataSize();
+    }
+  }
+  EXPECT_EQ(data_size, expected_size);
+
+  std::vector<QLTEN_Double> buffer(2 * data_size);
+  QLTEN_Double *pend = PackSplitIndexTPSData(dsitps, buffer.data());
+  EXPECT_EQ(pend, buffer.data() + data_size);
+  pend = PackSplitIndexTPSData(2.0 * dsitps, pend);
+  EXPECT_EQ(pend, buffer.data() + 2 * data_size);
+
+  DSITPS dsitps2 = 0.0 * dsitps, dsitps3 = 0.0 * dsitps;
+  const QLTEN_Double *pread = UnpackSplitIndexTPSData(buffer.data(), dsitps2);
+  pread = UnpackSplitIndexTPSData(pread, dsitps3);
+  EXPECT_EQ(pread, buffer.data() + 2 * data_size);
+  EXPECT_NEAR((dsitps2 - dsitps).NormSquare(), 0.0, 1e-26);
+  EXPECT_NEAR((dsitps3 - 2.0 * dsitps).NormSquare(), 0.0, 1e-26);
+}
+
+TEST_F(SplitIdxTPSData, TestShardedOperations) {
+  SplitIndexTPSShard shard;
+  shard.site_offsets = {0, 5, 11, N};
+  const DSITPS dsitps2 = 3.0 * dsitps;
+  double norm_square = 0.0, inner_product = 0.0;
+  size_t data_size = 0;
+  std::vector<QLTEN_Double> buffer(SplitIndexTPSDataSize(dsitps));
+  QLTEN_Double *pbuffer = buffer.data();
+  DSITPS axpby = dsitps;
+  for (int rank = 0; rank < 3; rank++) {
+    shard.rank = rank;
+    norm_square += CGSolverShardNormSquare(dsitps, shard);
+    inner_product += CGSolverShardInnerProduct(dsitps, dsitps2, shard);
+    data_size += SplitIndexTPSSitesDataSize(dsitps, shard.SiteBegin(), shard.SiteEnd());
+    pbuffer = PackSplitIndexTPSSitesData(dsitps, shard.SiteBegin(), shard.SiteEnd(), pbuffer);
+    CGSolverShardAxpby(2.0, dsitps, -1.0, axpby, shard);
+    if (rank == 0) {
+      // only the sites of the shard are updated
+      EXPECT_NEAR((axpby - dsitps).NormSquareOnSites(shard.SiteEnd(), N), 0.0, 1e-26);
+    }
+  }
+  EXPECT_NEAR(norm_square, dsitps.NormSquare(), 1e-12);
+  EXPECT_NEAR(inner_product, dsitps * dsitps2, 1e-12);
+  EXPECT_EQ(data_size, SplitIndexTPSDataSize(dsitps));
+  EXPECT_NEAR((axpby - dsitps).NormSquare(), 0.0, 1e-26);
+
+  DSITPS unpacked = 0.0 * dsitps;
+  const QLTEN_Double *pread = UnpackSplitIndexTPSSitesData(buffer.data(), 0, N, unpacked);
+  EXPECT_EQ(pread, buffer.data() + data_size);
+  EXPECT_NEAR((unpacked - dsitps).NormSquare(), 0.0, 1e-26);
+}
+
+TEST_F(SplitIdxTPSData, TestDenseSMatrix) {
+  const size_t sample_num = 7;
+  std::vector<DSITPS> gten_samples;
+  SRDenseSMatrix<QLTEN_Double, U1QN> dense_s_matrix(dsitps, false), float_s_matrix(dsitps, true);
+  DSITPS gten_sum = 0.0 * dsitps;
+  for (size_t i = 0; i < sample_num; i++) {
+    DSITPS gten_sample(Ly, Lx, 2);
+    for (size_t row = 0; row < Ly; row++) {
+      for (size_t col = 0; col < Lx; col++) {
+        const size_t basis = (i * row + col + i) % 2;
+        gten_sample({row, col})[basis] = double(i + row + 1) * dsitps({row, col})[basis];
+        gten_sum({row, col})[basis] += gten_sample({row, col})[basis];
+        dense_s_matrix.AddSampleTensor({row, col}, basis, gten_sample({row, col})[basis]);
+        float_s_matrix.AddSampleTensor({row, col}, basis, gten_sample({row, col})[basis]);
+      }
+    }
+    gten_samples.push_back(gten_sample);
+    dense_s_matrix.FinishSample();
+    float_s_matrix.FinishSample();
+  }
+  EXPECT_EQ(dense_s_matrix.SampleNum(), sample_num);
+  EXPECT_EQ(2 * float_s_matrix.SampleMemory(), dense_s_matrix.SampleMemory());
+
+  DSITPS gten_ave = gten_sum * (1.0 / sample_num);
+  SRSMatrix s_matrix(&gten_samples, &gten_ave, 1);
+  s_matrix.diag_shift = 0.1;
+  dense_s_matrix.SetAverageAndWorldSize(&gten_ave, 1);
+  dense_s_matrix.diag_shift = 0.1;
+  float_s_matrix.SetAverageAndWorldSize(&gten_ave, 1);
+  float_s_matrix.diag_shift = 0.1;
+
+  DSITPS v = dsitps;
+  v.NormalizeAllSite();
+  DSITPS res = s_matrix * v;
+  const double res_norm = res.NormSquare();
+  EXPECT_NEAR((dense_s_matrix * v - res).NormSquare() / res_norm, 0.0, 1e-24);
+  EXPECT_NEAR((float_s_matrix * v - res).NormSquare() / res_norm, 0.0, 1e-10);
+}
+
+TEST_F(SplitIdxTPSData, TestSRPreconditioners) {
+  const size_t sample_num = 7;
+  const double diag_shift = 0.1;
+  std::vector<DSITPS> gten_samples;
+  SRDenseSMatrix<QLTEN_Double, U1QN> dense_s_matrix(dsitps, false);
+  SRPreconditioner<QLTEN_Double, U1QN> jacobi(JacobiSRPreconditioner), site_block(SiteBlockSRPreconditioner),
+      dense_site_block(SiteBlockSRPreconditioner);
+  jacobi.Reset(dsitps);
+  site_block.Reset(dsitps);
+  dense_site_block.Reset(dsitps);
+  DSITPS gten_sum = 0.0 * dsitps;
+  for (size_t i = 0; i < sample_num; i++) {
+    DSITPS gten_sample(Ly, Lx, 2);
+    for (size_t row = 0; row < Ly; row++) {
+      for (size_t col = 0; col < Lx; col++) {
+        const size_t basis = (i * row + col + i) % 2;
+        gten_sample({row, col})[basis] = double(i + row + 1) * dsitps({row, col})[basis];
+        gten_sum({row, col})[basis] += gten_sample({row, col})[basis];
+        dense_s_matrix.AddSampleTensor({row, col}, basis, gten_sample({row, col})[basis]);
+      }
+    }
+    gten_samples.push_back(gten_sample);
+    jacobi.AddSample(gten_sample);
+    site_block.AddSample(gten_sample);
+    dense_s_matrix.FinishSample();
+  }
+  std::vector<QLTEN_Double> buffer;
+  for (size_t row = 0; row < Ly; row++) {
+    for (size_t col = 0; col < Lx; col++) {
+      for (size_t compt = 0; compt < 2; compt++) {
+        size_t row_num;
+        const QLTEN_Double *rows = dense_s_matrix.BlockRows({row, col}, compt, row_num, buffer);
+        dense_site_block.AddConjugateRows({row, col}, compt, rows, row_num);
+      }
+    }
+  }
+  dense_site_block.AddSampleNum(dense_s_matrix.SampleNum());
+
+  DSITPS gten_ave = gten_sum * (1.0 / sample_num);
+  SRSMatrix s_matrix(&gten_samples, &gten_ave, 1);
+  s_matrix.diag_shift = diag_shift;
+  jacobi.Build(gten_ave, diag_shift);
+  site_block.Build(gten_ave, diag_shift);
+  dense_site_block.Build(gten_ave, diag_shift);
+
+  // the site block preconditioner is the exact inverse of S restricted in a (site, component) block
+  DSITPS v = 0.0 * dsitps;
+  v({1, 2})[1] = dsitps({1, 2})[1];
+  DSITPS w = site_block(v);
+  EXPECT_NEAR((w - dense_site_block(v)).NormSquare() / w.NormSquare(), 0.0, 1e-24);
+  DSITPS s_w = s_matrix * w;
+  DSITPS s_w_block = 0.0 * dsitps;
+  s_w_block({1, 2})[1] = s_w({1, 2})[1];
+  EXPECT_NEAR((s_w_block - v).NormSquare() / v.NormSquare(), 0.0, 1e-20);
+
+  // preconditioned CG solutions agree with the plain CG solution of S x = b
+  DSITPS b = dsitps;
+  b.NormalizeAllSite();
+  DSITPS x0 = 0.0 * dsitps;
+  size_t iter_plain, iter_jacobi, iter_block;
+  DSITPS x = ConjugateGradientSolver(s_matrix, b, x0, 500, 1e-16, iter_plain);
+  DSITPS x_jacobi = PreconditionedConjugateGradientSolver(s_matrix, b, x0, jacobi, 500, 1e-16, iter_jacobi);
+  DSITPS x_block = PreconditionedConjugateGradientSolver(s_matrix, b, x0, site_block, 500, 1e-16, iter_block);
+  const double x_norm = x.NormSquare();
+  EXPECT_NEAR((x_jacobi - x).NormSquare() / x_norm, 0.0, 1e-12);
+  EXPECT_NEAR((x_block - x).NormSquare() / x_norm, 0.0, 1e-12);
+}
@@ -372,6 +372,44 @@ std::vector<TenElemT> Contract2DTNFromDifferentPositionAndMethods(
   return amplitudes;
 }
 
+/**
+ * Compare ReplaceNNSiteTraceBatch with ReplaceNNSiteTrace on a horizontal and a vertical bond,
+ * with the rescaled site tensors as the candidates.
+ */
+template<typename TenElemT, typename QNT>
+void CheckReplaceNNSiteTraceBatch(TensorNetwork2D<TenElemT, QNT> tn2d, BMPSTruncatePara trunc_para) {
+  using Tensor = QLTensor<TenElemT, QNT>;
+  const std::vector<double> scales_a = {1.0, 2.0}, scales_b = {1.0, -0.5, 3.0};
+  auto check_bond = [&](const SiteIdx &site_a, const SiteIdx &site_b, const BondOrientation bond_dir) {
+    std::vector<Tensor> cand_a, cand_b;
+    for (double scale : scales_a) { cand_a.push_back(scale * tn2d(site_a)); }
+    for (double scale : scales_b) { cand_b.push_back(scale * tn2d(site_b)); }
+    std::vector<const Tensor *> tens_a, tens_b;
+    for (const Tensor &ten : cand_a) { tens_a.push_back(&ten); }
+    for (const Tensor &ten : cand_b) { tens_b.push_back(&ten); }
+    auto psi_batch = tn2d.ReplaceNNSiteTraceBatch(site_a, site_b, bond_dir, tens_a, tens_b);
+    ASSERT_EQ(psi_batch.size(), cand_a.size() * cand_b.size());
+    const TenElemT psi0 = tn2d.Trace(site_a, site_b, bond_dir);
+    for (size_t i = 0; i < cand_a.size(); i++) {
+      for (size_t j = 0; j < cand_b.size(); j++) {
+        const TenElemT psi = tn2d.ReplaceNNSiteTrace(site_a, site_b, bond_dir, cand_a[i], cand_b[j]);
+        EXPECT_NEAR(std::abs(psi_batch[i * cand_b.size() + j] - psi) / std::abs(psi), 0.0, 1e-12);
+        EXPECT_NEAR(std::abs(psi_batch[i * cand_b.size() + j] - scales_a[i] * scales_b[j] * psi0) / std::abs(psi0),
+                    0.0, 1e-10);
+      }
+    }
+  };
+  tn2d.GrowBMPSForRow(2, trunc_para);
+  tn2d.InitBTen(BTenPOSITION::LEFT, 2);
+  tn2d.GrowFullBTen(BTenPOSITION::RIGHT, 2, 2, true);
+  check_bond({2, 0}, {2, 1}, HORIZONTAL);
+
+  tn2d.GrowBMPSForCol(1, trunc_para);
+  tn2d.InitBTen(BTenPOSITION::DOWN, 1);
+  tn2d.GrowFullBTen(BTenPOSITION::UP, 1, 2, true);
+  check_bond({tn2d.rows() - 2, 1}, {tn2d.rows() - 1, 1}, VERTICAL);
+}
+
 TEST_F(OBCIsing2DTenNetWithoutZ2, TestIsingTenNetRealNumberContraction) {
   BMPSTruncatePara trunc_para = BMPSTruncatePara(10, 30, 1e-15, CompressMPSScheme::VARIATION2Site,
                                                  std::make_optional<double>(1e-14),
@@ -751,6 +789,19 @@ TEST_F(ProjectedtJTensorNetwork, TestTrace) {
   }
 }
 
+TEST_F(ProjectedtJTensorNetwork, TestReplaceNNSiteTraceBatch) {
+  BMPSTruncatePara trunc_para = BMPSTruncatePara(Db_min, Db_max, 1e-15,
+                                                 CompressMPSScheme::SVD_COMPRESS,
+                                                 std::make_optional<double>(1e-14),
+                                                 std::make_optional<size_t>(10));
+  CheckReplaceNNSiteTraceBatch(dtn2d, trunc_para);
+  CheckReplaceNNSiteTraceBatch(ztn2d, trunc_para);
+  dtn2d.SetBondTraceThreads(3);
+  ztn2d.SetBondTraceThreads(3);
+  CheckReplaceNNSiteTraceBatch(dtn2d, trunc_para);
+  CheckReplaceNNSiteTraceBatch(ztn2d, trunc_para);
+}
+
 /**
  * @note Tests based on this class should be run after simple update.
  */
@@ -779,6 +830,7 @@ struct ProjectedSpinTenNet : public testing::Test {
   Configuration config = Configuration(Ly, Lx);
 
   TensorNetwork2D<QLTEN_Double, U1QN> tn2d = TensorNetwork2D<QLTEN_Double, U1QN>(Ly, Lx);
+  SplitIndexTPS<QLTEN_Double, U1QN> split_index_tps = SplitIndexTPS<QLTEN_Double, U1QN>(Ly, Lx);
 
   BMPSTruncatePara trunc_para = BMPSTruncatePara(4, 8, 1e-12, CompressMPSScheme::VARIATION2Site,
                                                  std::make_optional<double>(1e-14),
@@ -788,7 +840,7 @@ struct ProjectedSpinTenNet : public testing::Test {
     TPS<QLTEN_Double, U1QN> tps(Ly, Lx);
     tps.Load("tps_heisenberg_D4");
 
-    SplitIndexTPS<QLTEN_Double, U1QN> split_index_tps(tps);
+    split_index_tps = SplitIndexTPS<QLTEN_Double, U1QN>(tps);
     for (size_t i = 0; i < Lx; i++) { //col index
       for (size_t j = 0; j < Ly; j++) { //row index
         config({j, i}) = (i + j) % 2;
@@ -805,6 +857,106 @@ TEST_F(ProjectedSpinTenNet, HeisenbergD4WaveFunctionComponnet) {
   }
 }
 
+TEST_F(ProjectedSpinTenNet, HeisenbergD4ReplaceNNSiteTraceBatch) {
+  CheckReplaceNNSiteTraceBatch(tn2d, trunc_para);
+}
+
+TEST_F(ProjectedSpinTenNet, HeisenbergD4BondTraceThreads) {
+  tn2d.GrowBMPSForRow(1, trunc_para);
+  tn2d.InitBTen(BTenPOSITION::LEFT, 1);
+  tn2d.GrowFullBTen(BTenPOSITION::RIGHT, 1, 2, true);
+  TensorNetwork2D<QLTEN_Double, U1QN> tn2d_threads(Ly, Lx);
+  tn2d_threads = tn2d;
+  tn2d_threads.SetBondTraceThreads(2);
+  for (size_t col = 0; col < Lx - 1; col++) {
+    const SiteIdx site1 = {1, col}, site2 = {1, col + 1};
+    const double psi = tn2d.Trace(site1, site2, HORIZONTAL);
+    EXPECT_NEAR(tn2d_threads.Trace(site1, site2, HORIZONTAL), psi, 1e-13 * std::abs(psi));
+    const double psi_ex = tn2d.ReplaceNNSiteTrace(site1, site2, HORIZONTAL,
+                                                  split_index_tps(site1)[config(site2)],
+                                                  split_index_tps(site2)[config(site1)]);
+    EXPECT_NEAR(tn2d_threads.ReplaceNNSiteTrace(site1, site2, HORIZONTAL,
+                                                split_index_tps(site1)[config(site2)],
+                                                split_index_tps(site2)[config(site1)]),
+                psi_ex, 1e-13 * std::abs(psi_ex));
+    if (col < Lx - 2) {
+      tn2d.BTenMoveStep(BTenPOSITION::RIGHT);
+      tn2d_threads.BTenMoveStep(BTenPOSITION::RIGHT);
+    }
+  }
+}
+
+TEST_F(ProjectedSpinTenNet, HeisenbergD4OpenSiteCache) {
+  tn2d.EnableOpenSiteCache();
+  tn2d.GrowBMPSForRow(1, trunc_para);
+  tn2d.InitBTen(BTenPOSITION::LEFT, 1);
+  tn2d.GrowFullBTen(BTenPOSITION::RIGHT, 1, 2, true);
+  const SiteIdx site1 = {1, 0}, site2 = {1, 1};
+  const size_t config1 = config(site1), config2 = config(site2);
+
+  const double psi = tn2d.Trace(site1, site2, HORIZONTAL);
+  EXPECT_EQ(tn2d.OpenSiteCacheMisses(), 2);
+  EXPECT_NEAR(tn2d.Trace(site1, site2, HORIZONTAL), psi, 1e-15 * std::abs(psi));
+  EXPECT_EQ(tn2d.OpenSiteCacheHits(), 2);
+
+  const double psi_ex = tn2d.ReplaceNNSiteTrace(site1, site2, HORIZONTAL,
+                                                split_index_tps(site1)[config2], split_index_tps(site2)[config1]);
+  for (size_t i = 0; i < 2; i++) {
+    EXPECT_NEAR(tn2d.ReplaceNNSiteTrace(site1, site2, HORIZONTAL,
+                                        split_index_tps(site1), config2, split_index_tps(site2), config1),
+                psi_ex, 1e-13 * std::abs(psi_ex));
+  }
+  EXPECT_EQ(tn2d.OpenSiteCacheHits(), 4);
+  EXPECT_EQ(tn2d.OpenSiteCacheMisses(), 4);
+  EXPECT_NEAR(tn2d.OpenSiteCacheHitRate(), 0.5, 1e-15);
+  // Trace and the configuration overload share the keys
+  EXPECT_NEAR(tn2d.ReplaceNNSiteTrace(site1, site2, HORIZONTAL,
+                                      split_index_tps(site1), config1, split_index_tps(site2), config2),
+              psi, 1e-15 * std::abs(psi));
+  EXPECT_EQ(tn2d.OpenSiteCacheHits(), 6);
+  EXPECT_EQ(tn2d.OpenSiteCacheMisses(), 4);
+
+  // moving the boundary tensors invalidates the cache
+  tn2d.BTenMoveStep(BTenPOSITION::RIGHT);
+  tn2d.ResetOpenSiteCacheCounters();
+  tn2d.Trace({1, 1}, {1, 2}, HORIZONTAL);
+  EXPECT_EQ(tn2d.OpenSiteCacheHits(), 0);
+  EXPECT_EQ(tn2d.OpenSiteCacheMisses(), 2);
+  // so does changing a site tensor
+  tn2d.UpdateSiteConfig({1, 2}, config({1, 2}), split_index_tps, false);
+  tn2d.Trace({1, 1}, {1, 2}, HORIZONTAL);
+  EXPECT_EQ(tn2d.OpenSiteCacheMisses(), 4);
+}
+
+TEST_F(ProjectedSpinTenNet, HeisenbergD4ColPassReuseLeftBMPS) {
+  EXPECT_EQ(tn2d.GenerateBMPSForColPass(trunc_para, true), qlpeps::RIGHT);
+  tn2d.GrowFullBMPS(qlpeps::LEFT, trunc_para);
+  EXPECT_EQ(tn2d.GetBMPS(qlpeps::LEFT).size(), Lx);
+  tn2d.UpdateSiteConfig({2, 1}, config({2, 1}), split_index_tps, true);
+  // the left boundary MPS containing the changed site were erased
+  EXPECT_EQ(tn2d.GetBMPS(qlpeps::LEFT).size(), 2);
+  EXPECT_EQ(tn2d.GenerateBMPSForColPass(trunc_para, true), qlpeps::RIGHT);
+
+  tn2d.GrowFullBMPS(qlpeps::LEFT, trunc_para);
+  const BMPSPOSITION col_move = tn2d.GenerateBMPSForColPass(trunc_para, true);
+  EXPECT_EQ(col_move, qlpeps::LEFT);
+  std::vector<double> psi_reuse;
+  for (size_t i = 0; i < Lx; i++) {
+    const size_t col = tn2d.ColPassCol(col_move, i);
+    EXPECT_EQ(col, Lx - 1 - i);
+    tn2d.InitBTen(BTenPOSITION::UP, col);
+    tn2d.GrowFullBTen(BTenPOSITION::DOWN, col, 2, true);
+    psi_reuse.push_back(tn2d.Trace({0, col}, VERTICAL));
+    if (i < Lx - 1) {
+      tn2d.BMPSMoveStep(col_move, trunc_para);
+    }
+  }
+  const double psi = psi_reuse.front();
+  for (double psi_col : psi_reuse) {
+    EXPECT_NEAR(psi_col / psi, 1, 1e-10);
+  }
+}
+
 struct ExtremelyProjectedSpinTenNet : public testing::Test {
   using IndexT = Index<U1QN>;
   using QNSctT = QNSector<U1QN>;
@@ -10,6 +10,7 @@
 
 //#define PLAIN_TRANSPOSE 1
 
+#include <map>
 #include "gtest/gtest.h"
 #include "qlten/qlten.h"
 #include "qlpeps/algorithm/vmc_update/vmc_peps.h"
@@ -31,6 +32,7 @@ using Tensor = QLTensor<TenElemT, U1QN>;
 using TPSSampleNNFlipT = SquareTPSSampleNNExchange<TenElemT, U1QN>;
 using SquareTPSSample3SiteExchangeT = SquareTPSSample3SiteExchange<TenElemT, U1QN>;
 using SquareTPSSampleFullSpaceNNFlipT = SquareTPSSampleFullSpaceNNFlip<TenElemT, U1QN>;
+using SquareTPSSampleLongRangeExchangeT = SquareTPSSampleLongRangeExchange<TenElemT, U1QN>;
 
 using qlmps::CaseParamsParserBasic;
 
@@ -187,6 +189,218 @@ TEST_F(SpinSystemVMCPEPS, SquareHeisenbergD4StochasticReconfigration) {
   delete executor;
 }
 
+TEST_F(SpinSystemVMCPEPS, SquareHeisenbergD4StochasticReconfigrationMultiChains) {
+  using Model = SpinOneHalfHeisenbergSquare<TenElemT, U1QN>;
+  optimize_para.wavefunction_path = "vmc_tps_heisenbergD" + std::to_string(params.D);
+  optimize_para.cg_params = ConjugateGradientParams(100, 1e-4, 20, 0.01);
+  optimize_para.update_scheme = StochasticReconfiguration;
+  optimize_para.mc_chains = 2;
+  VMCPEPSExecutor<TenElemT, U1QN, TPSSampleNNFlipT, Model> *executor(nullptr);
+
+  TPS<TenElemT, U1QN> tps = TPS<TenElemT, U1QN>(Ly, Lx);
+  if (!tps.Load("tps_heisenberg_D" + std::to_string(params.D))) {
+    std::cout << "Loading simple updated TPS files is broken." << std::endl;
+    exit(-2);
+  };
+  executor = new VMCPEPSExecutor<TenElemT, U1QN, TPSSampleNNFlipT, Model>(optimize_para, tps,
+                                                                          comm);
+  executor->Execute();
+  delete executor;
+}
+
+TEST_F(SpinSystemVMCPEPS, SquareHeisenbergD4StochasticReconfigrationLongRangeExchange) {
+  using Model = SpinOneHalfHeisenbergSquare<TenElemT, U1QN>;
+  optimize_para.wavefunction_path = "vmc_tps_heisenbergD" + std::to_string(params.D);
+  optimize_para.cg_params = ConjugateGradientParams(100, 1e-4, 20, 0.01);
+  optimize_para.update_scheme = StochasticReconfiguration;
+  VMCPEPSExecutor<TenElemT, U1QN, SquareTPSSampleLongRangeExchangeT, Model> *executor(nullptr);
+
+  TPS<TenElemT, U1QN> tps = TPS<TenElemT, U1QN>(Ly, Lx);
+  if (!tps.Load("tps_heisenberg_D" + std::to_string(params.D))) {
+    std::cout << "Loading simple updated TPS files is broken." << std::endl;
+    exit(-2);
+  };
+  executor = new VMCPEPSExecutor<TenElemT, U1QN, SquareTPSSampleLongRangeExchangeT, Model>(optimize_para, tps,
+                                                                                           comm);
+  executor->Execute();
+  delete executor;
+}
+
+// The sampled frequencies of the configurations against |psi|^2 by the exact enumeration, on a 3x3 lattice
+// which still has the row/column exchanges at distance 2 and the diagonal exchanges.
+TEST_F(SpinSystemVMCPEPS, LongRangeExchangeDetailedBalance) {
+  const size_t ly = 3, lx = 3, D = 2;
+  const IndexT vb_out = IndexT({QNSctT(qn0, D)}, TenIndexDirType::OUT);
+  const IndexT vb_in = InverseIndex(vb_out);
+  const IndexT trivial_out = IndexT({QNSctT(qn0, 1)}, TenIndexDirType::OUT);
+  const IndexT trivial_in = InverseIndex(trivial_out);
+  const IndexT phy_out = IndexT({QNSctT(qn0, 2)}, TenIndexDirType::OUT);
+  TPS<TenElemT, U1QN> tps(ly, lx);
+  for (size_t row = 0; row < ly; row++) {
+    for (size_t col = 0; col < lx; col++) {
+      tps({row, col}) = Tensor({col == 0 ? trivial_in : vb_in, row == ly - 1 ? trivial_out : vb_out,
+                                col == lx - 1 ? trivial_out : vb_out, row == 0 ? trivial_in : vb_in, phy_out});
+      tps({row, col}).Random(qn0);
+    }
+  }
+  const SplitIndexTPS<TenElemT, U1QN> sitps(tps);
+  SquareTPSSampleLongRangeExchangeT::trun_para = BMPSTruncatePara(8, 8, 1e-15, CompressMPSScheme::VARIATION2Site,
+                                                                  std::make_optional<double>(1e-14),
+                                                                  std::make_optional<size_t>(10));
+  SquareTPSSampleLongRangeExchangeT::sweep_trun_para = std::nullopt;
+  SquareTPSSampleLongRangeExchangeT::bond_trace_threads = 1;
+
+  auto config_mask = [ly, lx](const Configuration &config) {
+    size_t mask = 0;
+    for (size_t site = 0; site < ly * lx; site++) {
+      mask |= config({site / lx, site % lx}) << site;
+    }
+    return mask;
+  };
+  random_engine = PhiloxEngine(2024);
+  Configuration init_config(ly, lx);
+  init_config.Random(std::vector<size_t>{5, 4});
+  const size_t up_num = __builtin_popcountl(config_mask(init_config));
+
+  // |psi|^2 of all the configurations with the same magnetization
+  std::map<size_t, double> weights;
+  double weight_sum = 0;
+  for (size_t mask = 0; mask < (size_t(1) << (ly * lx)); mask++) {
+    if (size_t(__builtin_popcountl(mask)) != up_num) {
+      continue;
+    }
+    Configuration config(ly, lx);
+    for (size_t site = 0; site < ly * lx; site++) {
+      config({site / lx, site % lx}) = (mask >> site) & 1;
+    }
+    const double weight = std::pow(std::abs(SquareTPSSampleLongRangeExchangeT(sitps, config).amplitude), 2);
+    weights[mask] = weight;
+    weight_sum += weight;
+  }
+
+  SquareTPSSampleLongRangeExchangeT sample(sitps, init_config);
+  std::uniform_real_distribution<double> u_double(0, 1);
+  std::vector<double> accept_rates, accept_rate_sums(3, 0.0);
+  std::map<size_t, size_t> counts;
+  const size_t warm_up_sweeps = 100, sweeps = 20000;
+  for (size_t i = 0; i < warm_up_sweeps + sweeps; i++) {
+    random_engine.NextSweep();
+    sample.MonteCarloSweepUpdate(sitps, u_double, accept_rates);
+    if (i < warm_up_sweeps) {
+      continue;
+    }
+    counts[config_mask(sample.config)]++;
+    for (size_t k = 0; k < accept_rates.size(); k++) {
+      accept_rate_sums[k] += accept_rates[k];
+    }
+  }
+  // the NNN and the long-range moves are really made
+  EXPECT_GT(accept_rate_sums[1], 0.0);
+  EXPECT_GT(accept_rate_sums[2], 0.0);
+
+  for (auto &[mask, count] : counts) {
+    EXPECT_EQ(weights.count(mask), 1); // no configuration out of the magnetization sector
+  }
+  double total_variation = 0;
+  for (auto &[mask, weight] : weights) {
+    const size_t count = counts.count(mask) ? counts.at(mask) : 0;
+    total_variation += std::abs(double(count) / double(sweeps) - weight / weight_sum);
+  }
+  EXPECT_LT(total_variation / 2, 0.05);
+  const TenElemT psi = SquareTPSSampleLongRangeExchangeT(sitps, sample.config).amplitude;
+  EXPECT_NEAR(std::abs(sample.amplitude - psi), 0.0, 1e-10 * std::abs(psi));
+}
+
+TEST_F(SpinSystemVMCPEPS, SquareHeisenbergD4StochasticReconfigrationSharded) {
+  using Model = SpinOneHalfHeisenbergSquare<TenElemT, U1QN>;
+  optimize_para.wavefunction_path = "vmc_tps_heisenbergD" + std::to_string(params.D);
+  optimize_para.cg_params = ConjugateGradientParams(100, 1e-4, 20, 0.01);
+  optimize_para.update_scheme = StochasticReconfiguration;
+  optimize_para.shard_tps_update = true;
+  VMCPEPSExecutor<TenElemT, U1QN, TPSSampleNNFlipT, Model> *executor(nullptr);
+
+  TPS<TenElemT, U1QN> tps = TPS<TenElemT, U1QN>(Ly, Lx);
+  if (!tps.Load("tps_heisenberg_D" + std::to_string(params.D))) {
+    std::cout << "Loading simple updated TPS files is broken." << std::endl;
+    exit(-2);
+  };
+  executor = new VMCPEPSExecutor<TenElemT, U1QN, TPSSampleNNFlipT, Model>(optimize_para, tps,
+                                                                          comm);
+  executor->Execute();
+  delete executor;
+}
+
+TEST_F(SpinSystemVMCPEPS, SquareHeisenbergD4StochasticReconfigrationDeltaBroadcast) {
+  using Model = SpinOneHalfHeisenbergSquare<TenElemT, U1QN>;
+  optimize_para.wavefunction_path = "vmc_tps_heisenbergD" + std::to_string(params.D);
+  optimize_para.cg_params = ConjugateGradientParams(100, 1e-4, 20, 0.01);
+  optimize_para.update_scheme = StochasticReconfiguration;
+  // compare the energies and the printed broadcast bytes with the other schemes
+  for (auto scheme : {PackedTPSBroadcast, DeltaFloatTPSBroadcast, DeltaBF16TPSBroadcast}) {
+    optimize_para.tps_broadcast_scheme = scheme;
+    TPS<TenElemT, U1QN> tps = TPS<TenElemT, U1QN>(Ly, Lx);
+    if (!tps.Load("tps_heisenberg_D" + std::to_string(params.D))) {
+      std::cout << "Loading simple updated TPS files is broken." << std::endl;
+      exit(-2);
+    };
+    auto executor = new VMCPEPSExecutor<TenElemT, U1QN, TPSSampleNNFlipT, Model>(optimize_para, tps,
+                                                                                  comm);
+    executor->Execute();
+    delete executor;
+  }
+}
+
+TEST_F(SpinSystemVMCPEPS, SquareHeisenbergD4StochasticReconfigrationCheckpoint) {
+  using Model = SpinOneHalfHeisenbergSquare<TenElemT, U1QN>;
+  using ExecutorT = VMCPEPSExecutor<TenElemT, U1QN, TPSSampleNNFlipT, Model>;
+  optimize_para.wavefunction_path = "vmc_tps_heisenbergD" + std::to_string(params.D);
+  optimize_para.cg_params = ConjugateGradientParams(100, 1e-4, 20, 0.01);
+  optimize_para.update_scheme = StochasticReconfiguration;
+  const size_t iter_num = optimize_para.step_lens.size();
+  ASSERT_GE(iter_num, 2);
+  // with several chains, the samples must also be gathered in a reproducible order
+  for (size_t mc_chains : {1, 2}) {
+    optimize_para.mc_chains = mc_chains;
+    const std::string checkpoint_path = "vmc_checkpoint_heisenbergD" + std::to_string(params.D)
+        + "_chains" + std::to_string(mc_chains);
+    // only one checkpoint, in the middle of the optimization
+    optimize_para.checkpoint = CheckpointPara(iter_num / 2, checkpoint_path);
+
+    TPS<TenElemT, U1QN> tps = TPS<TenElemT, U1QN>(Ly, Lx);
+    if (!tps.Load("tps_heisenberg_D" + std::to_string(params.D))) {
+      std::cout << "Loading simple updated TPS files is broken." << std::endl;
+      exit(-2);
+    };
+    auto executor = new ExecutorT(optimize_para, tps, comm);
+    executor->Execute();
+    const std::vector<TenElemT> energy_traj = executor->GetEnergyTrajectory();
+    const SplitIndexTPS<TenElemT, U1QN> final_state = executor->GetState();
+    delete executor;
+
+    // an interruption right after the checkpoint: the resumed run repeats the last iterations bit-exactly
+    executor = new ExecutorT(optimize_para, Ly, Lx, checkpoint_path, comm);
+    executor->Execute();
+    if (rank == 0) {
+      const std::vector<TenElemT> &energy_traj_resumed = executor->GetEnergyTrajectory();
+      ASSERT_EQ(energy_traj_resumed.size(), energy_traj.size());
+      for (size_t iter = 0; iter < energy_traj.size(); iter++) {
+        EXPECT_EQ(energy_traj_resumed[iter], energy_traj[iter]) << "mc_chains = " << mc_chains;
+      }
+    }
+    const SplitIndexTPS<TenElemT, U1QN> &final_state_resumed = executor->GetState();
+    for (size_t row = 0; row < Ly; row++) {
+      for (size_t col = 0; col < Lx; col++) {
+        for (size_t i = 0; i < final_state.PhysicalDim(); i++) {
+          const Tensor &ten = final_state({row, col})[i];
+          const Tensor &ten_resumed = final_state_resumed({row, col})[i];
+          EXPECT_EQ(ten_resumed, ten) << "mc_chains = " << mc_chains;
+        }
+      }
+    }
+    delete executor;
+  }
+}
+
 TEST_F(SpinSystemVMCPEPS, HeisenbergD4GradientLineSearch) {
   using Model = SpinOneHalfHeisenbergSquare<TenElemT, U1QN>;
   optimize_para.wavefunction_path = "vmc_tps_heisenbergD" + std::to_string(params.D);
@@ -211,6 +425,42 @@ TEST_F(SpinSystemVMCPEPS, HeisenbergD4GradientLineSearch) {
   delete executor;
 }
 
+TEST_F(SpinSystemVMCPEPS, HeisenbergD4GradientParallelLineSearch) {
+  using Model = SpinOneHalfHeisenbergSquare<TenElemT, U1QN>;
+  optimize_para.wavefunction_path = "vmc_tps_heisenbergD" + std::to_string(params.D);
+  optimize_para.update_scheme = GradientLineSearch;
+  optimize_para.parallel_line_search = true;
+  VMCPEPSExecutor<TenElemT, U1QN, TPSSampleNNFlipT, Model> *executor(nullptr);
+
+  TPS<TenElemT, U1QN> tps = TPS<TenElemT, U1QN>(Ly, Lx);
+  if (!tps.Load("tps_heisenberg_D" + std::to_string(params.D))) {
+    std::cout << "Loading simple updated TPS files is broken." << std::endl;
+    exit(-2);
+  };
+  executor = new VMCPEPSExecutor<TenElemT, U1QN, TPSSampleNNFlipT, Model>(optimize_para, tps,
+                                                                          comm);
+  executor->Execute();
+  delete executor;
+}
+
+TEST_F(SpinSystemVMCPEPS, SquareHeisenbergD4Adam) {
+  using Model = SpinOneHalfHeisenbergSquare<TenElemT, U1QN>;
+  optimize_para.wavefunction_path = "vmc_tps_heisenbergD" + std::to_string(params.D);
+  optimize_para.update_scheme = Adam;
+  optimize_para.moment_para = MomentOptimizerPara(0.9, 0.999, 1e-8);
+  VMCPEPSExecutor<TenElemT, U1QN, TPSSampleNNFlipT, Model> *executor(nullptr);
+
+  TPS<TenElemT, U1QN> tps = TPS<TenElemT, U1QN>(Ly, Lx);
+  if (!tps.Load("tps_heisenberg_D" + std::to_string(params.D))) {
+    std::cout << "Loading simple updated TPS files is broken." << std::endl;
+    exit(-2);
+  };
+  executor = new VMCPEPSExecutor<TenElemT, U1QN, TPSSampleNNFlipT, Model>(optimize_para, tps,
+                                                                          comm);
+  executor->Execute();
+  delete executor;
+}
+
 TEST_F(SpinSystemVMCPEPS, SquareHeisenbergD4NaturalGradientLineSearch) {
   using Model = SpinOneHalfHeisenbergSquare<TenElemT, U1QN>;
   VMCPEPSExecutor<TenElemT, U1QN, TPSSampleNNFlipT, Model> *executor(nullptr);
@@ -259,6 +509,26 @@ TEST_F(SpinSystemVMCPEPS, SquareJ1J2D4) {
   delete executor;
 }
 
+TEST_F(SpinSystemVMCPEPS, SquareJ1J2D4SweepTruncation) {
+  using Model = SpinOneHalfJ1J2HeisenbergSquare<TenElemT, U1QN>;
+  optimize_para.wavefunction_path = "vmc_tps_heisenbergD" + std::to_string(params.D);
+  // the sweeps contract with half of the BMPS bond dimension (not below Db_min), compare with SquareJ1J2D4
+  BMPSTruncatePara sweep_trunc_para = optimize_para.bmps_trunc_para;
+  sweep_trunc_para.D_max = std::max<size_t>(params.Db_max / 2, params.Db_min);
+  optimize_para.sweep_truncation = SweepTruncatePara(sweep_trunc_para, 0.01);
+  double j2 = 0.2;
+  Model j1j2solver(j2);
+  TPS<TenElemT, U1QN> tps = TPS<TenElemT, U1QN>(Ly, Lx);
+  if (!tps.Load("tps_heisenberg_D" + std::to_string(params.D))) {
+    std::cout << "Loading simple updated TPS files is broken." << std::endl;
+    exit(-2);
+  };
+  auto executor = new VMCPEPSExecutor<TenElemT, U1QN, TPSSampleNNFlipT, Model>(optimize_para, tps,
+                                                                                comm, j1j2solver);
+  executor->Execute();
+  delete executor;
+}
+
 TEST_F(SpinSystemVMCPEPS, TriHeisenbergD4) {
   using Model = SpinOneHalfTriHeisenbergSqrPEPS<TenElemT, U1QN>;
   VMCPEPSExecutor<TenElemT, U1QN, SquareTPSSample3SiteExchangeT, Model> *executor(nullptr);
@@ -0,0 +1,175 @@
+// SPDX-License-Identifier: LGPL-3.0-only
+
+/*
+* Description: QuantumLiquids/PEPS project. Unittests for the allocations on the sampling path of VMC-PEPS.
+*              The global operator new is replaced in this executable only.
+*/
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include "gtest/gtest.h"
+#include "qlten/qlten.h"
+#include "qlpeps/algorithm/vmc_update/vmc_peps.h"
+#include "qlpeps/algorithm/vmc_update/wave_function_component_classes/wave_function_component_all.h"
+#include "qlpeps/algorithm/vmc_update/model_solvers/build_in_model_solvers_all.h"
+#include "qlmps/case_params_parser.h"
+
+using namespace qlten;
+using namespace qlpeps;
+
+using qlten::special_qn::U1QN;
+using IndexT = Index<U1QN>;
+using QNSctT = QNSector<U1QN>;
+
+using TenElemT = TEN_ELEM_TYPE;
+
+using TPSSampleNNFlipT = SquareTPSSampleNNExchange<TenElemT, U1QN>;
+
+using qlmps::CaseParamsParserBasic;
+
+char *params_file;
+
+// count the allocations through the global operator new
+std::atomic<size_t> operator_new_num(0);
+// the part of them spent in the energy solver
+std::atomic<size_t> solver_new_num(0);
+
+void *operator new(std::size_t size) {
+  operator_new_num++;
+  if (void *ptr = std::malloc(size)) {
+    return ptr;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+
+struct VMCUpdateParams : public CaseParamsParserBasic {
+  VMCUpdateParams(const char *f) : CaseParamsParserBasic(f) {
+    Lx = ParseInt("Lx");
+    Ly = ParseInt("Ly");
+    D = ParseInt("D");
+    Db_min = ParseInt("Dbmps_min");
+    Db_max = ParseInt("Dbmps_max");
+    MC_samples = ParseInt("MC_samples");
+    WarmUp = ParseInt("WarmUp");
+  }
+
+  size_t Ly;
+  size_t Lx;
+  size_t D;
+  size_t Db_min;
+  size_t Db_max;
+  size_t MC_samples;
+  size_t WarmUp;
+};
+
+// The Heisenberg solver, with the allocations inside it counted apart from those of the executor
+template<typename TenElemT, typename QNT>
+class AllocationCountedHeisenbergSquare : public SpinOneHalfHeisenbergSquare<TenElemT, QNT> {
+  using Model = SpinOneHalfHeisenbergSquare<TenElemT, QNT>;
+ public:
+  using Model::Model;
+
+  template<typename WaveFunctionComponentType, bool calchols = true>
+  TenElemT CalEnergyAndHoles(const SplitIndexTPS<TenElemT, QNT> *sitps,
+                             WaveFunctionComponentType *tps_sample,
+                             TensorNetwork2D<TenElemT, QNT> &hole_res) {
+    const size_t new_num = operator_new_num;
+    TenElemT energy = Model::template CalEnergyAndHoles<WaveFunctionComponentType, calchols>(sitps,
+                                                                                            tps_sample,
+                                                                                            hole_res);
+    solver_new_num += operator_new_num - new_num;
+    return energy;
+  }
+};
+
+template<typename WaveFunctionComponentType, typename EnergySolver>
+class SampleExposedExecutor : public VMCPEPSExecutor<TenElemT, U1QN, WaveFunctionComponentType, EnergySolver> {
+ public:
+  using VMCPEPSExecutor<TenElemT, U1QN, WaveFunctionComponentType, EnergySolver>::VMCPEPSExecutor;
+  void Sample(void) { this->SampleEnergyAndHols_(); }
+};
+
+struct SpinSystemVMCPEPSAllocations : public testing::Test {
+  VMCUpdateParams params = VMCUpdateParams(params_file);
+  size_t Lx = params.Lx; //cols
+  size_t Ly = params.Ly;
+  size_t N = Lx * Ly;
+
+  VMCOptimizePara optimize_para =
+      VMCOptimizePara(BMPSTruncatePara(params.Db_min, params.Db_max,
+                                       1e-15, CompressMPSScheme::VARIATION2Site,
+                                       std::make_optional<double>(1e-14),
+                                       std::make_optional<size_t>(10)),
+                      params.MC_samples, params.WarmUp, 1,
+                      std::vector<size_t>(2, N / 2),
+                      Ly, Lx,
+                      std::vector<double>(1, 0.1),
+                      StochasticGradient);
+
+  const MPI_Comm comm = MPI_COMM_WORLD;
+  int rank, mpi_size;
+  void SetUp(void) {
+    ::testing::TestEventListeners &listeners =
+        ::testing::UnitTest::GetInstance()->listeners();
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &mpi_size);
+    if (rank != 0) {
+      delete listeners.Release(listeners.default_result_printer());
+    }
+
+    qlten::hp_numeric::SetTensorManipulationThreads(1);
+  }
+};
+
+TEST_F(SpinSystemVMCPEPSAllocations, SampleEnergyAndHoles) {
+  using ExecutorT = SampleExposedExecutor<TPSSampleNNFlipT, AllocationCountedHeisenbergSquare<TenElemT, U1QN>>;
+  optimize_para.wavefunction_path = "vmc_tps_heisenbergD" + std::to_string(params.D);
+  TPS<TenElemT, U1QN> tps = TPS<TenElemT, U1QN>(Ly, Lx);
+  if (!tps.Load("tps_heisenberg_D" + std::to_string(params.D))) {
+    std::cout << "Loading simple updated TPS files is broken." << std::endl;
+    exit(-2);
+  };
+  const size_t warm_up_samples = 2, samples = 5;
+  ASSERT_LE(warm_up_samples + samples, optimize_para.mc_samples); // within the reserved energy samples
+
+  // apart from the solver, the steady state of the stochastic gradient reuses the workspace buffers only
+  optimize_para.update_scheme = StochasticGradient;
+  auto executor = new ExecutorT(optimize_para, tps, comm);
+  for (size_t i = 0; i < warm_up_samples; i++) {
+    executor->Sample();
+  }
+  size_t new_num = operator_new_num, solver_num = solver_new_num;
+  for (size_t i = 0; i < samples; i++) {
+    executor->Sample();
+  }
+  EXPECT_GT(solver_new_num - solver_num, 0); // the solver contracts real tensors
+  EXPECT_EQ((operator_new_num - new_num) - (solver_new_num - solver_num), 0);
+  delete executor;
+
+  // the stored SplitIndexTPS samples do allocate, which checks the counting itself
+  optimize_para.update_scheme = StochasticReconfiguration;
+  optimize_para.sr_sample_storage = SplitIndexTPSSamples;
+  executor = new ExecutorT(optimize_para, tps, comm);
+  for (size_t i = 0; i < warm_up_samples; i++) {
+    executor->Sample();
+  }
+  new_num = operator_new_num;
+  solver_num = solver_new_num;
+  for (size_t i = 0; i < samples; i++) {
+    executor->Sample();
+  }
+  EXPECT_GE((operator_new_num - new_num) - (solver_new_num - solver_num), samples * Ly * Lx);
+  delete executor;
+}
+
+int main(int argc, char *argv[]) {
+  MPI_Init(nullptr, nullptr);
+  testing::InitGoogleTest(&argc, argv);
+  params_file = argv[1];
+  auto test_err = RUN_ALL_TESTS();
+  MPI_Finalize();
+  return test_err;
+}
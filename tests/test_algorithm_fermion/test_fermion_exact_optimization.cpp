@@ -10,6 +10,7 @@
 #include "gtest/gtest.h"
 #include "qlten/qlten.h"
 #include "qlpeps/qlpeps.h"
+#include "../test_mpi_env.h"
 
 using namespace qlten;
 using namespace qlpeps;
@@ -319,3 +320,82 @@ TEST_F(Z2tJTools, ExactSummation) {
   EXPECT_GE(energy, energy_exact);
   EXPECT_NEAR(energy, energy_exact, 1e-5);
 }
+
+TEST_F(Z2tJTools, ExactSumVMCExecutor) {
+  using WaveFunctionComponentT = SquareTPSSampleNNExchange<QLTEN_Double, fZ2QN>;
+  using Model = SquaretJModel<QLTEN_Double, fZ2QN>;
+  Model tj_model(t, J, false, mu);
+  std::vector<size_t> config_vec = {2, 2, 0, 1};
+  VMCOptimizePara optimize_para(BMPSTruncatePara(1, Db, 1e-16, CompressMPSScheme::SVD_COMPRESS,
+                                                 std::optional<double>(), std::optional<size_t>()),
+                                0, 0, 1, Vec2Config(config_vec, Lx, Ly), std::vector<double>(100, 0.1),
+                                StochasticGradient, ConjugateGradientParams(), "tps_tj_exact_sum");
+  optimize_para.mc_chains = 2;
+  ExactSumVMCExecutor<QLTEN_Double, fZ2QN, WaveFunctionComponentT, Model>
+      executor(optimize_para, split_index_tps, MPI_COMM_WORLD, tj_model);
+  EXPECT_EQ(executor.ConfigurationNum(), all_configs.size());
+  executor.Execute();
+  const double energy = executor.GetEnergyTrajectory().back();
+  EXPECT_GE(energy, energy_exact);
+  EXPECT_NEAR(energy, energy_exact, 1e-4);
+}
+
+/// The t-J solver, except that one configuration reports a vanishing amplitude and a non-finite energy
+struct tJModelWithNode : public SquaretJModel<QLTEN_Double, fZ2QN> {
+  tJModelWithNode(double t, double J, double mu, const Configuration &node)
+      : SquaretJModel<QLTEN_Double, fZ2QN>(t, J, false, mu), node(node) {}
+
+  template<typename WaveFunctionComponentType, bool calchols = true>
+  QLTEN_Double CalEnergyAndHoles(const SplitIndexTPS<QLTEN_Double, fZ2QN> *sitps,
+                                 WaveFunctionComponentType *tps_sample,
+                                 TensorNetwork2D<QLTEN_Double, fZ2QN> &hole_res) {
+    const QLTEN_Double e_loc = SquaretJModel<QLTEN_Double, fZ2QN>::template
+    CalEnergyAndHoles<WaveFunctionComponentType, calchols>(sitps, tps_sample, hole_res);
+    if (tps_sample->config == node) {
+      tps_sample->amplitude = 0;
+      return std::numeric_limits<double>::quiet_NaN();
+    }
+    return e_loc;
+  }
+
+  Configuration node;
+};
+
+TEST_F(Z2tJTools, ExactSumVMCExecutorSkipsZeroAmplitude) {
+  using WaveFunctionComponentT = SquareTPSSampleNNExchange<QLTEN_Double, fZ2QN>;
+  const Configuration &node = all_configs[all_configs.size() / 2];
+  tJModelWithNode model(t, J, mu, node);
+  std::vector<size_t> config_vec = {2, 2, 0, 1};
+  VMCOptimizePara optimize_para(BMPSTruncatePara(1, Db, 1e-16, CompressMPSScheme::SVD_COMPRESS,
+                                                 std::optional<double>(), std::optional<size_t>()),
+                                0, 0, 1, Vec2Config(config_vec, Lx, Ly), std::vector<double>(1, 0.1),
+                                StochasticGradient, ConjugateGradientParams(), "tps_tj_exact_sum_node");
+  optimize_para.mc_chains = 2;
+  ExactSumVMCExecutor<QLTEN_Double, fZ2QN, WaveFunctionComponentT, tJModelWithNode>
+      executor(optimize_para, split_index_tps, MPI_COMM_WORLD, model);
+  auto [energy, grad] = executor.EvaluateEnergyAndGradient();
+  EXPECT_TRUE(std::isfinite(energy));
+  EXPECT_TRUE(std::isfinite(grad.NormSquare()));
+
+  // the reference skips the node configuration
+  const SplitIndexTPS<QLTEN_Double, fZ2QN> &sitps = executor.GetState();
+  double weight_sum = 0.0, e_loc_sum = 0.0;
+  for (auto &config : all_configs) {
+    if (config == node) {
+      continue;
+    }
+    WaveFunctionComponentT tps_sample(sitps, config);
+    TensorNetwork2D<QLTEN_Double, fZ2QN> holes_dag(Ly, Lx);
+    const double e_loc = model.template CalEnergyAndHoles<WaveFunctionComponentT, true>(&sitps, &tps_sample,
+                                                                                        holes_dag);
+    e_loc_sum += e_loc * std::norm(tps_sample.amplitude);
+    weight_sum += std::norm(tps_sample.amplitude);
+  }
+  EXPECT_NEAR(energy, e_loc_sum / weight_sum, 1e-8);
+}
+
+int main(int argc, char *argv[]) {
+  testing::InitGoogleTest(&argc, argv);
+  ::testing::AddGlobalTestEnvironment(new MPIEnvironment);
+  return RUN_ALL_TESTS();
+}
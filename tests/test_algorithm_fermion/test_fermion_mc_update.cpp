@@ -167,7 +167,9 @@ size_t CountNumOfHole(const Configuration &config) {
 
 TEST_F(Z2tJModelTools, MonteCarlo3SiteUpdate) {
   TPSSampleTNNFlipT::trun_para = BMPSTruncatePara(mc_measurement_para);
-  TPSSampleTNNFlipT tps_sample(split_idx_tps, mc_measurement_para.init_config);
+  Configuration init_config = mc_measurement_para.init_config;
+  init_config.Random(mc_measurement_para.init_occupancy.value());
+  TPSSampleTNNFlipT tps_sample(split_idx_tps, init_config);
   std::vector<double> accept_rate(1);
   for (size_t i = 0; i < 100; i++) {
     tps_sample.MonteCarloSweepUpdate(split_idx_tps, u_double, accept_rate);
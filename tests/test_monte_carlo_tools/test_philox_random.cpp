@@ -0,0 +1,85 @@
+// SPDX-License-Identifier: LGPL-3.0-only
+
+/*
+* Author: Hao-Xin Wang<wanghaoxin1996@gmail.com>
+* Creation Date: 2024-10-16
+*
+* Description: QuantumLiquids/PEPS project. Unittests for the Philox random number generator.
+*/
+
+#include "gtest/gtest.h"
+#include "qlpeps/monte_carlo_tools/philox_random.h"
+#include <algorithm>
+#include <random>
+#include <sstream>
+
+using namespace qlpeps;
+
+// Known answers of the Random123 reference implementation
+TEST(PhiloxRandom, KnownAnswers) {
+  EXPECT_EQ(Philox4x32({0, 0, 0, 0}, {0, 0}),
+            PhiloxCounter({0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8}));
+  EXPECT_EQ(Philox4x32({0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff}, {0xffffffff, 0xffffffff}),
+            PhiloxCounter({0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd}));
+  EXPECT_EQ(Philox4x32({0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344}, {0xa4093822, 0x299f31d0}),
+            PhiloxCounter({0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1}));
+}
+
+TEST(PhiloxRandom, Streams) {
+  PhiloxEngine engine(2024, 3, 1), same(2024, 3, 1), other_chain(2024, 3, 2), other_rank(2024, 4, 1);
+  std::vector<uint32_t> a(100), b(100), c(100), d(100);
+  std::generate(a.begin(), a.end(), std::ref(engine));
+  std::generate(b.begin(), b.end(), std::ref(same));
+  std::generate(c.begin(), c.end(), std::ref(other_chain));
+  std::generate(d.begin(), d.end(), std::ref(other_rank));
+  EXPECT_EQ(a, b);
+  EXPECT_NE(a, c);
+  EXPECT_NE(a, d);
+
+  // the draws of a sweep do not depend on the draws of the earlier sweeps
+  engine.SetSweep(5);
+  same.SetSweep(4);
+  same();
+  same();
+  same();
+  same.NextSweep();
+  EXPECT_EQ(engine(), same());
+  EXPECT_EQ(engine, same);
+}
+
+TEST(PhiloxRandom, UniformAndDiscard) {
+  PhiloxEngine engine(7), copy(7), skip(7);
+  std::vector<double> batch(11);
+  engine();
+  copy();
+  engine.FillUniform(batch.data(), batch.size());
+  for (double x : batch) {
+    EXPECT_EQ(x, copy.Uniform());
+    EXPECT_GE(x, 0.0);
+    EXPECT_LT(x, 1.0);
+  }
+  EXPECT_EQ(engine, copy);
+
+  skip.discard(23);
+  EXPECT_EQ(engine, skip);
+  EXPECT_EQ(engine(), skip());
+
+  double mean = 0;
+  const size_t n = 100000;
+  for (size_t i = 0; i < n; i++) {
+    mean += engine.Uniform();
+  }
+  EXPECT_NEAR(mean / n, 0.5, 0.01);
+}
+
+TEST(PhiloxRandom, StreamInOut) {
+  PhiloxEngine engine(11, 1, 2), restored;
+  engine.SetSweep(3);
+  engine();
+  std::stringstream ss;
+  ss << engine;
+  ss >> restored;
+  EXPECT_EQ(engine, restored);
+  std::uniform_real_distribution<double> u(0, 1);
+  EXPECT_EQ(u(engine), u(restored));
+}
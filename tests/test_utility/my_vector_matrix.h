@@ -241,5 +241,118 @@ MPI_Status CGSolverRecvVector(
   return status;
 }
 
+template<typename ElemT>
+void CGSolverAllReduceSumVector(
+    MyVector<ElemT> &v,
+    const MPI_Comm &comm
+) {
+  HANDLE_MPI_ERROR(::MPI_Allreduce(MPI_IN_PLACE, v.GetElements().data(), v.GetSize(),
+                                   hp_numeric::GetMPIDataType<ElemT>(), MPI_SUM, comm));
+}
+
+template<typename ElemT>
+MPI_Request CGSolverAllReduceSumVectorStart(
+    MyVector<ElemT> &v,
+    const MPI_Comm &comm
+) {
+  MPI_Request request;
+  HANDLE_MPI_ERROR(::MPI_Iallreduce(MPI_IN_PLACE, v.GetElements().data(), v.GetSize(),
+                                    hp_numeric::GetMPIDataType<ElemT>(), MPI_SUM, comm, &request));
+  return request;
+}
+
+template<typename ElemT>
+void CGSolverAllReduceSumVectorWait(
+    MPI_Request &request,
+    MyVector<ElemT> &v
+) {
+  HANDLE_MPI_ERROR(::MPI_Wait(&request, MPI_STATUS_IGNORE));
+}
+
+///< Contiguous partition of the vector elements over the processes, for the sharded CG
+struct MyVectorShard {
+  MyVectorShard(size_t length, const MPI_Comm &comm) {
+    int mpi_size;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &mpi_size);
+    for (int r = 0; r <= mpi_size; r++) {
+      offsets.push_back(int(length * r / mpi_size));
+    }
+  }
+
+  std::vector<int> Counts() const {
+    std::vector<int> counts(offsets.size() - 1);
+    for (size_t r = 0; r < counts.size(); r++) {
+      counts[r] = offsets[r + 1] - offsets[r];
+    }
+    return counts;
+  }
+
+  std::vector<int> offsets;
+  int rank;
+};
+
+template<typename ElemT>
+void CGSolverShardAllGatherVector(
+    MyVector<ElemT> &v,
+    const MyVectorShard &shard,
+    const MPI_Comm &comm
+) {
+  const std::vector<int> counts = shard.Counts();
+  HANDLE_MPI_ERROR(::MPI_Allgatherv(MPI_IN_PLACE, 0, MPI_DATATYPE_NULL, v.GetElements().data(), counts.data(),
+                                    shard.offsets.data(), hp_numeric::GetMPIDataType<ElemT>(), comm));
+}
+
+template<typename ElemT>
+void CGSolverShardReduceScatterSumVector(
+    MyVector<ElemT> &v,
+    const MyVectorShard &shard,
+    const MPI_Comm &comm
+) {
+  const std::vector<int> counts = shard.Counts();
+  std::vector<ElemT> recv(counts[shard.rank]);
+  HANDLE_MPI_ERROR(::MPI_Reduce_scatter(v.GetElements().data(), recv.data(), counts.data(),
+                                        hp_numeric::GetMPIDataType<ElemT>(), MPI_SUM, comm));
+  std::copy(recv.cbegin(), recv.cend(), v.GetElements().begin() + shard.offsets[shard.rank]);
+}
+
+template<typename ElemT>
+ElemT CGSolverShardInnerProduct(
+    const MyVector<ElemT> &v1,
+    const MyVector<ElemT> &v2,
+    const MyVectorShard &shard
+) {
+  ElemT res(0);
+  for (int i = shard.offsets[shard.rank]; i < shard.offsets[shard.rank + 1]; i++) {
+    res += MyConj(v1.GetElements()[i]) * v2.GetElements()[i];
+  }
+  return res;
+}
+
+template<typename ElemT>
+double CGSolverShardNormSquare(
+    const MyVector<ElemT> &v,
+    const MyVectorShard &shard
+) {
+  double res = 0;
+  for (int i = shard.offsets[shard.rank]; i < shard.offsets[shard.rank + 1]; i++) {
+    res += std::norm(v.GetElements()[i]);
+  }
+  return res;
+}
+
+template<typename ElemT, typename AlphaT, typename BetaT>
+void CGSolverShardAxpby(
+    const AlphaT alpha,
+    const MyVector<ElemT> &x,
+    const BetaT beta,
+    MyVector<ElemT> &y,
+    const MyVectorShard &shard
+) {
+  for (int i = shard.offsets[shard.rank]; i < shard.offsets[shard.rank + 1]; i++) {
+    y.GetElements()[i] = ElemT(alpha) * x.GetElements()[i] + ElemT(beta) * y.GetElements()[i];
+  }
+}
+
 
 #endif //QLPEPS_VMC_PEPS_MY_VECTOR_MATRIX_H
@@ -26,13 +26,39 @@ void RunTestPlainCGSolverParallelCase(
   int rank, mpi_size;
   MPI_Comm_rank(comm, &rank);
   MPI_Comm_size(comm, &mpi_size);
-  size_t iter;
-  auto x = ConjugateGradientSolver(mat, b, x0, 100, 1e-16, 20, iter, comm);
-  if (rank == kMPIMasterRank) {
-    x.Print();
-    auto diff_vec = x - x_res;
-    EXPECT_NEAR(diff_vec.NormSquare(), 0.0, 1e-13);
+  for (auto scheme : {MasterSlaveCG, AllReduceCG, PipelinedAllReduceCG}) {
+    size_t iter;
+    auto x = ConjugateGradientSolver(mat, b, x0, 100, 1e-16, 20, iter, comm, scheme);
+    if (rank == kMPIMasterRank || scheme != MasterSlaveCG) {
+      if (rank == kMPIMasterRank) {
+        x.Print();
+      }
+      auto diff_vec = x - x_res;
+      EXPECT_NEAR(diff_vec.NormSquare(), 0.0, 1e-13);
+    }
+
+    // converging in the last allowed iteration is still reported as converged
+    HANDLE_MPI_ERROR(::MPI_Bcast(&iter, 1, MPI_UNSIGNED_LONG_LONG, kMPIMasterRank, comm));
+    ASSERT_GT(iter, 0);
+    size_t last_iter;
+    bool converged;
+    ConjugateGradientSolver(mat, b, x0, iter, 1e-16, 20, last_iter, comm, scheme, &converged);
+    if (rank == kMPIMasterRank || scheme != MasterSlaveCG) {
+      EXPECT_EQ(last_iter, iter);
+      EXPECT_TRUE(converged);
+    }
+    ConjugateGradientSolver(mat, b, x0, iter - 1, 1e-16, 20, last_iter, comm, scheme, &converged);
+    if (rank == kMPIMasterRank || scheme != MasterSlaveCG) {
+      EXPECT_EQ(last_iter, iter - 1);
+      EXPECT_FALSE(converged);
+    }
   }
+
+  // the same equation with the vectors sharded over the processes
+  size_t iter;
+  MyVectorShard shard(b.GetSize(), comm);
+  auto x = ConjugateGradientSolverSharded(mat, b, x0, 100, 1e-16, 20, iter, shard, comm);
+  EXPECT_NEAR((x - x_res).NormSquare(), 0.0, 1e-13);
 }
 
 TEST(TestPlainCGSolver, ParallelDouble) {
@@ -176,6 +202,105 @@ TEST(TestPlainCGSolver, ParallelComplexImaginaryOffDiagonal) {
   RunTestPlainCGSolverParallelCase(cmat2, cb2, cx02, cx_res2, comm);
 }
 
+TEST(TestRecycledCGSolver, ParallelSequenceOfCorrelatedSystems) {
+  MPI_Comm comm = MPI_COMM_WORLD;
+  int rank, mpi_size;
+  MPI_Comm_rank(comm, &rank);
+  MPI_Comm_size(comm, &mpi_size);
+  ::testing::TestEventListeners &listeners =
+      ::testing::UnitTest::GetInstance()->listeners();
+  if (rank != 0) {
+    delete listeners.Release(listeners.default_result_printer());
+  }
+
+  const size_t n = 40;
+  const double tolerance = 1e-28; // relative to |b|^2 in the parallel solvers
+  for (auto scheme : {MasterSlaveCG, AllReduceCG, PipelinedAllReduceCG}) {
+    CGRecycleSpace<MyVector<double>> space(3);
+    MyVector<double> x0(n);
+    for (size_t step = 0; step < 4; step++) {
+      // tridiagonal SPD matrix with a graded diagonal, evenly distributed in the processes
+      std::vector<std::vector<double>> a(n, std::vector<double>(n, 0.0));
+      for (size_t i = 0; i < n; i++) {
+        a[i][i] = (2.0 + 0.25 * i + 0.05 * step) / mpi_size;
+        if (i + 1 < n) {
+          a[i][i + 1] = a[i + 1][i] = -1.0 / mpi_size;
+        }
+      }
+      MySquareMatrix<double> mat(a), full_mat(a);
+      std::vector<double> b_elems(n);
+      for (size_t i = 0; i < n; i++) {
+        b_elems[i] = std::cos(0.3 * i) + 0.01 * step * std::sin(double(i));
+      }
+      MyVector<double> b(b_elems);
+      size_t plain_iter, recycled_iter;
+      ConjugateGradientSolver(mat, b, x0, 200, tolerance, 0, plain_iter, comm, scheme);
+      auto x = RecycledConjugateGradientSolver(mat, b, x0, 200, tolerance, 0, recycled_iter, comm, scheme, space);
+      if (rank == kMPIMasterRank || scheme != MasterSlaveCG) {
+        auto residue = full_mat * x * double(mpi_size) - b;
+        EXPECT_LT(residue.NormSquare(), 1e-20);
+        EXPECT_EQ(space.Dim(), std::min(step + 1, space.MaxDim()));
+        if (step > 0) {
+          EXPECT_LT(recycled_iter, plain_iter);
+        }
+      }
+    }
+  }
+}
+
+TEST(TestPreconditionedCGSolver, ParallelBadlyScaledDiagonal) {
+  MPI_Comm comm = MPI_COMM_WORLD;
+  int rank, mpi_size;
+  MPI_Comm_rank(comm, &rank);
+  MPI_Comm_size(comm, &mpi_size);
+  ::testing::TestEventListeners &listeners =
+      ::testing::UnitTest::GetInstance()->listeners();
+  if (rank != 0) {
+    delete listeners.Release(listeners.default_result_printer());
+  }
+
+  const size_t n = 30;
+  std::vector<std::vector<double>> a(n, std::vector<double>(n, 0.0)), full_a(n, std::vector<double>(n, 0.0));
+  std::vector<double> inv_diag(n);
+  for (size_t i = 0; i < n; i++) {
+    const double scale_i = std::pow(10.0, 8.0 * double(i) / double(n - 1));
+    full_a[i][i] = 4.0 * scale_i;
+    if (i + 1 < n) {
+      const double scale_j = std::pow(10.0, 8.0 * double(i + 1) / double(n - 1));
+      full_a[i][i + 1] = full_a[i + 1][i] = -std::sqrt(scale_i * scale_j);
+    }
+    inv_diag[i] = 1.0 / full_a[i][i];
+  }
+  for (size_t i = 0; i < n; i++) {
+    for (size_t j = 0; j < n; j++) {
+      a[i][j] = full_a[i][j] / mpi_size;
+    }
+  }
+  MySquareMatrix<double> mat(a), full_mat(full_a);
+  std::vector<double> x_elems(n);
+  for (size_t i = 0; i < n; i++) {
+    x_elems[i] = std::cos(0.5 * i);
+  }
+  MyVector<double> x_res(x_elems);
+  MyVector<double> b = full_mat * x_res;
+  MyVector<double> x0(n);
+  auto jacobi = [&inv_diag](const MyVector<double> &r) {
+    std::vector<double> z(r.GetElements());
+    for (size_t i = 0; i < z.size(); i++) {
+      z[i] *= inv_diag[i];
+    }
+    return MyVector<double>(z);
+  };
+  for (auto scheme : {MasterSlaveCG, AllReduceCG, PipelinedAllReduceCG}) {
+    size_t iter;
+    auto x = PreconditionedConjugateGradientSolver(mat, b, x0, jacobi, 200, 1e-24, 10, iter, comm, scheme);
+    if (rank == kMPIMasterRank || scheme != MasterSlaveCG) {
+      EXPECT_NEAR((x - x_res).NormSquare() / x_res.NormSquare(), 0.0, 1e-16);
+      EXPECT_LT(iter, n);
+    }
+  }
+}
+
 int main(int argc, char *argv[]) {
   testing::InitGoogleTest(&argc, argv);
   MPI_Init(nullptr, nullptr);
@@ -60,3 +60,93 @@ TEST(TestPlainCGSolver, NoParallel) {
   RunTestPlainCGSolverNoParallelCase(zmat2, zb2, zx02, zx_res2);
 }
 
+
+// Symmetric positive definite tridiagonal n x n matrix with a graded diagonal
+MySquareMatrix<double> SPDMatrix(const size_t n, const double shift) {
+  std::vector<std::vector<double>> a(n, std::vector<double>(n, 0.0));
+  for (size_t i = 0; i < n; i++) {
+    a[i][i] = 2.0 + 0.25 * i + shift;
+    if (i + 1 < n) {
+      a[i][i + 1] = a[i + 1][i] = -1.0;
+    }
+  }
+  return MySquareMatrix<double>(a);
+}
+
+TEST(TestRecycledCGSolver, SequenceOfCorrelatedSystems) {
+  const size_t n = 40;
+  const size_t max_iter = 500;
+  const double tolerance = 1e-14;
+  CGRecycleSpace<MyVector<double>> space(3);
+  MyVector<double> x0(n); // zeros
+  size_t total_plain_iter = 0, total_recycled_iter = 0, total_projection_matvec = 0;
+  for (size_t step = 0; step < 5; step++) {
+    auto mat = SPDMatrix(n, 0.05 * step);
+    std::vector<double> b_elems(n);
+    for (size_t i = 0; i < n; i++) {
+      b_elems[i] = std::cos(0.3 * i) + 0.01 * step * std::sin(double(i));
+    }
+    MyVector<double> b(b_elems);
+    size_t plain_iter, recycled_iter, projection_matvec;
+    auto x_plain = ConjugateGradientSolver(mat, b, x0, max_iter, tolerance, plain_iter);
+    RecycledInitialGuess(mat, b, x0, space, &projection_matvec);
+    EXPECT_EQ(projection_matvec, space.Dim()); // the zero x0 adds no basis vector
+    auto x = RecycledConjugateGradientSolver(mat, b, x0, max_iter, tolerance, recycled_iter, space);
+    EXPECT_LT((mat * x - b).NormSquare(), tolerance);
+    EXPECT_NEAR((x - x_plain).NormSquare() / x_plain.NormSquare(), 0.0, 1e-12);
+    EXPECT_EQ(space.Dim(), std::min(step + 1, space.MaxDim()));
+    if (step > 0) {
+      EXPECT_LT(recycled_iter, plain_iter);
+    }
+    total_plain_iter += plain_iter;
+    total_recycled_iter += recycled_iter;
+    total_projection_matvec += projection_matvec;
+  }
+  std::cout << "plain CG iterations : " << total_plain_iter
+            << ", recycled CG iterations : " << total_recycled_iter
+            << " + projection products : " << total_projection_matvec << std::endl;
+}
+
+///< M^{-1} = diag(matrix)^{-1}
+template<typename ElemT>
+struct JacobiPreconditioner {
+  std::vector<ElemT> inv_diag;
+
+  MyVector<ElemT> operator()(const MyVector<ElemT> &r) const {
+    std::vector<ElemT> z(r.GetElements());
+    for (size_t i = 0; i < z.size(); i++) {
+      z[i] *= inv_diag[i];
+    }
+    return MyVector<ElemT>(z);
+  }
+};
+
+TEST(TestPreconditionedCGSolver, BadlyScaledDiagonal) {
+  const size_t n = 30;
+  // D^{1/2} T D^{1/2}, where T is a well conditioned tridiagonal matrix and D spans 8 orders of magnitude
+  std::vector<double> scale(n);
+  for (size_t i = 0; i < n; i++) {
+    scale[i] = std::pow(10.0, 8.0 * double(i) / double(n - 1));
+  }
+  std::vector<std::vector<double>> a(n, std::vector<double>(n, 0.0));
+  JacobiPreconditioner<double> jacobi;
+  for (size_t i = 0; i < n; i++) {
+    a[i][i] = 4.0 * scale[i];
+    if (i + 1 < n) {
+      a[i][i + 1] = a[i + 1][i] = -1.0 * std::sqrt(scale[i] * scale[i + 1]);
+    }
+    jacobi.inv_diag.push_back(1.0 / a[i][i]);
+  }
+  MySquareMatrix<double> mat(a);
+  std::vector<double> x_elems(n);
+  for (size_t i = 0; i < n; i++) {
+    x_elems[i] = std::cos(0.5 * i);
+  }
+  MyVector<double> x_res(x_elems);
+  MyVector<double> b = mat * x_res;
+  MyVector<double> x0(n);
+  size_t iter;
+  auto x = PreconditionedConjugateGradientSolver(mat, b, x0, jacobi, 200, 1e-20 * b.NormSquare(), iter);
+  EXPECT_NEAR((x - x_res).NormSquare() / x_res.NormSquare(), 0.0, 1e-12);
+  EXPECT_LT(iter, n);
+}
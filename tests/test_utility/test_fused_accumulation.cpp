@@ -0,0 +1,63 @@
+// SPDX-License-Identifier: LGPL-3.0-only
+
+/*
+* Author: Hao-Xin Wang<wanghaoxin1996@gmail.com>
+* Creation Date: 2024-10-16
+*
+* Description: QuantumLiquids/PEPS project. Unittests for fused accumulation kernels
+*/
+
+#include <vector>
+#include <complex>
+#include "gtest/gtest.h"
+#include "qlpeps/utility/fused_accumulation.h"
+
+using namespace qlpeps;
+
+template<typename ElemT>
+void RunTestFusedAxpyAccumulateCase(const ElemT a, const ElemT b) {
+  const size_t n = 7;
+  std::vector<ElemT> x(n), y(n), z(n), y_ref(n), z_ref(n);
+  for (size_t i = 0; i < n; i++) {
+    x[i] = ElemT(0.5 * i - 1.0);
+    y[i] = y_ref[i] = ElemT(2.0 * i);
+    z[i] = z_ref[i] = ElemT(-1.0 * i);
+  }
+  FusedAxpyAccumulate(n, a, b, x.data(), y.data(), z.data());
+  for (size_t i = 0; i < n; i++) {
+    EXPECT_EQ(y[i], y_ref[i] + a * x[i]);
+    EXPECT_EQ(z[i], z_ref[i] + b * x[i]);
+  }
+
+  std::vector<ElemT> y_comp(n, ElemT(0)), z_comp(n, ElemT(0));
+  y = y_ref;
+  z = z_ref;
+  FusedAxpyAccumulateKahan(n, a, b, x.data(), y.data(), y_comp.data(), z.data(), z_comp.data());
+  KahanFinalize(n, y.data(), y_comp.data());
+  KahanFinalize(n, z.data(), z_comp.data());
+  for (size_t i = 0; i < n; i++) {
+    EXPECT_NEAR(std::abs(y[i] - (y_ref[i] + a * x[i])), 0.0, 1e-14);
+    EXPECT_NEAR(std::abs(z[i] - (z_ref[i] + b * x[i])), 0.0, 1e-14);
+    EXPECT_EQ(y_comp[i], ElemT(0));
+  }
+}
+
+TEST(TestFusedAccumulation, FusedAxpy) {
+  RunTestFusedAxpyAccumulateCase<double>(1.0, -0.3);
+  RunTestFusedAxpyAccumulateCase<std::complex<double>>(1.0, std::complex<double>(0.2, -0.7));
+}
+
+TEST(TestFusedAccumulation, KahanSmallAddedToLarge) {
+  // add many small numbers to a large one, where the naive summation loses all of them
+  const size_t sample_num = 100000;
+  const double large = 1.0e16, small = 1.0;
+  double y_naive = large, z_naive = 0.0;
+  double y_kahan = large, z_kahan = 0.0, y_comp = 0.0, z_comp = 0.0;
+  for (size_t i = 0; i < sample_num; i++) {
+    FusedAxpyAccumulate(1, 1.0, 0.0, &small, &y_naive, &z_naive);
+    FusedAxpyAccumulateKahan(1, 1.0, 0.0, &small, &y_kahan, &y_comp, &z_kahan, &z_comp);
+  }
+  KahanFinalize(1, &y_kahan, &y_comp);
+  EXPECT_EQ(y_naive, large);
+  EXPECT_EQ(y_kahan - large, double(sample_num));
+}
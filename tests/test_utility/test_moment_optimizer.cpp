@@ -0,0 +1,62 @@
+// SPDX-License-Identifier: LGPL-3.0-only
+
+/*
+* Author: Hao-Xin Wang<wanghaoxin1996@gmail.com>
+* Creation Date: 2024-10-16
+*
+* Description: QuantumLiquids/PEPS project. Unittests for the element-wise kernels of the Adam-type optimizers
+*/
+
+#include <vector>
+#include <complex>
+#include "gtest/gtest.h"
+#include "qlpeps/utility/moment_optimizer.h"
+
+using namespace qlpeps;
+
+template<typename ElemT>
+void RunTestAdamCase(const bool amsgrad) {
+  const size_t n = 5, steps = 4;
+  const double beta1 = 0.9, beta2 = 0.999, epsilon = 1e-8;
+  std::vector<ElemT> m(n, ElemT(0)), v(n, ElemT(0)), v_max(n, ElemT(0)), d(n);
+  std::vector<ElemT> m_ref(n, ElemT(0));
+  std::vector<double> v_ref(n, 0.0), v_max_ref(n, 0.0);
+  for (size_t t = 1; t <= steps; t++) {
+    std::vector<ElemT> g(n);
+    for (size_t i = 0; i < n; i++) {
+      g[i] = ElemT(std::cos(double(i * t))) * (t % 2 == 0 ? ElemT(3.0) : ElemT(1.0));
+      m_ref[i] = beta1 * m_ref[i] + (1 - beta1) * g[i];
+      v_ref[i] = beta2 * v_ref[i] + (1 - beta2) * std::norm(g[i]);
+      v_max_ref[i] = std::max(v_max_ref[i], v_ref[i]);
+    }
+    AdamMomentUpdate(n, beta1, beta2, g.data(), m.data(), v.data(), amsgrad ? v_max.data() : nullptr);
+    const double bias1 = 1 - std::pow(beta1, t), bias2 = 1 - std::pow(beta2, t);
+    AdamDirection(n, bias1, bias2, epsilon, m.data(), amsgrad ? v_max.data() : v.data(), d.data());
+    for (size_t i = 0; i < n; i++) {
+      EXPECT_NEAR(std::abs(m[i] - m_ref[i]), 0.0, 1e-15);
+      EXPECT_NEAR(std::abs(v[i] - ElemT(v_ref[i])), 0.0, 1e-15);
+      const double v_used = amsgrad ? v_max_ref[i] : v_ref[i];
+      ElemT d_ref = (m_ref[i] / bias1) / (std::sqrt(v_used / bias2) + epsilon);
+      EXPECT_NEAR(std::abs(d[i] - d_ref), 0.0, 1e-12);
+    }
+  }
+  if (!amsgrad) {
+    // the first step of Adam moves every parameter by about 1 in the gradient direction
+    std::vector<ElemT> g(n, ElemT(0.01)), m1(n, ElemT(0)), v1(n, ElemT(0)), d1(n);
+    AdamMomentUpdate(n, beta1, beta2, g.data(), m1.data(), v1.data(), (ElemT *) nullptr);
+    AdamDirection(n, 1 - beta1, 1 - beta2, epsilon, m1.data(), v1.data(), d1.data());
+    for (size_t i = 0; i < n; i++) {
+      EXPECT_NEAR(std::abs(d1[i] - ElemT(1.0)), 0.0, 1e-5);
+    }
+  }
+}
+
+TEST(TestMomentOptimizer, Adam) {
+  RunTestAdamCase<double>(false);
+  RunTestAdamCase<std::complex<double>>(false);
+}
+
+TEST(TestMomentOptimizer, AMSGrad) {
+  RunTestAdamCase<double>(true);
+  RunTestAdamCase<std::complex<double>>(true);
+}
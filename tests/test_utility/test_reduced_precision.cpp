@@ -0,0 +1,45 @@
+// SPDX-License-Identifier: LGPL-3.0-only
+
+/*
+* Author: Hao-Xin Wang<wanghaoxin1996@gmail.com>
+* Creation Date: 2024-10-16
+*
+* Description: QuantumLiquids/PEPS project. Unittests for the float32 and bfloat16 encodings
+*/
+
+#include <vector>
+#include <cmath>
+#include "gtest/gtest.h"
+#include "qlpeps/utility/reduced_precision.h"
+
+using namespace qlpeps;
+
+TEST(TestReducedPrecision, BF16RoundToNearestEven) {
+  EXPECT_EQ(FloatToBF16(1.0f), 0x3f80);
+  EXPECT_EQ(FloatToBF16(-2.0f), 0xc000);
+  EXPECT_EQ(FloatToBF16(1.0f + std::ldexp(1.0f, -8)), 0x3f80);       // tie, round to even
+  EXPECT_EQ(FloatToBF16(1.0f + 3 * std::ldexp(1.0f, -8)), 0x3f82);   // tie, round to even
+  EXPECT_EQ(FloatToBF16(1.0f + 5 * std::ldexp(1.0f, -9)), 0x3f81);   // above the half
+  EXPECT_EQ(BF16ToFloat(0x3f81), 1.0f + std::ldexp(1.0f, -7));
+  EXPECT_TRUE(std::isnan(BF16ToFloat(FloatToBF16(std::nanf("")))));
+}
+
+TEST(TestReducedPrecision, EncodeDecodeRelativeError) {
+  const size_t n = 1000;
+  std::vector<double> x(n), y(n);
+  for (size_t i = 0; i < n; i++) {
+    x[i] = std::sin(0.37 * i) * std::pow(10.0, double(i % 13) - 6.0);
+  }
+  std::vector<float> xf(n);
+  EncodeFloat(x.data(), n, xf.data());
+  DecodeFloat(xf.data(), n, y.data());
+  for (size_t i = 0; i < n; i++) {
+    EXPECT_LE(std::abs(y[i] - x[i]), std::ldexp(std::abs(x[i]), -24));
+  }
+  std::vector<uint16_t> xb(n);
+  EncodeBF16(x.data(), n, xb.data());
+  DecodeBF16(xb.data(), n, y.data());
+  for (size_t i = 0; i < n; i++) {
+    EXPECT_LE(std::abs(y[i] - x[i]), std::ldexp(std::abs(x[i]), -8) * (1 + 1e-6));
+  }
+}
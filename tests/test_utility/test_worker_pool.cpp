@@ -0,0 +1,44 @@
+// SPDX-License-Identifier: LGPL-3.0-only
+
+/*
+* Author: Hao-Xin Wang<wanghaoxin1996@gmail.com>
+* Creation Date: 2024-10-16
+*
+* Description: QuantumLiquids/PEPS project. Unittests for the persistent worker pool
+*/
+
+#include <vector>
+#include "gtest/gtest.h"
+#include "qlpeps/utility/worker_pool.h"
+
+using namespace qlpeps;
+
+TEST(WorkerPool, EachTaskRunsOnce) {
+  WorkerPool pool;
+  std::vector<size_t> counts(16);
+  for (size_t rep = 0; rep < 1000; rep++) {
+    const size_t thread_num = 1 + rep % 4, task_num = rep % counts.size();
+    std::fill(counts.begin(), counts.end(), 0);
+    pool.ParallelFor(thread_num, task_num, [&counts](const size_t k) { counts[k]++; });
+    for (size_t k = 0; k < counts.size(); k++) {
+      EXPECT_EQ(counts[k], k < task_num ? 1 : 0);
+    }
+  }
+}
+
+TEST(WorkerPool, WorkersAreReused) {
+  WorkerPool pool;
+  EXPECT_EQ(pool.WorkerNum(), 0);
+  pool.ParallelFor(3, 8, [](const size_t) {});
+  EXPECT_EQ(pool.WorkerNum(), 2);
+  pool.ParallelFor(2, 8, [](const size_t) {});
+  EXPECT_EQ(pool.WorkerNum(), 2);
+
+  WorkerPool copy(pool);
+  EXPECT_EQ(copy.WorkerNum(), 0);
+  std::vector<size_t> counts(5);
+  copy.ParallelFor(3, counts.size(), [&counts](const size_t k) { counts[k]++; });
+  for (auto count : counts) {
+    EXPECT_EQ(count, 1);
+  }
+}